@@ -2,6 +2,13 @@
 #include "debug.hpp"
 #include "../lib/string.hpp"
 #include "../lib/functional/list_deal.hpp"
+#include "../lib/functional/high_order.hpp"
+#include "../lib/functional/rest.hpp"
+#include "../lib/tools/histgram.hpp"
+#include "../lib/functional/filter.hpp"
+#include "../lib/calculation/basic_statistics.hpp"
+#include "../lib/distance/minkowski_distance.hpp"
+#include <random>
 
 
 //処理方法の優先順位は SIG_MSVC_ENV(windows.h使用) > SIG_ENABLE_BOOOST(boost::filesystem使用)
@@ -31,6 +38,7 @@ void GetDirectoryNamesTest()
 		L"test4.txt",
 		L"test5.txt",
 		L"test6.txt",
+		L"test7.txt",
 		L"histgram1.txt",
 		L"histgram2.txt",
 		L"shift_jis.txt",
@@ -49,6 +57,7 @@ void GetDirectoryNamesTest()
 		L"test4.txt",
 		L"test5.txt",
 		L"test6.txt",
+		L"test7.txt",
 		L"histgram1.txt",
 		L"histgram2.txt",
 		L"shift_jis.txt",
@@ -257,3 +266,1396 @@ void FileSaveLoadTest()
 		}
 	);
 }
+
+
+void MappedLoadTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	const std::vector<std::string> text{
+		"HAIL TO YOU,MY FELLOW.",
+		"",
+		"KEEP YOUR DIGNITY."
+	};
+	save_line(text, fpass);
+
+	//コンテナを指定して読み込み (string_view は handle が生存している間有効)
+	std::vector<string_view> read1;
+	std::set<string_view> read2;
+	auto handle1 = load_line_mapped(read1, fpass);
+	auto handle2 = load_line_mapped(read2, fpass);
+
+	assert(isJust(handle1) && isJust(handle2));
+	assert(read1.size() == text.size());
+	for (sig::uint i = 0; i < text.size(); ++i) assert(read1[i] == text[i]);
+	assert(read2.size() == 3 && read2.count("") && read2.count("KEEP YOUR DIGNITY."));
+
+	//load_line と同じ結果になるか
+	std::vector<std::string> read3;
+	load_line(read3, fpass);
+	assert(read3.size() == read1.size());
+	for (sig::uint i = 0; i < read3.size(); ++i) assert(read1[i] == read3[i]);
+
+	//結果を返す版 (末尾に改行の無いファイル)
+	save_line(text, fpass);
+	{
+		std::ofstream ofs(fpass, std::ios::out | std::ios::app);
+		ofs << "no newline";
+	}
+	auto read4 = load_line_mapped(fpass);
+	
+	assert(isJust(read4));
+	auto lines = fromJust(std::move(read4));		// ムーブしても各行は有効
+	assert(lines.size() == text.size() + 1);
+	assert(lines[0] == text[0] && lines[3] == "no newline");
+	assert(lines.file().size() == std::accumulate(lines.begin(), lines.end(), 0u, [](sig::uint sum, string_view s){ return sum + s.size() + 1; }) - 1);
+
+	//空のファイル・存在しないファイル
+	clear_file(fpass);
+	std::vector<string_view> read5;
+	assert(isJust(load_line_mapped(read5, fpass)) && read5.empty());
+	assert(!isJust(load_line_mapped(fpass)));
+	assert(!isJust(load_line_mapped(pass + SIG_TO_FPSTR("not_exist.txt"))));
+}
+
+
+void LoadLineUtf8Test()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	{
+		std::ofstream ofs(fpass, std::ios::out | std::ios::binary);
+		ofs << "\xEF\xBB\xBF" "abc\n"									// BOM
+			<< "\xE3\x81\x82\xE3\x81\x84 and some ascii text\n"		// あい
+			<< "\xF0\x9F\x98\x80\n"									// 4byte
+			<< "bad\xC3(\xFF\xE3\x81\n"							// 不正なバイト列
+			<< "\n"
+			<< "last";
+	}
+	const std::vector<std::wstring> expect{
+		L"abc",
+		L"\u3042\u3044 and some ascii text",
+		L"\U0001F600",
+		L"bad\uFFFD(\uFFFD\uFFFD\uFFFD",
+		L"",
+		L"last"
+	};
+
+	std::vector<std::wstring> read1;
+	assert(load_line_utf8(read1, fpass));
+	assert(read1 == expect);
+
+	auto read2 = load_line_utf8<std::u16string, std::list<std::u16string>>(fpass);
+	assert(isJust(read2) && read2->size() == expect.size());
+	assert(*std::next(read2->begin(), 2) == u"\U0001F600" && std::next(read2->begin(), 2)->size() == 2);	// サロゲートペア
+
+	//並列に変換しても行の順番は変わらない
+	std::vector<std::string> text;
+	std::vector<std::wstring> wtext;
+	for (int i = 0; i < 100000; ++i){
+		text.push_back(std::to_string(i));
+		wtext.push_back(std::to_wstring(i));
+		for (int j = 0; j < i % 7; ++j){
+			text.back() += "\xE6\x97\xA5 text";		// 日
+			wtext.back() += L"\u65E5 text";
+		}
+	}
+	save_line(text, fpass);
+
+	auto read3 = load_line_utf8(fpass, 4);
+	assert(isJust(read3) && fromJust(read3) == wtext);
+
+	clear_file(fpass);
+}
+
+void LoadNumParallelTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	//ロケールに依存しない数値変換
+	auto to_d = [](std::string const& s){ return impl::parse_num<double>(s.data(), s.data() + s.size()); };
+	auto to_i = [](std::string const& s){ return impl::parse_num<int>(s.data(), s.data() + s.size()); };
+
+	assert(to_d("1.1") == 1.1);
+	assert(to_d(" +0.5e-3") == 0.5e-3);
+	assert(to_d("-2.2250738585072014e-308") == -2.2250738585072014e-308);
+	assert(to_d("123456789012345678901234") == 123456789012345678901234.0);
+	assert(to_d("3.3\r") == 3.3);
+	assert(to_i(" 42xyz") == 42);
+	assert(to_i("-2147483648") == std::numeric_limits<int>::min());
+
+	bool caught = false;
+	try{ to_i("2147483648"); } catch (std::out_of_range&){ caught = true; }
+	assert(caught);
+	caught = false;
+	try{ to_d("abc"); } catch (std::invalid_argument&){ caught = true; }
+	assert(caught);
+
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> mant(-1.0, 1.0);
+	std::uniform_int_distribution<int> expo(-300, 300);
+	for (int i = 0; i < 10000; ++i){
+		const double v = std::ldexp(mant(rng), expo(rng));
+		char buf[32];
+		std::snprintf(buf, sizeof(buf), "%.17g", v);
+		assert(to_d(buf) == v);
+	}
+
+	//行列を行単位で並列に読み込み (ファイル中の順番通りに格納される)
+	const int rows = 300000;
+	std::vector<std::vector<double>> mat;
+	for (int i = 0; i < rows; ++i) mat.push_back({ (i % 1000) * 0.25, (i % 100) * -1.5, static_cast<double>(i), 1e-3 });
+	save_num(mat, fpass, ",");
+
+	auto read1 = load_num2d<double>(fpass, ",");
+	auto read2 = load_num2d<double, std::list<std::vector<double>>>(fpass, ",", 1);
+
+	assert(isJust(read1) && isJust(read2));
+	assert(fromJust(read1) == mat);
+	assert(std::equal(read2->begin(), read2->end(), mat.begin()));
+
+	//1行1要素
+	const auto col = map([](std::vector<double> const& row){ return row[1]; }, mat);
+	save_num(col, fpass, "\n");
+
+	std::vector<double> read3;
+	assert(load_num(read3, fpass));
+	assert(read3 == col);
+
+	//変換できない値が含まれている場合は例外が送出される
+	mat[rows / 2][1] = std::numeric_limits<double>::quiet_NaN();
+	save_num(mat, fpass, ",");
+	{
+		std::ofstream ofs(fpass, std::ios::out | std::ios::app);
+		ofs << "1,2,x,4" << std::endl;
+	}
+	caught = false;
+	try{ load_num2d<double>(fpass, ","); } catch (std::invalid_argument&){ caught = true; }
+	assert(caught);
+
+	clear_file(fpass);
+}
+
+void LoadNumReportTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	//例外を投げない変換
+	impl::Str2NumSelector<int> to_i;
+	int iv = 7;
+	assert(to_i("12") == 12);
+	assert(to_i(" -3", iv) == ParseStatus::ok && iv == -3);
+	assert(to_i("abc", iv) == ParseStatus::invalid_argument && iv == -3);
+	assert(to_i("99999999999", iv) == ParseStatus::out_of_range && iv == -3);
+	assert(to_i("", iv) == ParseStatus::invalid_argument);
+
+	double dv = 0;
+	assert(impl::Str2NumSelector<double>()(string_view("2.5e1"), dv) == ParseStatus::ok && dv == 25);
+	assert(impl::Str2NumSelector<double>()(string_view("1e-400"), dv) == ParseStatus::out_of_range && dv == 25);	// 0へのアンダーフロー (C++17 の std::from_chars と同じ結果)
+	assert(impl::Str2NumSelector<double>()(string_view("1e-310"), dv) == ParseStatus::ok && dv > 0);					// 非正規化数
+	unsigned int uv = 0;
+	assert(impl::Str2NumSelector<unsigned int>()(std::string("-1"), uv) == ParseStatus::invalid_argument);
+
+	//変換できない値の位置を記録し、読み飛ばす or 既定値で置き換える (複数のチャンクにまたがる行番号の確認のため大きなファイルを使用)
+	const int rows = 200000;
+	{
+		std::ofstream ofs(fpass);
+		for (int i = 0; i < rows; ++i){
+			if (i == 5) ofs << "1,x,3\n";
+			else if (i == rows - 10) ofs << "N/A,2,1e999\n";
+			else ofs << i << "," << i * 2 << "," << i * 3 << "\n";
+		}
+	}
+
+	ParseReport skip_report;
+	std::vector<std::vector<double>> mat;
+	assert(load_num2d(mat, fpass, ",", skip_report, 4));
+
+	assert(mat.size() == rows);
+	assert(mat[5] == (std::vector<double>{ 1, 3 }));
+	assert(mat[rows - 10] == (std::vector<double>{ 2 }));
+	assert(mat[rows - 1][2] == (rows - 1) * 3.0);
+	assert(skip_report.count() == 3 && skip_report.errors().size() == 3);
+
+	auto const& e = skip_report.errors();
+	assert(e[0].line == 6 && e[0].column == 2 && e[0].token == "x" && e[0].status == ParseStatus::invalid_argument);
+	assert(e[1].line == rows - 9 && e[1].column == 1 && e[1].token == "N/A");
+	assert(e[2].line == rows - 9 && e[2].column == 3 && e[2].status == ParseStatus::out_of_range);
+
+	ParseReport fill_report(BadTokenPolicy::fill_default, -1, 1);
+	auto mat2 = load_num2d<int>(fpass, ",", fill_report);
+
+	assert(isJust(mat2));
+	assert(fromJust(mat2)[5] == (std::vector<int>{ 1, -1, 3 }));
+	assert(fromJust(mat2)[rows - 10] == (std::vector<int>{ -1, 2, 1 }));	// 整数の場合 "1e999" は 1 と解釈される
+	assert(fill_report.count() == 2 && fill_report.errors().size() == 1);
+
+	//1行1要素
+	save_line(std::vector<std::string>{ "1", "", "3.5", "y" }, fpass);
+
+	ParseReport report1;
+	std::vector<double> read1;
+	assert(load_num(read1, fpass, "\n", report1));
+	assert(read1 == (std::vector<double>{ 1, 3.5 }));
+	assert(report1.count() == 2 && report1.errors()[0].line == 2 && report1.errors()[1].line == 4);
+
+	//区切り文字指定
+	save_line(std::string("4,z,6"), fpass, WriteMode::overwrite);
+
+	ParseReport report2(BadTokenPolicy::fill_default);
+	auto read2 = load_num<int>(fpass, ",", report2);
+	assert(fromJust(read2) == (std::vector<int>{ 4, 0, 6 }));
+	assert(report2.errors()[0].line == 1 && report2.errors()[0].column == 2);
+
+	clear_file(fpass);
+}
+
+void LibsvmTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	{
+		std::ofstream ofs(fpass);
+		ofs << "+1 1:0.5 3:1.2\n"
+			<< "-1 qid:3 2:0.8 # comment\n"
+			<< "\n"
+			<< "# comment line\n"
+			<< "0\n"								// 非ゼロ要素なし
+			<< "+1\t1:1  10:-0.25 \r\n";
+	}
+
+	auto read1 = load_libsvm<float>(fpass);
+	assert(isJust(read1));
+
+	auto const& data = fromJust(read1);
+	assert(data.rows() == 4 && data.cols() == 11 && data.nonzero_num() == 5);
+	assert(data.row_ptr() == (std::vector<sig::uint>{ 0, 2, 3, 3, 5 }));
+	assert(data.labels() == (std::vector<double>{ 1, -1, 0, 1 }));
+	assert(data[0].index(1) == 3 && data[0].value(1) == 1.2f);
+	assert(data[1].size() == 1 && data[1].index(0) == 2);
+	assert(data[2].empty());
+	assert(data[3].index(1) == 10 && data[3].value(1) == -0.25f);
+
+	//コンテナと同様に走査 (各行は (列番号, 値) の組)
+	auto row_sums = map([](SparseMatrix<float>::Row row){
+		return std::accumulate(row.begin(), row.end(), 0.0f, [](float s, std::pair<sig::uint, float> e){ return s + e.second; });
+	}, data);
+	assert(row_sums == (std::vector<float>{ 0.5f + 1.2f, 0.8f, 0, 1 - 0.25f }));
+
+	//ラベル無し・並列に変換してもファイル中の順番通りに格納される
+	const int rows = 100000;
+	SparseMatrix<double, int> expect;
+	{
+		std::ofstream ofs(fpass);
+		for (int i = 0; i < rows; ++i){
+			std::vector<std::pair<int, double>> row;
+			for (int j = 0; j < i % 5; ++j){
+				row.emplace_back(j * 7 + i % 3, (i + j) * 0.5);
+				ofs << (j ? " " : "") << row.back().first << ":" << row.back().second;
+			}
+			ofs << (row.empty() ? "0:0" : "") << "\n";
+			if (row.empty()) row.emplace_back(0, 0);
+			expect.add_row(row);
+		}
+	}
+
+	SparseMatrix<double, int> read2;
+	assert(load_libsvm(read2, fpass, 4));
+	assert(read2.labels().empty());
+	assert(read2.values() == expect.values() && read2.indices() == expect.indices() && read2.row_ptr() == expect.row_ptr());
+	assert(read2.cols() == expect.cols());
+
+	//変換できない値が含まれている場合は例外が送出される
+	save_line(std::string("1 2:abc"), fpass);
+
+	bool caught = false;
+	try{ load_libsvm(fpass); } catch (std::invalid_argument&){ caught = true; }
+	assert(caught);
+
+	clear_file(fpass);
+}
+
+void LineStreamTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	std::vector<std::string> text;
+	for (int i = 0; i < 1000; ++i) text.push_back(std::to_string(i % 10) + (i % 3 ? std::string(i % 50, 'x') : ""));
+	text.push_back("");
+	text.push_back(std::string(300, 'y'));		// バッファより長い行
+	save_line(text, fpass);
+
+	//load_line と同じ結果になるか (バッファを小さくして行の分断を再現)
+	std::vector<std::string> read1;
+	load_line(read1, fpass);
+	
+	std::vector<std::string> read2;
+	for (auto const& line : load_line_stream(fpass, 16)) read2.push_back(line);
+	assert(read2 == read1 && read2 == text);
+
+	//高階関数にそのまま渡す
+	auto lens = sig::map([](std::string const& line){ return line.size(); }, load_line_stream(fpass, 64));
+	assert(lens.size() == text.size() && lens.back() == 300);
+
+	auto xs = filter([](std::string const& line){ return line.find('x') != std::string::npos; }, load_line_stream(fpass));
+	assert(xs.size() == static_cast<sig::uint>(std::count_if(text.begin(), text.end(), [](std::string const& s){ return s.find('x') != std::string::npos; })));
+
+	//変換関数を指定し、ヒストグラムで集計
+	save_line(sig::map([](int i){ return std::to_string(i % 10); }, seqn(0, 1, 1000)), fpass);
+
+	Histgram<int, 10> hist(0, 10);
+	hist.count(load_line_stream(fpass, [](std::string const& line){ return std::stoi(line); }));
+	for (auto ct : hist.get_count()) assert(ct == 100);
+	assert(!hist.is_over_range());
+
+	//途中で中断した場合は続きから読み込む
+	auto stream = load_line_stream(fpass, [](std::string const& line){ return std::stoi(line); });
+	int sum = 0;
+	for (int v : stream){
+		if (v == 9) break;
+		sum += v;
+	}
+	assert(sum == 36 && *stream.begin() == 9);
+	assert(std::accumulate(stream.begin(), stream.end(), 0) == 4500 - 36);
+	assert(stream.begin() == stream.end());
+
+	//末尾に改行の無いファイル・空のファイル・存在しないファイル
+	{
+		std::ofstream ofs(fpass);
+		ofs << "a\nb";
+	}
+	assert(sig::map([](std::string const& s){ return s; }, load_line_stream(fpass)) == std::vector<std::string>({ "a", "b" }));
+
+	clear_file(fpass);
+	auto empty = load_line_stream(fpass);
+	assert(empty.is_open() && empty.begin() == empty.end());
+
+	auto not_exist = load_line_stream(pass + SIG_TO_FPSTR("not_exist.txt"));
+	assert(!not_exist && not_exist.begin() == not_exist.end());
+}
+
+void BinaryNumTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	//行列 (全行の列数が等しい)
+	std::vector<std::vector<double>> mat;
+	for (int i = 0; i < 100; ++i) mat.push_back({ i * 0.1, -i * 1e-300, 1.0 / (i + 1), std::numeric_limits<double>::max() });
+
+	assert(save_num_binary(mat, fpass));
+	
+	std::vector<std::vector<double>> read1;
+	assert(load_num2d_binary(read1, fpass));
+	assert(read1 == mat);
+
+	auto read2 = load_num2d_mapped<double>(fpass);
+	assert(isJust(read2));
+	auto const& view = fromJust(read2);
+	assert(view.rows() == 100 && view.cols() == 4 && !view.is_ragged() && view.size() == 400);
+	assert(view(3, 2) == mat[3][2] && view.row(99).size() == 4 && view.row(99)[3] == mat[99][3]);
+	for (sig::uint i = 0; i < view.size(); ++i) assert(view.data()[i] == mat[i / 4][i % 4]);	// 行順に連続して格納
+
+	//型が異なる場合
+	assert(!isJust(load_num2d_mapped<float>(fpass)));
+	auto read3 = load_num2d_binary<int, std::list<std::vector<int>>>(fpass);
+	assert(isJust(read3) && fromJust(read3).size() == 100 && fromJust(read3).back()[0] == 9);
+
+	//行毎に列数が異なる行列
+	const array<std::vector<int>, 4> ragged = {
+		{ 1, 2, 3 },
+		{},
+		{ 4, 5, 6, 7 },
+		{ -8 }
+	};
+	assert(save_num_binary(ragged, fpass));
+
+	auto read4 = load_num2d_binary<int>(fpass);
+	assert(isJust(read4));
+	assert(fromJust(read4) == std::vector<std::vector<int>>({ { 1, 2, 3 }, {}, { 4, 5, 6, 7 }, { -8 } }));
+
+	auto read5 = load_num2d_mapped<int>(fpass);
+	assert(isJust(read5));
+	auto const& rview = fromJust(read5);
+	assert(rview.is_ragged() && rview.rows() == 4 && rview.cols() == 0 && rview.size() == 8);
+	assert(rview.row(1).empty() && rview.row(2).size() == 4 && rview(2, 3) == 7 && rview(3, 0) == -8);
+
+	//テキスト形式のファイル・存在しないファイル
+	save_num(mat, fpass, ",");
+	std::vector<std::vector<double>> read6;
+	assert(!load_num2d_binary(read6, fpass));
+	assert(!isJust(load_num2d_mapped<double>(fpass)));
+	assert(!isJust(load_num2d_binary<double>(pass + SIG_TO_FPSTR("not_exist.txt"))));
+
+#if SIG_LINUX_ENV
+	//閉じる際の最後の書き込みに失敗した場合
+	assert(!save_num_binary(mat, SIG_TO_FPSTR("/dev/full")));
+#endif
+
+	//ヘッダが壊れたファイル (行数・列数の積や行の位置の表の長さがオーバーフローする値)
+	auto corrupt = [&](std::uint8_t ragged, std::uint64_t rows, std::uint64_t cols, std::uint64_t elements){
+		save_num_binary(std::vector<std::vector<int>>{ { 1, 2 }, { 3, 4 } }, fpass);
+
+		std::fstream fs(fpass, std::ios::in | std::ios::out | std::ios::binary);
+		impl::BinaryNumHeader header;
+		fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+		header.ragged = ragged;
+		header.rows = rows;
+		header.cols = cols;
+		header.elements = elements;
+		fs.seekp(0);
+		fs.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	};
+	corrupt(0, 1ull << 32, 1ull << 32, 0);
+	assert(!isJust(load_num2d_mapped<int>(fpass)) && !isJust(load_num2d_binary<int>(fpass)));
+	corrupt(0, 0, 0, 4);
+	assert(!isJust(load_num2d_mapped<int>(fpass)));
+	corrupt(1, ~0ull, 0, 4);
+	assert(!isJust(load_num2d_mapped<int>(fpass)) && !isJust(load_num2d_binary<int>(fpass)));
+	corrupt(0, 4, 1, 4);
+	assert(isJust(load_num2d_mapped<int>(fpass)) && fromJust(load_num2d_mapped<int>(fpass)).rows() == 4);
+
+	clear_file(fpass);
+}
+
+void LineWriterTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	//save_line で1行ずつ保存した場合と同じ内容になるか (バッファを小さくして書き込みスレッドへの受け渡しを多発させる)
+	std::vector<std::string> expect;
+	{
+		LineWriter writer(fpass, WriteMode::overwrite, 64, 2);
+		assert(writer.is_open());
+
+		for (int i = 0; i < 10000; ++i){
+			std::ostringstream oss;
+			oss << i * 0.1;
+			writer.write("line " + std::to_string(i));
+			save_line(i * 0.1, writer);
+			expect.push_back("line " + std::to_string(i));
+			expect.push_back(oss.str());
+		}
+		writer.write(std::string(200, 'z'));	// バッファより長い行
+		expect.push_back(std::string(200, 'z'));
+
+		//flush後はファイルに反映されている
+		assert(writer.flush());
+		assert(fromJust(load_line(fpass)) == expect);
+	}	// デストラクタで閉じる
+
+	//追記モード・コンテナの保存
+	const std::vector<std::string> tail{ "", "HAIL TO YOU,MY FELLOW." };
+	{
+		LineWriter writer(fpass, WriteMode::append);
+		save_line(tail, writer);
+		writer.write(string_view("KEEP YOUR DIGNITY."));
+		assert(writer.close() && !writer.is_open());
+	}
+	expect.insert(expect.end(), tail.begin(), tail.end());
+	expect.push_back("KEEP YOUR DIGNITY.");
+	assert(fromJust(load_line(fpass)) == expect);
+
+	//開けないファイル
+	LineWriter bad(pass + SIG_TO_FPSTR("not_exist/test.txt"));
+	assert(!bad);
+	bad.write("discarded");
+	assert(!bad.flush());
+
+#if SIG_LINUX_ENV
+	//書き込みに失敗した場合は close() も失敗を返す
+	{
+		LineWriter full("/dev/full");
+		full.write("lost");
+		assert(!full.close());
+	}
+#endif
+
+	clear_file(fpass);
+}
+
+void ScanFileNamesTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+
+#if SIG_USE_BOOST_FILESYSTEM && SIG_ENABLE_BOOST
+	//直下のファイルのみ (get_file_names と同じ結果になるか)
+	auto texts = scan_file_names(pass, SIG_TO_FPSTR("*.txt"), false);
+	assert(isJust(texts));
+
+	const auto visible = get_file_names(pass, false, L".txt");
+	std::set<std::wstring> t_texts;
+	for (auto const& fn : fromJust(visible)){
+		if (fn.find(L".txt") == fn.size() - 4) t_texts.insert(fn);
+	}
+	assert(fromJust(texts).size() == t_texts.size());
+	for (auto const& fn : fromJust(texts)) assert(t_texts.count(str_to_wstr(fn)));
+	assert(std::is_sorted(fromJust(texts).begin(), fromJust(texts).end()));
+
+	//サブディレクトリを含む走査
+	const auto root = pass + SIG_TO_FPSTR("scan_test/");
+	const std::vector<FilepassString> files{
+		SIG_TO_FPSTR("a.txt"),
+		SIG_TO_FPSTR("b.dat"),
+		SIG_TO_FPSTR("sub/c.txt"),
+		SIG_TO_FPSTR("sub/sub2/d.txt"),
+		SIG_TO_FPSTR("sub/sub2/e.old.txt"),
+		SIG_TO_FPSTR(".hidden/f.txt")
+	};
+	fs::create_directories(root + SIG_TO_FPSTR("sub/sub2"));
+	fs::create_directories(root + SIG_TO_FPSTR(".hidden"));
+	for (auto const& f : files) save_line(std::string("dummy"), root + f);
+
+	auto all = scan_file_names(root);
+	assert(isJust(all));
+	assert(fromJust(all) == std::vector<FilepassString>({ SIG_TO_FPSTR("a.txt"), SIG_TO_FPSTR("b.dat"), SIG_TO_FPSTR("sub/c.txt"), SIG_TO_FPSTR("sub/sub2/d.txt"), SIG_TO_FPSTR("sub/sub2/e.old.txt") }));
+
+	auto single = scan_file_names(root, SIG_TO_FPSTR("?.txt"), true, false, 1);
+	assert(fromJust(single) == std::vector<FilepassString>({ SIG_TO_FPSTR("a.txt"), SIG_TO_FPSTR("sub/c.txt"), SIG_TO_FPSTR("sub/sub2/d.txt") }));
+
+	auto with_hidden = scan_file_names(root, SIG_TO_FPSTR("*.txt"), true, true);
+	assert(fromJust(with_hidden).size() == 5 && fromJust(with_hidden)[0] == SIG_TO_FPSTR(".hidden/f.txt"));
+
+	auto old = scan_file_names(root, SIG_TO_FPSTR("*.old*"));
+	assert(fromJust(old) == std::vector<FilepassString>({ SIG_TO_FPSTR("sub/sub2/e.old.txt") }));
+
+	auto folders = scan_folder_names(root);
+	assert(fromJust(folders) == std::vector<FilepassString>({ SIG_TO_FPSTR("sub"), SIG_TO_FPSTR("sub/sub2") }));
+	assert(fromJust(scan_folder_names(root, SIG_TO_FPSTR(""), false, true)) == std::vector<FilepassString>({ SIG_TO_FPSTR(".hidden"), SIG_TO_FPSTR("sub") }));
+
+	assert(!isJust(scan_file_names(pass + SIG_TO_FPSTR("not_exist"))));
+
+	fs::remove_all(root);
+#endif
+}
+
+void CsvTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+	{
+		std::ofstream ofs(fpass, std::ios::binary);
+		ofs << "id,name,score,memo\r\n"
+			<< "1,\"Smith, John\",82.5,\r\n"
+			<< "2,\"say \"\"hello\"\"\",90,\"multi\nline\"\n"
+			<< "\n"
+			<< "3,plain,-1e3,\"\"\n"
+			<< "4,short";
+	}
+
+	//全ての列を取得
+	CsvReader csv(fpass);
+	assert(csv.is_open());
+	assert(csv.next() && csv.size() == 4 && csv[0] == "id" && csv[3] == "memo");
+	assert(csv.next() && csv.size() == 4 && csv[1] == "Smith, John" && csv.get<double>(2) == 82.5 && csv[3].empty());
+	assert(csv.next() && csv[1] == "say \"hello\"" && csv.get<std::string>(3) == "multi\nline" && csv.get<int>(0) == 2);
+	assert(csv.next() && csv[1] == "plain" && csv.get<double>(2) == -1000 && csv[3].empty());
+	assert(csv.next() && csv.size() == 2 && csv[1] == "short" && csv[2].empty());
+	assert(!csv.next() && csv.record_num() == 5);
+
+	//列を指定して取得 (指定していない列は変換しない)
+	CsvReader csv2(fpass);
+	csv2.next();
+	csv2.select({ 2, 0 });
+	std::vector<double> scores;
+	while (csv2.next()){
+		assert(csv2.size() == 2);
+		if (!csv2[0].empty()) scores.push_back(csv2.get<double>(0));
+	}
+	assert(scores == std::vector<double>({ 82.5, 90, -1000 }));
+
+	//型を指定して列ごとに読み込み
+	auto cols = load_csv_columns<int, std::string>(fpass, { { 0, 1 } }, ',', true);
+	assert(isJust(cols));
+	assert(std::get<0>(fromJust(cols)) == std::vector<int>({ 1, 2, 3, 4 }));
+	assert(std::get<1>(fromJust(cols)) == std::vector<std::string>({ "Smith, John", "say \"hello\"", "plain", "short" }));
+
+	//同じ列を複数回指定
+	auto dup = load_csv_columns<std::string, int, std::string>(fpass, { { 1, 0, 1 } }, ',', true);
+	assert(isJust(dup) && std::get<0>(fromJust(dup)) == std::get<1>(fromJust(cols)) && std::get<2>(fromJust(dup)) == std::get<1>(fromJust(cols)));
+	assert(std::get<1>(fromJust(dup)) == std::get<0>(fromJust(cols)));
+
+	//TSV・大量の行 (load_num2d と同じ結果になるか)
+	std::vector<std::vector<double>> mat;
+	for (int i = 0; i < 20000; ++i) mat.push_back({ i * 0.5, -i * 2.0, 1.0 / 8 });
+	save_num(mat, fpass, "\t");
+
+	auto tsv = load_csv_columns<double, double, double>(fpass, { { 0, 1, 2 } }, '\t');
+	auto read = load_num2d<double>(fpass, "\t");
+	assert(isJust(tsv) && isJust(read));
+	assert(std::get<0>(fromJust(tsv)).size() == mat.size());
+	for (sig::uint i = 0; i < mat.size(); ++i){
+		assert(std::get<0>(fromJust(tsv))[i] == fromJust(read)[i][0] && std::get<1>(fromJust(tsv))[i] == fromJust(read)[i][1] && std::get<2>(fromJust(tsv))[i] == fromJust(read)[i][2]);
+	}
+
+	//変換できない値・存在しないファイル
+	save_line(std::vector<std::string>{ "1,x" }, fpass);
+	bool thrown = false;
+	try{ load_csv_columns<int, int>(fpass, { { 0, 1 } }); }
+	catch (std::invalid_argument const&){ thrown = true; }
+	assert(thrown);
+	assert(!isJust(load_csv_columns<int>(pass + SIG_TO_FPSTR("not_exist.txt"), { { 0 } })));
+
+	clear_file(fpass);
+}
+
+void TailReaderTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+	const auto cpass = pass + SIG_TO_FPSTR("tail.checkpoint");
+
+	save_line(std::vector<std::string>{ "a", "b", "c" }, fpass);
+
+	TailReader reader(fpass);
+	assert(reader.poll() == std::vector<std::string>({ "a", "b", "c" }));
+	assert(reader.poll().empty());
+
+	//追記された行のみ (書き込み途中の行は次回)
+	save_line(std::vector<std::string>{ "d", "" }, fpass, WriteMode::append);
+	{
+		std::ofstream ofs(fpass, std::ios::out | std::ios::app);
+		ofs << "par";
+	}
+	std::list<std::string> read1;
+	assert(reader.poll(read1) == 2 && read1 == std::list<std::string>({ "d", "" }));
+	save_line("tial", fpass, WriteMode::append);
+	assert(reader.poll() == std::vector<std::string>({ "partial" }));
+
+	//読み込み位置の保存と復元 (複数のスレッドから同じパスに保存しても一時ファイルが衝突しない)
+	{
+		std::vector<std::thread> ths;
+		std::atomic<int> ng(0);
+		for (int t = 0; t < 4; ++t) ths.emplace_back([&]{ for (int i = 0; i < 50; ++i) if (!reader.save_checkpoint(cpass)) ++ng; });
+		for (auto& th : ths) th.join();
+		assert(ng == 0);
+	}
+	save_line("e", fpass, WriteMode::append);
+
+	TailReader reader2(fpass);
+	assert(reader2.load_checkpoint(cpass) && reader2.offset() == reader.offset());
+	assert(reader2.poll() == std::vector<std::string>({ "e" }));
+
+	//切り詰められた場合は先頭から
+	save_line("x", fpass);
+	assert(reader2.poll() == std::vector<std::string>({ "x" }));
+
+#if SIG_LINUX_ENV
+	//ローテーションされた場合は旧ファイルの残りを読み切ってから新しいファイルへ
+	const auto rotated = pass + SIG_TO_FPSTR("test7.txt.1");
+	save_line("y", fpass, WriteMode::append);
+	std::rename(fpass.c_str(), rotated.c_str());
+	save_line("new", fpass);
+
+	assert(reader2.poll() == std::vector<std::string>({ "y", "new" }));
+	assert(reader2.poll().empty());
+	std::remove(rotated.c_str());
+
+	//保存後にファイルが置き換えられていた場合
+	assert(reader.load_checkpoint(cpass) && reader.offset() == 0);
+	assert(reader.poll() == std::vector<std::string>({ "new" }));
+#endif
+
+	assert(!reader.load_checkpoint(pass + SIG_TO_FPSTR("not_exist.txt")));
+#if SIG_MSVC_ENV
+	_wremove(cpass.c_str());
+#else
+	std::remove(cpass.c_str());
+#endif
+	clear_file(fpass);
+}
+
+void ConcurrentAppenderTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+	const int thread_num = 8;
+	const int line_num = 20000;
+
+	clear_file(fpass);
+	std::uint64_t bytes = 0;
+	{
+		ConcurrentAppender appender(fpass, WriteMode::append, 256);
+		assert(appender.is_open());
+
+		std::vector<std::thread> workers;
+		for (int t = 0; t < thread_num; ++t){
+			workers.emplace_back([&, t]{
+				for (int i = 0; i < line_num; ++i){
+					if (i % 100 == 0) save_line(std::vector<std::string>{ "block" + std::to_string(t), "block" + std::to_string(t) + "-end" }, appender);
+					else appender.write(std::to_string(t) + ":" + std::to_string(i));
+				}
+			});
+		}
+		for (auto& w : workers) w.join();
+
+		//flush後はファイルに反映されている
+		assert(appender.flush());
+		assert(appender.lines_written() == thread_num * (line_num + line_num / 100));
+		bytes = appender.bytes_written();
+
+		save_line(0.5, appender);
+	}
+
+	//行が途中で混ざっていないか, スレッド毎の順序が保たれているか
+	auto read = fromJust(load_line(fpass));
+	assert(read.size() == thread_num * (line_num + line_num / 100) + 1 && read.back() == "0.5");
+
+	std::vector<int> next(thread_num, 0);
+	sig::uint total = 0;
+	for (sig::uint i = 0; i + 1 < read.size(); ++i){
+		auto const& line = read[i];
+		total += line.size() + 1;
+
+		if (line.compare(0, 5, "block") == 0){
+			const int t = line[5] - '0';
+			assert(line.size() == 6 && read[i + 1] == line + "-end");
+			assert(next[t] % 100 == 0);
+			++next[t];
+			total += read[++i].size() + 1;
+			continue;
+		}
+		const auto pos = line.find(':');
+		const int t = std::stoi(line.substr(0, pos));
+		const int v = std::stoi(line.substr(pos + 1));
+		assert(v == next[t]);
+		++next[t];
+	}
+	assert(total == bytes);
+	for (auto n : next) assert(n == line_num);
+
+	//文字列以外の要素を持つコンテナ (save_line と同じ出力形式)
+	{
+		ConcurrentAppender appender(fpass, WriteMode::overwrite);
+		save_line(std::vector<int>{ 1, -2, 3 }, appender);
+		save_line(std::list<double>{ 0.25 }, appender);
+		appender.write(std::vector<char const*>{ "x" });
+	}
+	assert(fromJust(load_line(fpass)) == std::vector<std::string>({ "1", "-2", "3", "0.25", "x" }));
+
+	clear_file(fpass);
+}
+
+void BatchLoadTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+
+	std::vector<FilepassString> passes;
+	for (int i = 0; i < 40; ++i){
+		passes.push_back(pass + SIG_TO_FPSTR("batch") + to_fpstring(i) + SIG_TO_FPSTR(".txt"));
+		save_num(std::vector<int>(i + 1, i), passes.back(), "\n");
+	}
+
+	auto loader = [](FilepassString const& fpass){ return load_num<int>(fpass, "\n", 1); };
+
+	//入力と同じ順番で結果を返す
+	auto read1 = load_batch(passes, loader, 8);
+	assert(read1.size() == passes.size());
+	for (int i = 0; i < 40; ++i) assert(isJust(read1[i]) && fromJust(read1[i]) == std::vector<int>(i + 1, i));
+
+	//読み込みが完了した順に結果を受け取る
+	std::vector<int> seen(passes.size(), 0);
+	load_batch_each(passes, loader, [&](sig::uint i, Maybe<std::vector<int>> nums){
+		assert(fromJust(nums) == std::vector<int>(i + 1, i));
+		++seen[i];
+	}, 8);
+	assert(std::all_of(seen.begin(), seen.end(), [](int n){ return n == 1; }));
+
+	//読み込み中の例外は呼び出し元に再送出される
+	passes.push_back(pass + SIG_TO_FPSTR("not_exist.txt"));
+	auto strict_loader = [](FilepassString const& fpass){
+		std::vector<std::string> lines;
+		if (!load_line(lines, fpass) && lines.empty()) throw std::runtime_error("open error");
+		return lines;
+	};
+
+	bool caught = false;
+	try{ load_batch(passes, strict_loader, 4); } catch (std::runtime_error&){ caught = true; }
+	assert(caught);
+
+	caught = false;
+	try{ load_batch_each(passes, strict_loader, [](sig::uint, std::vector<std::string>){}, 4); } catch (std::runtime_error&){ caught = true; }
+	assert(caught);
+
+	passes.pop_back();
+	for (auto const& fpass : passes){
+#if SIG_MSVC_ENV
+		_wremove(fpass.c_str());
+#else
+		std::remove(fpass.c_str());
+#endif
+	}
+}
+
+void NumCacheTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+	const auto cache_dir = pass + SIG_TO_FPSTR("num_cache");
+#if SIG_MSVC_ENV
+	auto cache_file = [&](std::wstring const& name){ return cache_dir + L"/" + name; };
+#else
+	auto cache_file = [&](std::wstring const& name){ return cache_dir + "/" + wstr_to_str(name); };
+#endif
+
+	std::vector<std::vector<double>> mat;
+	for (int i = 0; i < 1000; ++i) mat.push_back({ i * 0.5, -i * 1.25, static_cast<double>(i % 7) });
+	save_num(mat, fpass, ",");
+
+	NumCache cache(cache_dir);
+
+	//初回はテキストを変換してキャッシュを作成し、2回目以降はキャッシュから読み込む
+	auto read1 = cache.load_num2d<double>(fpass, ",");
+	assert(isJust(read1) && fromJust(read1) == mat);
+
+	auto files = get_file_names(cache_dir, false);
+	assert(isJust(files) && fromJust(files).size() == 1);
+
+	auto read2 = cache.load_num2d<double, std::deque<std::vector<double>>>(fpass, ",");
+	assert(isJust(read2) && std::equal(read2->begin(), read2->end(), mat.begin()));
+
+	auto mapped = cache.load_num2d_mapped<double>(fpass, ",");
+	assert(isJust(mapped) && mapped->rows() == mat.size() && (*mapped)(999, 1) == -999 * 1.25);
+	assert(fromJust(get_file_names(cache_dir, false)).size() == 1);
+
+	//型・区切り文字が異なる場合は別のキャッシュ
+	auto read3 = cache.load_num2d<float>(fpass, ",");
+	assert(isJust(read3) && fromJust(read3)[10][1] == -12.5f);
+	assert(fromJust(get_file_names(cache_dir, false)).size() == 2);
+
+	//キャッシュから読み込んでいることの確認 (キャッシュの要素を書き換える)
+	const auto double_cache = cache_file(fromJust(files)[0]);
+	{
+		std::fstream fs(double_cache, std::ios::in | std::ios::out | std::ios::binary);
+		const double v = 12345;
+		fs.seekp(64);
+		fs.write(reinterpret_cast<char const*>(&v), sizeof(v));
+	}
+	assert(fromJust(cache.load_num2d<double>(fpass, ","))[0][0] == 12345);
+
+	//キーが一致しないキャッシュ (ハッシュ値の衝突・キーの無いファイル) は使用せずに変換し直す
+	files = get_file_names(cache_dir, false);
+	for (auto const& fn : fromJust(files)){
+		if (cache_file(fn) == double_cache) continue;
+		std::ifstream ifs(cache_file(fn), std::ios::in | std::ios::binary);
+		std::ofstream ofs(double_cache, std::ios::out | std::ios::binary | std::ios::trunc);
+		ofs << ifs.rdbuf();
+	}
+	assert(fromJust(cache.load_num2d<double>(fpass, ",")) == mat);
+
+	std::vector<std::vector<double>> dummy{ { 1, 2, 3 } };
+	save_num_binary(dummy, double_cache);
+	assert(fromJust(cache.load_num2d<double>(fpass, ",")) == mat);
+
+	//元ファイルが更新された場合は変換し直す
+	mat.push_back({ 1, 2, 3, 4 });
+	save_num(mat, fpass, ",");
+	assert(fromJust(cache.load_num2d<double>(fpass, ",")) == mat);
+
+	//1次元
+	std::vector<int> nums{ 3, 1, 4, 1, 5, 9, 2, 6 };
+	save_num(nums, fpass, "\n");
+
+	auto read4 = cache.load_num<int>(fpass);
+	auto read5 = cache.load_num<int, std::set<int>>(fpass);
+	assert(fromJust(read4) == nums);
+	assert(fromJust(read5) == std::set<int>(nums.begin(), nums.end()));
+
+	//結果が空の場合もキャッシュする
+	save_line("", fpass);
+	const auto file_num = fromJust(get_file_names(cache_dir, false)).size();
+	assert(isNothing(cache.load_num<int>(fpass, ",")));
+	assert(fromJust(get_file_names(cache_dir, false)).size() == file_num + 1);
+	assert(isNothing(cache.load_num<int>(fpass, ",")));
+
+	//存在しないファイル
+	assert(isNothing(cache.load_num2d<double>(pass + SIG_TO_FPSTR("not_exist.txt"), ",")));
+
+	files = get_file_names(cache_dir, false);
+	for (auto const& fn : fromJust(files)){
+#if SIG_MSVC_ENV
+		_wremove(cache_file(fn).c_str());
+#else
+		std::remove(cache_file(fn).c_str());
+#endif
+	}
+#if SIG_MSVC_ENV
+	RemoveDirectoryW(cache_dir.c_str());
+#else
+	rmdir(cache_dir.c_str());
+#endif
+	clear_file(fpass);
+}
+
+void LineIndexTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+
+	std::vector<std::string> src;
+	for (int i = 0; i < 5000; ++i) src.push_back(i % 100 == 0 ? "" : "line " + std::to_string(i) + std::string(i % 13, '*'));
+	save_line(src, fpass);
+
+	//load_line (std::string の場合はメモリマップから直接読み込む) も同じ行を返す
+	std::vector<std::string> lines;
+	assert(load_line(lines, fpass) && lines == src);
+	std::vector<std::wstring> wlines;
+	assert(load_line(wlines, fpass) && wlines.size() == src.size());
+	assert(!load_line(wlines, pass + SIG_TO_FPSTR("not_exist.txt")));
+	assert(fromJust(load_line(fpass)) == src);
+	assert(fromJust(load_line<std::wstring>(fpass)).size() == src.size());
+
+	//初回はファイルを走査して索引を作成・保存
+	{
+		LineIndex index(fpass);
+		assert(index.is_open() && index.size() == src.size());
+		assert(fromJust(index.line(0)) == src[0] && fromJust(index.line(1234)) == src[1234] && fromJust(index.line(4999)) == src[4999]);
+		assert(isNothing(index.line(5000)));
+
+		assert(index.lines(2000, 100) == std::vector<std::string>(src.begin() + 2000, src.begin() + 2100));
+		assert(index.lines(4990, 100) == std::vector<std::string>(src.begin() + 4990, src.end()));
+		assert(index.lines(5000, 10).empty());
+
+		std::deque<std::string> dq;
+		assert(index.read_lines(dq, 10, 3) == 3 && dq[2] == src[12]);
+	}
+	//2回目以降は保存した索引を使用
+	{
+		LineIndex index(fpass);
+		assert(index.size() == src.size() && fromJust(index.line(4321)) == src[4321]);
+
+		std::uint64_t bytes = 0;
+		for (auto const& s : src) bytes += s.size() + 1;
+		assert(index.offset(0) == 0 && index.offset(index.size()) == bytes);
+	}
+	//元ファイルが更新された場合は作り直す (末尾に改行の無い行を含む)
+	src.resize(10);
+	save_line(src, fpass);
+	{
+		std::ofstream ofs(fpass, std::ios::app);
+		ofs << "tail";
+	}
+	{
+		LineIndex index(fpass, false);
+		assert(index.size() == 11 && fromJust(index.line(9)) == src[9] && fromJust(index.line(10)) == "tail");
+		assert(index.lines(8, 5) == std::vector<std::string>({ src[8], src[9], "tail" }));
+	}
+
+	//並列スレッドからの読み込み
+	{
+		LineIndex index(fpass);
+		std::vector<std::thread> ths;
+		std::atomic<int> ng(0);
+		for (int t = 0; t < 4; ++t) ths.emplace_back([&]{ for (sig::uint i = 0; i < index.size(); ++i) if (isNothing(index.line(i))) ++ng; });
+		for (auto& th : ths) th.join();
+		assert(ng == 0);
+	}
+	//壊れた索引は使用せずに作り直す (行数が大きすぎる, 開始位置が昇順でない)
+	{
+		LineIndex index(fpass);
+		auto corrupt = [&](std::streamoff pos, std::uint64_t value){
+			std::fstream fs(index.index_pass(), std::ios::in | std::ios::out | std::ios::binary);
+			fs.seekp(pos);
+			fs.write(reinterpret_cast<char const*>(&value), sizeof(value));
+		};
+		corrupt(32, std::uint64_t(1) << 62);
+		{
+			LineIndex reloaded(fpass);
+			assert(reloaded.size() == 11 && fromJust(reloaded.line(10)) == "tail");
+		}
+		corrupt(sizeof(impl::LineIndexHeader) + 4, ~std::uint64_t(0));
+		{
+			LineIndex reloaded(fpass);
+			assert(reloaded.size() == 11 && fromJust(reloaded.line(1)) == src[1] && fromJust(reloaded.line(2)) == src[2]);
+		}
+
+#if SIG_MSVC_ENV
+		_wremove(index.index_pass().c_str());
+#else
+		std::remove(index.index_pass().c_str());
+#endif
+	}
+
+	//存在しないファイル
+	assert(!LineIndex(pass + SIG_TO_FPSTR("not_exist.txt")).is_open());
+
+	clear_file(fpass);
+}
+
+void ExternalSortTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test7.txt");
+	const auto dpass = pass + SIG_TO_FPSTR("test.sorted.txt");
+
+	std::mt19937 rng(7);
+	std::vector<std::string> src;
+	for (int i = 0; i < 100000; ++i) src.push_back(std::to_string(rng() % 50000) + "," + std::string(rng() % 8, 'a' + i % 26));
+	save_line(src, fpass);
+
+	//複数のランに分けてソート (memory_size を小さくする)
+	assert(sort_file(fpass, dpass, std::less<string_view>(), false, 1 << 17, 4));
+	auto sorted = src;
+	std::sort(sorted.begin(), sorted.end());
+	assert(fromJust(load_line(dpass)) == sorted);
+
+	//重複の除去, 比較関数の指定
+	assert(sort_file(fpass, dpass, [](string_view a, string_view b){ return a > b; }, true, 1 << 17));
+	auto uniqued = sorted;
+	uniqued.erase(std::unique(uniqued.begin(), uniqued.end()), uniqued.end());
+	std::reverse(uniqued.begin(), uniqued.end());
+	assert(fromJust(load_line(dpass)) == uniqued);
+
+	//キーを指定 (安定ソート. 重複の除去では最初の行が残る)
+	auto key = [](string_view line){ return std::stoi(std::string(line.data(), line.find(','))); };
+	assert(sort_file_by_key(fpass, dpass, key, false, 1 << 17));
+	auto by_key = src;
+	std::stable_sort(by_key.begin(), by_key.end(), [&](std::string const& a, std::string const& b){ return key(a) < key(b); });
+	assert(fromJust(load_line(dpass)) == by_key);
+
+	assert(sort_file_by_key(fpass, dpass, key, true, 1 << 17));
+	by_key.erase(std::unique(by_key.begin(), by_key.end(), [&](std::string const& a, std::string const& b){ return key(a) == key(b); }), by_key.end());
+	assert(fromJust(load_line(dpass)) == by_key);
+
+	//ランが128個を超える場合 (段階的なマージでも安定で、重複の除去では最初の行が残る)
+	{
+		std::vector<std::string> many;
+		char line[32];
+		for (int i = 0; i < 700000; ++i){
+			std::sprintf(line, "k%02u %010d", static_cast<unsigned>(rng() % 100), i);
+			many.push_back(line);
+		}
+		save_line(many, fpass);
+
+		auto prefix = [](string_view line){ return line.substr(0, 3); };
+		assert(sort_file_by_key(fpass, dpass, prefix, false, 1));
+		auto expect = many;
+		std::stable_sort(expect.begin(), expect.end(), [&](std::string const& a, std::string const& b){ return prefix(a) < prefix(b); });
+		assert(fromJust(load_line(dpass)) == expect);
+
+		assert(sort_file_by_key(fpass, dpass, prefix, true, 1));
+		expect.erase(std::unique(expect.begin(), expect.end(), [&](std::string const& a, std::string const& b){ return prefix(a) == prefix(b); }), expect.end());
+		assert(fromJust(load_line(dpass)) == expect);
+
+		save_line(src, fpass);
+	}
+
+	//メモリに収まる場合, 同じファイルへの出力
+	assert(sort_file(fpass, fpass));
+	assert(fromJust(load_line(fpass)) == sorted);
+
+	//空のファイル, 存在しないファイル
+	clear_file(fpass);
+	assert(sort_file(fpass, dpass) && isNothing(load_line(dpass)));
+	assert(!sort_file(pass + SIG_TO_FPSTR("not_exist.txt"), dpass));
+
+	//一時ファイルが残っていないこと
+	auto files = get_file_names(pass, false);
+	for (auto const& fn : fromJust(files)) assert(fn.find(L"tmp") == std::wstring::npos && fn.find(L".run") == std::wstring::npos);
+
+#if SIG_MSVC_ENV
+	_wremove(dpass.c_str());
+#else
+	std::remove(dpass.c_str());
+#endif
+}
+
+void DirectoryWatcherTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto dir = pass + SIG_TO_FPSTR("watch");
+#if SIG_MSVC_ENV
+	CreateDirectoryW(dir.c_str(), nullptr);
+	auto file = [&](std::wstring const& name){ return dir + L"/" + name; };
+#else
+	mkdir(dir.c_str(), 0755);
+	auto file = [&](std::wstring const& name){ return dir + "/" + wstr_to_str(name); };
+#endif
+	auto sorted = [](std::vector<FileChange> const& changes){
+		std::vector<std::pair<int, std::wstring>> tmp;
+		for (auto const& c : changes) tmp.push_back(std::make_pair(static_cast<int>(c.event), c.name));
+		std::sort(tmp.begin(), tmp.end());
+		return tmp;
+	};
+	const int created = static_cast<int>(FileEvent::created), modified = static_cast<int>(FileEvent::modified), removed = static_cast<int>(FileEvent::removed);
+
+	save_line("a", file(L"a.txt"));
+	save_line("x", file(L"x.dat"));
+
+	DirectoryWatcher watcher(dir, false, L".txt");
+	assert(watcher.is_open() && watcher.files() == std::vector<std::wstring>{ L"a.txt" });
+	assert(watcher.poll().empty());
+
+	//拡張子・隠しファイルの条件に合わないファイルは無視される
+	save_line("b", file(L"b.txt"));
+	save_line("c", file(L"c.dat"));
+	save_line("h", file(L".hidden.txt"));
+	save_line("a2", file(L"a.txt"), WriteMode::append);
+
+	auto changes = sorted(watcher.poll(1000));
+	assert((changes == std::vector<std::pair<int, std::wstring>>{ { created, L"b.txt" }, { modified, L"a.txt" } }));
+	assert((watcher.files() == std::vector<std::wstring>{ L"a.txt", L"b.txt" }) && watcher.contains(L"b.txt"));
+
+	//1回の poll() の間の変更はファイル毎にまとめられる
+	save_line("t", file(L"tmp.txt"));
+	save_line("t2", file(L"tmp.txt"), WriteMode::append);
+	clear_file(file(L"b.txt"));
+#if SIG_MSVC_ENV
+	_wremove(file(L"tmp.txt").c_str());
+	_wrename(file(L"a.txt").c_str(), file(L"d.txt").c_str());
+#else
+	std::remove(file(L"tmp.txt").c_str());
+	std::rename(file(L"a.txt").c_str(), file(L"d.txt").c_str());
+#endif
+	changes = sorted(watcher.poll(1000));
+	assert((changes == std::vector<std::pair<int, std::wstring>>{ { created, L"d.txt" }, { modified, L"b.txt" }, { removed, L"a.txt" } }));
+	assert((watcher.files() == std::vector<std::wstring>{ L"b.txt", L"d.txt" }));
+	assert(watcher.poll(10).empty());
+
+	//別スレッドで待機中に変更
+	std::thread th([&]{
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		save_line("e", file(L"e.txt"));
+	});
+	changes = sorted(watcher.poll(5000));
+	th.join();
+	assert((changes == std::vector<std::pair<int, std::wstring>>{ { created, L"e.txt" } }));
+	while (!watcher.poll(10).empty());	// 書き込み中の変更
+
+	//監視中のディレクトリの削除
+	for (auto name : { L"b.txt", L"d.txt", L"e.txt", L"c.dat", L"x.dat", L".hidden.txt" }){
+#if SIG_MSVC_ENV
+		_wremove(file(name).c_str());
+#else
+		std::remove(file(name).c_str());
+#endif
+	}
+#if SIG_MSVC_ENV
+	RemoveDirectoryW(dir.c_str());
+#else
+	rmdir(dir.c_str());
+#endif
+	changes = sorted(watcher.poll(1000));
+	for (int i = 0; i < 10 && watcher.is_open(); ++i){
+		auto more = sorted(watcher.poll(100));
+		changes.insert(changes.end(), more.begin(), more.end());
+	}
+	assert(!watcher.is_open() && watcher.files().empty());
+	assert((changes == std::vector<std::pair<int, std::wstring>>{ { removed, L"b.txt" }, { removed, L"d.txt" }, { removed, L"e.txt" } }));
+
+	//存在しないディレクトリ
+	assert(!DirectoryWatcher(pass + SIG_TO_FPSTR("not_exist")).is_open());
+}
+
+void MappedVectorTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test.vec");
+
+	//作成して要素を追加
+	{
+		MappedVector<double> vec(fpass);
+		assert(vec.is_open() && !vec.read_only() && vec.empty());
+
+		for (int i = 0; i < 100000; ++i) vec.push_back(i * 0.5);
+		assert(vec.size() == 100000 && vec.capacity() >= vec.size() && vec[1234] == 617 && vec.back() == 99999 * 0.5);
+
+		//書き込み可能なインスタンスは1つのみ
+		assert(!MappedVector<double>(fpass).is_open());
+
+		//開けなかったインスタンスへの変更は例外となる (ファイルに反映されないまま成功しない)
+		MappedVector<double> locked(fpass);
+		bool thrown = false;
+		try{ locked.push_back(1); }
+		catch (std::logic_error const&){ thrown = true; }
+		assert(thrown && locked.empty() && !locked.is_open());
+	}
+	//開き直すと前回の内容を参照できる
+	{
+		MappedVector<double> vec(fpass);
+		assert(vec.size() == 100000 && vec[99999] == 99999 * 0.5);
+
+		//書き込み中のファイルを読み込み専用で開き、追加された要素を参照
+		MappedVector<double> reader(fpass, true);
+		assert(reader.is_open() && reader.read_only() && reader.size() == 100000);
+
+		for (int i = 0; i < 200000; ++i) vec.push_back(-1);
+		assert(reader.size() == 100000);
+		assert(reader.refresh() == 200000 && reader.size() == 300000 && reader[299999] == -1);
+		assert(reader.refresh() == 0);
+
+		bool thrown = false;
+		try{ reader.push_back(1); }
+		catch (std::logic_error const&){ thrown = true; }
+		assert(thrown);
+
+		//ファイルを持つ場合は縮小しない (読み込み専用のインスタンスが参照し続けられる)
+		const auto capacity = vec.capacity();
+		vec.resize(10);
+		vec.shrink_to_fit();
+		assert(vec.size() == 10 && vec.capacity() == capacity);
+		assert(reader.size() == 300000 && reader[299999] == -1);
+		vec.emplace_back(100);
+		assert(vec.size() == 11 && vec.back() == 100);
+	}
+	//sig の関数を直接適用
+	{
+		MappedVector<double> vec(fpass, true);
+		const std::vector<double> expect{ 0, 0.5, 1, 1.5, 2, 2.5, 3, 3.5, 4, 4.5, 100 };
+		assert(std::equal(vec.begin(), vec.end(), expect.begin()) && vec.size() == expect.size());
+
+		assert(sum(vec) == sum(expect));
+
+		auto doubled = map([](double v){ return v * 2; }, vec);
+		auto large = filter([](double v){ return v > 3; }, vec);
+		assert(doubled.size() == 11 && doubled[10] == 200 && doubled.file_pass().empty());
+		assert(large.size() == 4 && large[0] == 3.5);
+		assert(euclidean_distance(vec, expect) == 0);
+	}
+	//要素の型が異なる場合は開けない
+	assert(!MappedVector<float>(fpass, true).is_open());
+	assert(!MappedVector<double>(pass + SIG_TO_FPSTR("not_exist.vec"), true).is_open());
+
+	//ファイルを持たない場合
+	MappedVector<int> mem{ 3, 1, 4 };
+	MappedVector<int> moved(std::move(mem));
+	moved.push_back(1);
+	assert(moved.size() == 4 && moved[2] == 4 && mem.size() == 0);
+	moved.shrink_to_fit();
+	assert(moved.capacity() == 4 && moved[3] == 1);
+
+#if SIG_MSVC_ENV
+	_wremove(fpass.c_str());
+#else
+	std::remove(fpass.c_str());
+#endif
+}
+
+void SerializeTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto fpass = pass + SIG_TO_FPSTR("test.bin");
+
+	//算術型・文字列
+	assert(save_binary(3.14, fpass) && fromJust(load_binary<double>(fpass)) == 3.14);
+	assert(save_binary(std::wstring(L"あいう"), fpass) && fromJust(load_binary<std::wstring>(fpass)) == L"あいう");
+
+	//入れ子のコンテナ・tuple
+	std::unordered_map<std::string, std::vector<double>> features{ { "a", { 1.5, -2 } }, { "b", {} }, { "long key", std::vector<double>(100000, 0.25) } };
+	std::set<std::tuple<int, int>> edges{ std::make_tuple(1, 2), std::make_tuple(3, 4) };
+	std::map<int, std::list<std::string>> groups{ { 1, { "x", "y" } }, { -5, {} } };
+	array<short, 4> sarray{ 1, 2, 3 };
+	std::array<std::pair<char, float>, 2> parray{ { std::make_pair('a', 1.5f), std::make_pair('b', -1.f) } };
+	std::vector<bool> flags{ true, false, true };
+
+	auto data = std::make_tuple(features, edges, groups, sarray, parray, flags);
+	assert(save_binary(data, fpass, 3));
+
+	auto loaded = load_binary<decltype(data)>(fpass, 3);
+	assert(isJust(loaded));
+	auto const& ld = fromJust(loaded);
+	assert(std::get<0>(ld) == features && std::get<1>(ld) == edges && std::get<2>(ld) == groups);
+	assert(std::get<3>(ld).size() == 3 && std::equal(sarray.begin(), sarray.end(), std::get<3>(ld).begin()));
+	assert(std::get<4>(ld) == parray && std::get<5>(ld) == flags);
+
+	//バージョン・型が異なる場合は失敗
+	assert(isNothing(load_binary<decltype(data)>(fpass, 2)));
+	assert(isNothing(load_binary<decltype(features)>(fpass, 3)));
+
+	//コンテナの種類は区別しない. 読み込み先の元の要素は破棄される
+	save_binary(std::vector<int>{ 3, 1, 4, 1, 5 }, fpass);
+	std::deque<int> dq{ 9, 9 };
+	std::multiset<int> ms;
+	assert(load_binary(dq, fpass) && dq == std::deque<int>({ 3, 1, 4, 1, 5 }));
+	assert(load_binary(ms, fpass) && ms.size() == 5 && *ms.begin() == 1);
+	assert(isNothing(load_binary<std::vector<unsigned>>(fpass)));
+	assert(isNothing(load_binary<std::array<int, 4>>(fpass)));
+	assert(isNothing(load_binary<array<int, 4>>(fpass)));
+
+	MappedVector<int> mvec;
+	assert(load_binary(mvec, fpass) && mvec.size() == 5 && mvec[4] == 5);
+	assert(save_binary(mvec, fpass) && fromJust(load_binary<std::vector<int>>(fpass)) == std::vector<int>({ 3, 1, 4, 1, 5 }));
+
+	//壊れたファイル
+	{
+		std::ofstream ofs(fpass, std::ios::out | std::ios::binary | std::ios::app);
+		ofs << "garbage";
+	}
+	assert(isNothing(load_binary<std::vector<int>>(fpass)));
+
+	//ヘッダの型情報の長さが壊れている (例外ではなく失敗を返す)
+	save_binary(std::vector<int>{ 1, 2 }, fpass);
+	{
+		std::fstream fs(fpass, std::ios::in | std::ios::out | std::ios::binary);
+		impl::BinaryHeader header;
+		fs.read(reinterpret_cast<char*>(&header), sizeof(header));
+		header.signature_size = 0xFFFFFFF0u;
+		fs.seekp(0);
+		fs.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	}
+	assert(isNothing(load_binary<std::vector<int>>(fpass)));
+
+	clear_file(fpass);
+	assert(isNothing(load_binary<std::vector<int>>(fpass)));
+	assert(isNothing(load_binary<int>(pass + SIG_TO_FPSTR("not_exist.bin"))));
+
+#if SIG_MSVC_ENV
+	_wremove(fpass.c_str());
+#else
+	std::remove(fpass.c_str());
+#endif
+}
+
+void ParallelSaveTest()
+{
+	const auto pass = modify_dirpass_tail(raw_pass, true);
+	const auto seq_pass = pass + SIG_TO_FPSTR("seq.txt");
+	const auto par_pass = pass + SIG_TO_FPSTR("par.txt");
+
+	auto read_all = [](FilepassString const& fpass){
+		std::ifstream ifs(fpass, std::ios::in | std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	};
+
+	//浮動小数点数 (save_num と同じ精度6の書式)
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<double> dist(-1e6, 1e6);
+	std::vector<std::vector<double>> mat(300, std::vector<double>(17));
+	for (auto& row : mat){
+		for (auto& v : row) v = dist(rng) * std::pow(10.0, static_cast<int>(rng() % 30) - 15);
+	}
+	mat[0] = { 0.0, -0.0, 1e-5, 123456, 1234567, 0.1, 1.0 / 3, std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN(), 1e300 };
+	mat[5].clear();
+
+	save_num(mat, seq_pass, ",");
+	assert(save_num_parallel(mat, par_pass, ",", WriteMode::overwrite, 4, 50));
+	assert(read_all(seq_pass) == read_all(par_pass));
+
+	//整数・追記
+	std::list<std::vector<long long>> imat{ { 1, -2, 3 }, {}, { std::numeric_limits<long long>::min(), std::numeric_limits<long long>::max() } };
+	array<std::vector<float>, 2> fmat{ { 1.5f, -0.25f }, { 3.14159265f } };
+
+	save_num(imat, seq_pass, "\t", WriteMode::append);
+	save_num(fmat, seq_pass, " ", WriteMode::append);
+	assert(save_num_parallel(imat, par_pass, "\t", WriteMode::append, 3, 1));
+	assert(save_num_parallel(fmat, par_pass, " ", WriteMode::append));
+	assert(read_all(seq_pass) == read_all(par_pass));
+
+	//空の行列
+	assert(save_num_parallel(std::vector<std::vector<unsigned>>(), par_pass, ",") && read_all(par_pass).empty());
+
+#if SIG_MSVC_ENV
+	_wremove(seq_pass.c_str());
+	_wremove(par_pass.c_str());
+#else
+	std::remove(seq_pass.c_str());
+	std::remove(par_pass.c_str());
+#endif
+}
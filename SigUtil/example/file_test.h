@@ -4,3 +4,23 @@
 
 void GetDirectoryNamesTest();
 void FileSaveLoadTest();
+void MappedLoadTest();
+void LoadLineUtf8Test();
+void LoadNumParallelTest();
+void LoadNumReportTest();
+void LibsvmTest();
+void LineStreamTest();
+void BinaryNumTest();
+void LineWriterTest();
+void ScanFileNamesTest();
+void CsvTest();
+void TailReaderTest();
+void ConcurrentAppenderTest();
+void BatchLoadTest();
+void NumCacheTest();
+void LineIndexTest();
+void ExternalSortTest();
+void DirectoryWatcherTest();
+void MappedVectorTest();
+void SerializeTest();
+void ParallelSaveTest();
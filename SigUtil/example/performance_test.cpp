@@ -13,6 +13,11 @@ void SplitPerformanceTest()
 	auto split = sig::split(long_text[0], ",");
 	tw.save();
 	std::cout << "split time(ms): " << tw.get_total_time() << std::endl;
+
+	sig::TimeWatch<> tw2;
+	auto split_view = sig::split_view(long_text[0], ",");
+	tw2.save();
+	std::cout << "split_view time(ms): " << tw2.get_total_time() << std::endl;
 }
 
 // optional̗LɂAԂ̈Ⴂ̊mF
@@ -289,3 +294,28 @@ void ContainerTraitsEffectiveTest()
 		std::cout << "reserve u-map read time: " << tw2.get_total_time<std::chrono::microseconds>() / L << std::endl;
 	}
 }
+
+// load_line  load_line_mapped(}bv) ̓ǂݍݎԂ̔r
+void LoadLinePerformanceTest()
+{
+	const int N = 1000000;
+	const auto fpass = SIG_TO_FPSTR("../SigUtil/example/test_file/test7.txt");
+
+	std::vector<std::string> data;
+	for (int i = 0; i < N; ++i) data.push_back("line " + std::to_string(i) + ",0.1234,5678,abcdefghijklmnopqrstuvwxyz");
+	sig::save_line(data, fpass);
+
+	sig::TimeWatch<std::chrono::high_resolution_clock> tw1;
+	auto read1 = sig::load_line(fpass);
+	tw1.save();
+
+	sig::TimeWatch<std::chrono::high_resolution_clock> tw2;
+	auto read2 = sig::load_line_mapped(fpass);
+	tw2.save();
+
+	assert(read1->size() == read2->size());
+	std::cout << "load_line time(ms): " << tw1.get_total_time() << std::endl;
+	std::cout << "load_line_mapped time(ms): " << tw2.get_total_time() << std::endl;
+
+	sig::clear_file(fpass);
+}
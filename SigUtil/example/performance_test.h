@@ -3,3 +3,4 @@
 void SplitPerformanceTest();
 void OptionalPerformanceTest();
 void ContainerTraitsEffectiveTest();
+void LoadLinePerformanceTest();
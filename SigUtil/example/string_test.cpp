@@ -2,6 +2,8 @@
 #include "../lib/file.hpp"
 #include "../lib/tools/time_watch.hpp"
 #include "debug.hpp"
+#include <random>
+#include <set>
 
 using namespace sig;
 
@@ -48,6 +50,35 @@ void RegexTest()
 	auto matches2 = sig::regex_search("search「? or (lol) must be escaped」", SIG_Regex(escaped1));
 	
 	assert(isJust(matches2) && fromJust(matches2)[0][0] == raw1);
+
+	//正規表現を文字列で指定して検索 (作成した正規表現オブジェクトはキャッシュされる)
+	auto matches3 = sig::regex_search(L"あ1い2う", L"(\\d)");
+
+	assert(isJust(matches3) && fromJust(matches3).size() == 2 && fromJust(matches3)[1][1] == L"2");
+	assert(cached_regex("tes(\\d)") == cached_regex(std::string("tes(\\d)")));
+	assert(make_regex(L"(笑)").mark_count() == 0);
+
+	//空文字列にマッチする場合も、各位置で1度ずつマッチして終了する
+	auto matches4 = sig::regex_search("ab", "x*");
+
+	assert(isJust(matches4) && fromJust(matches4).size() == 3);
+
+	//対象の文字列をコピーせずにマッチ箇所を走査
+	std::string src = "test tes1a tes2b";
+	sig::uint count = 0;
+
+	for (auto const& m : regex_matches(src, "tes(\\d)(\\w)")){
+		assert(m.str(0) == test3[count][0] && m.str(2) == test3[count][2]);
+		assert(&*m[0].first == &src[m.position()]);
+		++count;
+	}
+	assert(count == 2);
+
+	//行頭(^)は探索対象の文字列の先頭にのみマッチする
+	const SIG_Regex reg2("^\\w");
+	auto anchored = regex_matches(src, reg2);
+
+	assert(std::distance(anchored.begin(), anchored.end()) == 1);
 #endif
 }
 
@@ -95,6 +126,151 @@ void SplitTest()
 	for (sig::uint i = 0; i<split5.size(); ++i){
 		assert(split5[i] == test5[i]);
 	}
+
+	//デリミタの先頭の文字のみ一致する箇所は区切らない
+	auto split6 = split("x,,;y,", ",;");
+	assert(split6.size() == 2 && split6[0] == "x," && split6[1] == "y,");
+
+	//コピーせずに元の文字列を参照する string_view で分割
+	std::string csv = "1.5,,abc,, 参,";
+	auto view1 = split_view(csv, ",");
+
+	TVec test6{ "1.5", "abc", " 参" };
+	assert(view1.size() == test6.size());
+	for (sig::uint i = 0; i<view1.size(); ++i){
+		assert(std::string(view1[i].data(), view1[i].size()) == test6[i]);
+		assert(view1[i].data() >= csv.data() && view1[i].data() < csv.data() + csv.size());
+	}
+
+	//格納先のコンテナを使い回す
+	std::vector<string_view> tokens;
+	assert(split_view(csv, ",,", tokens) == 3 && tokens[1] == string_view("abc"));
+	assert(split_view("10 100  1000", " ", tokens) == 3 && tokens[2] == string_view("1000"));
+
+	//走査する毎に分割
+	std::wstring url = L"https://github.com/regenschauer490/Utility";
+	sig::uint n = 0;
+	for (auto token : split_range(url, L"/")){
+		assert(std::wstring(token.data(), token.size()) == test2[n++]);
+	}
+	assert(n == test2.size());
+	assert(split_range("", ",").begin() == split_range("", ",").end());
+}
+
+
+void TokenizerTest()
+{
+	//半角・全角の空白, 句読点のいずれかで分割
+	const Tokenizer tokenizer(U" \t,、。　");
+
+	std::string src = "今日は、晴れ。 明日は　雨,  風\t";
+	auto tokens = tokenizer.split(src);
+
+	TVec test1{ "今日は", "晴れ", "明日は", "雨", "風" };
+	assert(tokens.size() == test1.size());
+	for (sig::uint i = 0; i<tokens.size(); ++i) assert(std::string(tokens[i].data(), tokens[i].size()) == test1[i]);
+	assert(tokens[1].data() - src.data() == 12);	// 元の文字列での位置
+
+	//空のトークンを残す・区切る箇所の上限
+	const Tokenizer csv(U",;", true);
+	const Tokenizer csv2(U",;", true, 2);
+	const Tokenizer csv3(U",;", false, 1);
+	std::vector<std::string> fields;
+
+	assert(csv.split(",a;;b,", fields) == 5 && fields == TVec({ "", "a", "", "b", "" }));
+	assert(csv2.split("a,;b,c", fields) == 3 && fields == TVec({ "a", "", "b,c" }));
+	assert(csv3.split(",,a,,b,c", fields) == 2 && fields == TVec({ "a", "b,c" }));
+	assert(csv.split("", fields) == 1 && tokenizer.split("", fields) == 0);
+
+	//ワイド文字列 (BMP外の文字も指定可)
+	const WTokenizer wtokenizer(U" ・\U0001F600");
+	auto wtokens = wtokenizer.split(L"スペース・区切り \U0001F600絵文字");
+
+	TVecw test2{ L"スペース", L"区切り", L"絵文字" };
+	assert(wtokens.size() == test2.size());
+	for (sig::uint i = 0; i<wtokens.size(); ++i) assert(std::wstring(wtokens[i].data(), wtokens[i].size()) == test2[i]);
+
+	sig::uint count = 0;
+	assert(wtokenizer.for_each(L"a b", [&](wstring_view token){ count += token.size(); }) == 2 && count == 2);
+}
+
+void AhoCorasickTest()
+{
+	using Match = AhoCorasick::Match;
+	auto same = [](Match const& m, sig::uint pattern, sig::uint position, sig::uint length){
+		return m.pattern == pattern && m.position == position && m.length == length;
+	};
+
+	//全てのマッチ箇所 (終了位置の順. 同じ位置で終わるものは長い順)
+	const AhoCorasick matcher{ "he", "she", "his", "hers" };
+
+	auto all = matcher.find("ushers");
+	assert(all.size() == 3);
+	assert(same(all[0], 1, 1, 3) && same(all[1], 0, 2, 2) && same(all[2], 3, 2, 4));
+
+	//最も左で始まる最長のマッチ箇所 (重ならない)
+	auto longest = matcher.find("ushers his", MatchMode::leftmost_longest);
+	assert(longest.size() == 2);
+	assert(same(longest[0], 1, 1, 3) && same(longest[1], 2, 7, 3));
+
+	const AhoCorasick nested(std::vector<std::string>{ "bcd", "abcde", "e", "ab" });
+	auto longest2 = nested.find("xabcdef", MatchMode::leftmost_longest);
+	assert(longest2.size() == 1 && same(longest2[0], 1, 1, 5));
+	assert(nested.find("abcd", MatchMode::leftmost_longest).size() == 1);	// "ab" のみ ("bcd" は重なる)
+
+	assert(matcher.contains("a shell") && !matcher.contains("nothing"));
+	assert(matcher.for_each("hershe", [](Match const&){}) == 4);
+
+	//ワイド文字列
+	const WAhoCorasick wmatcher{ L"晴れ", L"雨", L"晴れ時々雨" };
+	auto wall = wmatcher.find(L"明日は晴れ時々雨");
+	assert(wall.size() == 3 && same(wall[0], 0, 3, 2) && same(wall[2], 1, 7, 1));
+
+	auto wlongest = wmatcher.find(L"明日は晴れ時々雨", MatchMode::leftmost_longest);
+	assert(wlongest.size() == 1 && same(wlongest[0], 2, 3, 5));
+
+	//複数の行をまとめて探索 (並列)
+	std::vector<std::string> lines{ "she sells", "", "his hers", "none" };
+	auto result = matcher.find_lines(lines, MatchMode::all, 2);
+	assert(result.size() == 4 && result[0].size() == 2 && result[1].empty() && result[2].size() == 3 && result[3].empty());
+
+	//単純な探索と結果を比較
+	std::mt19937 rng(1);
+	for (int trial = 0; trial < 200; ++trial){
+		std::set<std::string> unique;
+		const sig::uint num = rng() % 20;
+		for (sig::uint i = 0; i < num; ++i){
+			std::string pattern(1 + rng() % 4, 'a');
+			for (auto& c : pattern) c = 'a' + rng() % 3;
+			unique.insert(pattern);
+		}
+		const std::vector<std::string> patterns(unique.begin(), unique.end());
+		std::string text(rng() % 40, 'a');
+		for (auto& c : text) c = 'a' + rng() % 3;
+
+		std::vector<Match> naive_all, naive_longest;
+		for (sig::uint end = 1; end <= text.size(); ++end){
+			for (sig::uint len = end; len > 0; --len){
+				auto it = std::find(patterns.begin(), patterns.end(), text.substr(end - len, len));
+				if (it != patterns.end()) naive_all.push_back(Match{ static_cast<sig::uint>(it - patterns.begin()), end - len, len });
+			}
+		}
+		for (sig::uint pos = 0; pos < text.size();){
+			sig::uint best = 0, id = 0;
+			for (sig::uint i = 0; i < patterns.size(); ++i){
+				if (patterns[i].size() > best && text.compare(pos, patterns[i].size(), patterns[i]) == 0){ best = patterns[i].size(); id = i; }
+			}
+			if (best){ naive_longest.push_back(Match{ id, pos, best }); pos += best; }
+			else ++pos;
+		}
+
+		const AhoCorasick ac(patterns);
+		auto found_all = ac.find(text);
+		auto found_longest = ac.find(text, MatchMode::leftmost_longest);
+		assert(found_all.size() == naive_all.size() && found_longest.size() == naive_longest.size());
+		for (sig::uint i = 0; i < found_all.size(); ++i) assert(same(found_all[i], naive_all[i].pattern, naive_all[i].position, naive_all[i].length));
+		for (sig::uint i = 0; i < found_longest.size(); ++i) assert(same(found_longest[i], naive_longest[i].pattern, naive_longest[i].position, naive_longest[i].length));
+	}
 }
 
 
@@ -112,6 +288,23 @@ void CatStrTest()
 	assert(cat2 == L"eins,zwei,drei");
 	assert(cat3 == "1\n2\n3");
 	assert(cat4 == L"a-b");
+
+	//数値は ostringstream で出力した場合と同じ書式 (精度6)
+	assert(cat(std::vector<double>{ 0.1, 1.0 / 3, 1e-7, -2.5e10 }, ",") == "0.1,0.333333,1e-07,-2.5e+10");
+	assert(cat(std::vector<char>{ 'x', 'y' }, "+") == "x+y");
+
+	//書式の指定
+	assert(cat(std::vector<double>{ 0.1, 1.0 / 3 }, ",", NumFormat::shortest) == "0.1,0.3333333333333333");
+	assert(cat(std::vector<double>{ 0.1, 1.0 / 3, 2 }, ",", NumFormat::fixed, 2) == "0.10,0.33,2.00");
+	assert(cat(std::list<int>{ -1, 2 }, " ", NumFormat::fixed, 2) == "-1 2");
+	assert(cat(std::vector<double>{ 1e300 }, "", NumFormat::fixed, 1).size() == 303);
+
+	//結合した文字列を末尾に追加
+	std::string line = "row:";
+	cat(std::vector<std::string>{ "a", "b" }, "-", line);
+	cat(std::vector<float>{ 1.5f }, "", line);
+	cat(std::vector<double>{ 0.25 }, "", line, NumFormat::fixed, 3);
+	assert(line == "row:a-b1.50.250");
 }
 
 
@@ -4,6 +4,8 @@
 
 void RegexTest();
 void SplitTest();
+void TokenizerTest();
+void AhoCorasickTest();
 void CatStrTest();
 void StrConvertTest();
 void ZenHanTest();
@@ -9,7 +9,23 @@ http://opensource.org/licenses/mit-license.php
 #define SIG_UTIL_FILE_HPP
 
 #include "file/pass.hpp"
+#include "file/mapped_file.hpp"
 #include "file/load.hpp"
 #include "file/save.hpp"
+#include "file/line_stream.hpp"
+#include "file/binary_num.hpp"
+#include "file/line_writer.hpp"
+#include "file/csv.hpp"
+#include "file/tail_reader.hpp"
+#include "file/concurrent_appender.hpp"
+#include "file/sparse.hpp"
+#include "file/batch_load.hpp"
+#include "file/num_cache.hpp"
+#include "file/line_index.hpp"
+#include "file/external_sort.hpp"
+#include "file/directory_watcher.hpp"
+#include "file/mapped_vector.hpp"
+#include "file/serialize.hpp"
+#include "file/parallel_save.hpp"
 
 #endif
@@ -0,0 +1,158 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_BATCH_LOAD_HPP
+#define SIG_UTIL_BATCH_LOAD_HPP
+
+#include "load.hpp"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+
+
+/// \file batch_load.hpp 複数のファイルの並行読み込み
+
+namespace sig
+{
+
+/// 複数のファイルを並行して読み込み、入力と同じ順番で結果を返す
+/**
+	最大 concurrency 個のファイルを同時に読み込む（小さなファイルが大量にある場合など、読み込みの待ち時間が支配的な場合に有効）．\n
+	loader 内で例外が送出された場合、全ての読み込みの終了後に入力の順番が最も早いものを再送出する
+
+	\param file_passes 読み込むファイルのパス
+	\param loader ファイルを読み込む関数 (FilepassString -> R). 複数のスレッドから同時に呼び出される
+	\param concurrency [option] 同時に読み込むファイル数の上限（0の場合はハードウェアの並列数）
+
+	\return 各ファイルの読み込み結果（file_passes と同じ順番）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	auto names = fromJust(get_file_names(dir, false, ".txt"));
+	auto passes = map([&](FilepassString const& name){ return dir + name; }, names);
+
+	auto texts = load_batch(passes, [](FilepassString const& pass){ return load_line(pass); });	// std::vector<Maybe<std::vector<std::string>>>
+	auto nums = load_batch(passes, [](FilepassString const& pass){ return load_num<double>(pass, "\n", 1); }, 32);
+	\endcode
+*/
+template <class F, class R = typename std::decay<decltype(std::declval<F>()(std::declval<FilepassString const&>()))>::type>
+auto load_batch(
+	std::vector<FilepassString> const& file_passes,
+	F&& loader,
+	uint concurrency = 16)
+	->std::vector<R>
+{
+	return impl::parallel_generate<R>(file_passes.size(), concurrency, [&](uint i){
+		return loader(file_passes[i]);
+	});
+}
+
+/// 複数のファイルを並行して読み込み、読み込みが完了した順に結果を関数に渡す
+/**
+	最大 concurrency 個のファイルを読み込み用のスレッドで同時に読み込み、読み込みが完了したファイルから順に呼び出し元のスレッドで on_loaded を呼び出す．\n
+	そのため on_loaded は同時に呼び出されることはなく、結果の処理中も他のファイルの読み込みは続けられる．\n
+	loader または on_loaded 内で例外が送出された場合、未着手のファイルの読み込みを中止し、実行中の読み込みの終了後に最初の例外を再送出する
+
+	\param file_passes 読み込むファイルのパス
+	\param loader ファイルを読み込む関数 (FilepassString -> R). 複数のスレッドから同時に呼び出される
+	\param on_loaded 読み込み結果を受け取る関数 (uint index, R result). index は file_passes 中の位置
+	\param concurrency [option] 同時に読み込むファイル数の上限（0の場合はハードウェアの並列数）
+
+	\code
+	std::vector<FilepassString> passes = ...;
+
+	load_batch_each(passes, [](FilepassString const& pass){ return load_line(pass); }, [&](uint i, Maybe<std::vector<std::string>> lines){
+		if (lines) std::cout << passes[i] << ": " << lines->size() << " lines" << std::endl;
+	});
+	\endcode
+*/
+template <class F, class G, class R = typename std::decay<decltype(std::declval<F>()(std::declval<FilepassString const&>()))>::type>
+void load_batch_each(
+	std::vector<FilepassString> const& file_passes,
+	F&& loader,
+	G&& on_loaded,
+	uint concurrency = 16)
+{
+	const uint task_num = file_passes.size();
+	if (task_num == 0) return;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::pair<uint, R>> done;
+	std::exception_ptr error;
+	uint finished = 0;					// 読み込みを終えた（または中止した）ファイル数
+	std::atomic<uint> next(0);
+	std::atomic<bool> cancel(false);
+
+	auto worker = [&](){
+		for (uint i = next++; i < task_num; i = next++){
+			if (cancel){
+				std::lock_guard<std::mutex> lock(mutex);
+				++finished;
+				cv.notify_one();
+				continue;
+			}
+			try{
+				R result = loader(file_passes[i]);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				done.emplace_back(i, std::move(result));
+				++finished;
+			}
+			catch (...){
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error) error = std::current_exception();
+				cancel = true;
+				++finished;
+			}
+			cv.notify_one();
+		}
+	};
+
+	const uint n = std::min(impl::resolve_thread_num(concurrency), task_num);
+	std::vector<std::thread> threads;
+	for (uint t = 0; t < n; ++t){
+		try{
+			threads.emplace_back(worker);
+		}
+		catch (std::system_error const&){
+			if (threads.empty()) throw;
+			break;	// スレッドを作成できない場合は作成済みのスレッドだけで処理する
+		}
+	}
+
+	while (true){
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&]{ return !done.empty() || finished == task_num; });
+		if (done.empty()) break;
+
+		auto item = std::move(done.front());
+		done.pop_front();
+		lock.unlock();
+
+		if (cancel) continue;
+		try{
+			on_loaded(item.first, std::move(item.second));
+		}
+		catch (...){
+			lock.lock();
+			if (!error) error = std::current_exception();
+			cancel = true;
+		}
+	}
+
+	for (auto& th : threads) th.join();
+	if (error) std::rethrow_exception(error);
+}
+
+}
+#endif
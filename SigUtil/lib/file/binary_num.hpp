@@ -0,0 +1,406 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_BINARY_NUM_HPP
+#define SIG_UTIL_BINARY_NUM_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/maybe.hpp"
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+/// \file binary_num.hpp 数値行列のバイナリ形式での保存・読み込み
+
+namespace sig
+{
+namespace impl
+{
+
+// ファイル形式 (各値は実行環境のバイトオーダーで格納)
+//  [0, 56)             : ヘッダ
+//  [56, ...)           : 各行の開始位置 (uint64 × (rows+1), 要素数単位). 行毎に列数が異なる場合のみ
+//  [payload_offset, ...) : 全要素を行順に連続して格納 (64 byte境界に配置)
+struct BinaryNumHeader
+{
+	char magic[8];					// "SIGNUM\0\0"
+	std::uint32_t byte_order;		// 0x01020304 (バイトオーダーの判定用)
+	std::uint32_t version;
+	std::uint32_t dtype;			// 要素の型 (binary_dtype)
+	std::uint32_t ragged;			// 行毎に列数が異なるか (1: 行の開始位置の表を持つ)
+	std::uint64_t rows;
+	std::uint64_t cols;				// ragged の場合は 0
+	std::uint64_t elements;			// 全要素数
+	std::uint64_t payload_offset;	// 要素の格納位置 (ファイル先頭からのバイト数)
+};
+static_assert(sizeof(BinaryNumHeader) == 56, "unexpected padding in BinaryNumHeader");
+
+static const char binary_num_magic[8] = { 'S', 'I', 'G', 'N', 'U', 'M', '\0', '\0' };
+static const std::uint32_t binary_num_byte_order = 0x01020304;
+static const std::uint32_t binary_num_version = 1;
+static const std::uint64_t binary_num_alignment = 64;
+
+// 要素の型を表す値 (上位: 0 符号なし整数, 1 符号付き整数, 2 浮動小数点数 / 下位: バイト数)
+template <class T>
+struct binary_dtype
+{
+	static_assert(std::is_arithmetic<T>::value, "binary format supports only arithmetic types");
+	static_assert(!std::is_same<typename std::remove_cv<T>::type, long double>::value, "binary format does not support long double (its layout depends on the platform)");
+	static const std::uint32_t value = ((std::is_floating_point<T>::value ? 2u : std::is_signed<T>::value ? 1u : 0u) << 8) | static_cast<std::uint32_t>(sizeof(T));
+};
+
+// 読み込んだファイルのヘッダと各領域の位置
+struct BinaryNumLayout
+{
+	BinaryNumHeader header;
+	char const* offsets;	// ragged でない場合は nullptr
+	char const* payload;
+
+	std::uint64_t row_begin(uint row) const
+	{
+		if (!offsets) return row * header.cols;
+		std::uint64_t v;
+		std::memcpy(&v, offsets + row * sizeof(std::uint64_t), sizeof(v));
+		return v;
+	}
+	std::uint64_t row_end(uint row) const{ return row_begin(row + 1); }
+};
+
+// ヘッダとファイルサイズの整合性を検査してレイアウトを返す
+inline bool parse_binary_num(MappedFile const& file, BinaryNumLayout& layout)
+{
+	if (file.size() < sizeof(BinaryNumHeader)) return false;
+
+	auto& h = layout.header;
+	std::memcpy(&h, file.data(), sizeof(h));
+
+	if (std::memcmp(h.magic, binary_num_magic, sizeof(h.magic)) != 0 || h.byte_order != binary_num_byte_order || h.version != binary_num_version) return false;
+
+	// 各値の積や和はオーバーフローしないことを確かめてから求める
+	const std::uint64_t elem_size = h.dtype & 0xff;
+	if (h.ragged && h.rows >= (file.size() - sizeof(BinaryNumHeader)) / sizeof(std::uint64_t)) return false;
+
+	const std::uint64_t table_end = sizeof(BinaryNumHeader) + (h.ragged ? (h.rows + 1) * sizeof(std::uint64_t) : 0);
+
+	if (elem_size == 0 || h.payload_offset < table_end || h.payload_offset > file.size()) return false;
+	if ((file.size() - h.payload_offset) / elem_size < h.elements) return false;
+	if (!h.ragged){
+		if (h.cols ? (h.rows != h.elements / h.cols || h.elements % h.cols != 0) : h.elements != 0) return false;
+	}
+
+	layout.offsets = h.ragged ? file.data() + sizeof(BinaryNumHeader) : nullptr;
+	layout.payload = file.data() + h.payload_offset;
+
+	if (h.ragged){
+		std::uint64_t prev = 0;
+		for (uint i = 0; i <= h.rows; ++i){
+			const auto v = layout.row_begin(i);
+			if (v < prev || v > h.elements) return false;
+			prev = v;
+		}
+		if (layout.row_begin(0) != 0 || prev != h.elements) return false;
+	}
+	return true;
+}
+
+// 格納されている型Sの要素 [first, last) を型RTに変換してコンテナに追加
+template <class S, class RT, class RC>
+void add_binary_elements(RC& row, char const* payload, std::uint64_t first, std::uint64_t last)
+{
+	for (auto i = first; i < last; ++i){
+		S v;
+		std::memcpy(&v, payload + i * sizeof(S), sizeof(S));
+		impl::container_traits<RC>::add_element(row, static_cast<RT>(v));
+	}
+}
+
+template <class RT, class RC>
+bool add_binary_elements(RC& row, std::uint32_t dtype, char const* payload, std::uint64_t first, std::uint64_t last)
+{
+	switch (dtype){
+	case binary_dtype<std::int8_t>::value: add_binary_elements<std::int8_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::int16_t>::value: add_binary_elements<std::int16_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::int32_t>::value: add_binary_elements<std::int32_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::int64_t>::value: add_binary_elements<std::int64_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::uint8_t>::value: add_binary_elements<std::uint8_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::uint16_t>::value: add_binary_elements<std::uint16_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::uint32_t>::value: add_binary_elements<std::uint32_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<std::uint64_t>::value: add_binary_elements<std::uint64_t, RT>(row, payload, first, last); return true;
+	case binary_dtype<float>::value: add_binary_elements<float, RT>(row, payload, first, last); return true;
+	case binary_dtype<double>::value: add_binary_elements<double, RT>(row, payload, first, last); return true;
+	default: return false;
+	}
+}
+
+}	// impl
+
+
+/// 2次元配列の数値(ex:行列)をバイナリ形式で保存
+/**
+	save_num と異なり数値を文字列に変換せず、要素の型と行列のサイズを記したヘッダに続けて各要素をそのまま書き込む．\n
+	行毎に要素数が異なる場合は各行の開始位置の表も保存される．\n
+	保存したファイルは load_num2d_binary, load_num2d_mapped で読み込むことができる
+
+	\param src 保存対象の行列（\ref sig_container ). 要素は算術型（long double は環境によって形式が異なるため不可）
+	\param file_pass 保存先のパス（ファイル名含む）
+
+	\return 書き込みの成否
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.bin");
+
+	const std::vector<std::vector<double>> mat = {
+		{ 1.5, 2, 3 },
+		{ 4, 5, 6, 7 },
+		{ 8, 9 }
+	};
+
+	save_num_binary(mat, fpass);
+	\endcode
+*/
+template <
+	class CC,
+	class RC = typename impl::container_traits<CC>::value_type,
+	class RT = typename impl::container_traits<RC>::value_type,
+	typename std::enable_if<impl::container_traits<RC>::exist>::type*& = enabler
+>
+bool save_num_binary(
+	CC const& src,
+	FilepassString const& file_pass)
+{
+	using T = typename impl::remove_const_reference<RT>::type;
+
+	impl::BinaryNumHeader header;
+	std::memcpy(header.magic, impl::binary_num_magic, sizeof(header.magic));
+	header.byte_order = impl::binary_num_byte_order;
+	header.version = impl::binary_num_version;
+	header.dtype = impl::binary_dtype<T>::value;
+
+	std::vector<std::uint64_t> offsets(1, 0);
+	for (auto const& row : src) offsets.push_back(offsets.back() + std::distance(std::begin(row), std::end(row)));
+
+	const std::uint64_t rows = offsets.size() - 1;
+	const std::uint64_t cols = rows ? offsets[1] : 0;
+	bool ragged = false;
+	for (uint i = 1; i < offsets.size(); ++i){
+		if (offsets[i] - offsets[i - 1] != cols) ragged = true;
+	}
+
+	header.ragged = ragged ? 1 : 0;
+	header.rows = rows;
+	header.cols = ragged ? 0 : cols;
+	header.elements = offsets.back();
+
+	const std::uint64_t table_end = sizeof(header) + (ragged ? offsets.size() * sizeof(std::uint64_t) : 0);
+	header.payload_offset = (table_end + impl::binary_num_alignment - 1) / impl::binary_num_alignment * impl::binary_num_alignment;
+
+	std::ofstream ofs(file_pass, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!ofs) return false;
+
+	ofs.write(reinterpret_cast<char const*>(&header), sizeof(header));
+	if (ragged) ofs.write(reinterpret_cast<char const*>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+
+	const char padding[impl::binary_num_alignment] = {};
+	ofs.write(padding, header.payload_offset - table_end);
+
+	std::vector<T> buffer;
+	for (auto const& row : src){
+		buffer.assign(std::begin(row), std::end(row));
+		ofs.write(reinterpret_cast<char const*>(buffer.data()), buffer.size() * sizeof(T));
+	}
+
+	// 最後の書き込みの失敗も検出するため、閉じた後の状態を返す
+	ofs.close();
+	return !ofs.fail();
+}
+
+
+/// バイナリ形式で保存された2次元配列の数値(ex:行列)を読み込む
+/**
+	保存時と異なる数値型のコンテナを指定した場合は static_cast で変換される
+
+	\param empty_dest 保存先のコンテナ（\ref sig_container )
+	\param file_pass 読み込むファイルのパス
+
+	\return 読み込みの成否（ファイルが存在しない、形式が異なる場合は false）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.bin");
+
+	std::vector<std::vector<double>> mat;
+	load_num2d_binary(mat, fpass);
+	\endcode
+*/
+template <
+	class CC,
+	class RC = typename impl::container_traits<CC>::value_type,
+	class RT = typename impl::container_traits<RC>::value_type,
+	typename std::enable_if<impl::container_traits<RC>::exist>::type*& = enabler
+>
+bool load_num2d_binary(
+	CC& empty_dest,
+	FilepassString const& file_pass)
+{
+	MappedFile file(file_pass);
+	impl::BinaryNumLayout layout;
+
+	if (!file || !impl::parse_binary_num(file, layout)) return false;
+
+	for (uint i = 0; i < layout.header.rows; ++i){
+		const auto first = layout.row_begin(i);
+		const auto last = layout.row_end(i);
+		auto row = impl::container_traits<RC>::make(last - first);
+
+		if (!impl::add_binary_elements<RT>(row, layout.header.dtype, layout.payload, first, last)) return false;
+		impl::container_traits<CC>::add_element(empty_dest, std::move(row));
+	}
+	return true;
+}
+
+/// バイナリ形式で保存された2次元配列の数値(ex:行列)を読み込む
+/**
+	\tparam R 数値の型（int, double等）
+	\tparam CC [option] コンテナの型（\ref sig_container )
+
+	\param file_pass 読み込むファイルのパス
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.bin");
+
+	auto mat = load_num2d_binary<double>(fpass);
+	\endcode
+*/
+template <
+	class R,
+	class CC = std::vector<std::vector<R>>,
+	typename std::enable_if<impl::container_traits<typename impl::container_traits<CC>::value_type>::exist>::type*& = enabler
+>
+auto load_num2d_binary(FilepassString const& file_pass) ->Maybe<CC>
+{
+	CC tmp;
+	return load_num2d_binary(tmp, file_pass) ? Just<CC>(std::move(tmp)) : Nothing(std::move(tmp));
+}
+
+
+/// load_num2d_mapped の読み込み結果
+/**
+	バイナリ形式の行列ファイルをメモリマップし、要素をコピーせずに連続した配列として参照する．\n
+	コピーはマッピングを共有し、いずれかのコピーが生存している間 data() や row() の参照先は有効である．
+
+	\tparam T 数値の型（保存時の型と一致している必要がある）
+*/
+template <class T>
+class MappedMatrix
+{
+	MappedFile file_;
+	impl::BinaryNumLayout layout_;
+	T const* data_;
+
+public:
+	/// 1行分の要素の範囲
+	class Row
+	{
+		T const* first_;
+		T const* last_;
+
+	public:
+		using value_type = T;
+		using const_iterator = T const*;
+		using iterator = const_iterator;
+
+		Row(T const* first, T const* last) : first_(first), last_(last){}
+
+		const_iterator begin() const{ return first_; }
+		const_iterator end() const{ return last_; }
+		T const* data() const{ return first_; }
+		uint size() const{ return last_ - first_; }
+		bool empty() const{ return first_ == last_; }
+		T const& operator[](uint index) const{ return first_[index]; }
+	};
+
+	MappedMatrix() : data_(nullptr){ layout_.header.rows = layout_.header.cols = layout_.header.elements = 0; layout_.header.ragged = 0; layout_.offsets = nullptr; }
+
+	MappedMatrix(MappedFile file, impl::BinaryNumLayout const& layout)
+		: file_(std::move(file)), layout_(layout), data_(reinterpret_cast<T const*>(layout.payload)){}
+
+	/// 行数
+	uint rows() const{ return static_cast<uint>(layout_.header.rows); }
+
+	/// 列数（行毎に列数が異なる場合は 0）
+	uint cols() const{ return static_cast<uint>(layout_.header.cols); }
+
+	/// 行毎に列数が異なるか
+	bool is_ragged() const{ return layout_.header.ragged != 0; }
+
+	/// 全要素数
+	uint size() const{ return static_cast<uint>(layout_.header.elements); }
+
+	bool empty() const{ return size() == 0; }
+
+	/// 全要素を行順に格納した連続領域の先頭
+	T const* data() const{ return data_; }
+
+	T const* begin() const{ return data_; }
+	T const* end() const{ return data_ + size(); }
+
+	/// row 行目の要素
+	Row row(uint row) const{ return Row(data_ + layout_.row_begin(row), data_ + layout_.row_end(row)); }
+
+	/// row 行 col 列目の要素
+	T const& operator()(uint row, uint col) const{ return data_[layout_.row_begin(row) + col]; }
+
+	/// 参照しているマッピング
+	MappedFile const& file() const{ return file_; }
+};
+
+/// バイナリ形式で保存された2次元配列の数値(ex:行列)をメモリマップで読み込み、連続した配列として参照する
+/**
+	要素はコピーされず、ファイル上の領域を直接参照する
+
+	\tparam T 数値の型（保存時の型と一致しない場合は Nothing が返される）
+
+	\param file_pass 読み込むファイルのパス
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.bin");
+
+	auto mat = load_num2d_mapped<double>(fpass);
+
+	if (isJust(mat)){
+		auto& m = *mat;		// MappedMatrix<double>
+		double sum = std::accumulate(m.begin(), m.end(), 0.0);
+		double x = m(1, 2);
+	}
+	\endcode
+*/
+template <class T>
+auto load_num2d_mapped(FilepassString const& file_pass) ->Maybe<MappedMatrix<T>>
+{
+	MappedFile file(file_pass);
+	impl::BinaryNumLayout layout;
+
+	if (!file || !impl::parse_binary_num(file, layout) || layout.header.dtype != impl::binary_dtype<T>::value){
+		return Nothing(MappedMatrix<T>());
+	}
+	return Just(MappedMatrix<T>(std::move(file), layout));
+}
+
+}
+#endif
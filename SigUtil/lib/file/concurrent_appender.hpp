@@ -0,0 +1,347 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_CONCURRENT_APPENDER_HPP
+#define SIG_UTIL_CONCURRENT_APPENDER_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/string_view.hpp"
+#include "save.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+
+
+/// \file concurrent_appender.hpp 複数のスレッドから同じファイルへ行単位で追記するためのライター
+
+namespace sig
+{
+
+/// 複数のスレッドから同じファイルに安全に行を追記するライター
+/**
+	各スレッドは自分専用の一時バッファに行を書き込み、1つの書き込みスレッドがそれらを行単位でまとめてファイルに書き込む．\n
+	そのため、異なるスレッドの行が途中で混ざることはなく、スレッド間で1つのロックを奪い合うこともない．\n
+	（一時バッファのロックは所有するスレッドと書き込みスレッドがバッファを交換する間のみ使用される）\n
+	同じスレッドから書き込んだ行の順序は保たれるが、異なるスレッド間の行の順序は保証されない．\n
+	flush() で呼び出し時点までに全スレッドが書き込んだ行のファイルへの書き込み完了を待ち、close() またはデストラクタでファイルを閉じる．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("log.txt");
+
+	ConcurrentAppender appender(fpass);
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < 8; ++t){
+		workers.emplace_back([&, t]{
+			for (int i = 0; i < 10000; ++i) appender.write("thread " + std::to_string(t) + ": " + std::to_string(i));
+		});
+	}
+	for (auto& w : workers) w.join();
+
+	appender.flush();
+	std::cout << appender.lines_written() << " lines, " << appender.bytes_written() << " bytes" << std::endl;
+	\endcode
+*/
+class ConcurrentAppender
+{
+	// スレッド毎の一時バッファ
+	struct Stage
+	{
+		std::mutex mutex;
+		std::string buffer;
+		std::uint64_t lines;
+
+		Stage() : lines(0){}
+	};
+
+	const std::uint64_t id_;
+	std::ofstream ofs_;
+	uint buffer_size_;
+	std::chrono::milliseconds interval_;
+
+	std::vector<std::shared_ptr<Stage>> stages_;
+	std::mutex stages_mutex_;
+
+	std::mutex mutex_;
+	std::condition_variable writer_cv_;
+	std::condition_variable flush_cv_;
+	std::uint64_t requested_;		// flush の要求番号
+	std::uint64_t completed_;		// 書き込みが完了した要求番号
+	bool stop_;
+	std::atomic<bool> wakeup_;
+	std::thread thread_;
+
+	std::atomic<std::uint64_t> bytes_;
+	std::atomic<std::uint64_t> lines_;
+	std::atomic<bool> failed_;
+
+private:
+	static std::uint64_t new_id()
+	{
+		static std::atomic<std::uint64_t> counter(0);
+		return ++counter;
+	}
+
+	// 呼び出し元のスレッドの一時バッファ
+	Stage& local_stage()
+	{
+		static thread_local std::uint64_t cached_id = 0;
+		static thread_local Stage* cached_stage = nullptr;
+		static thread_local std::unordered_map<std::uint64_t, Stage*> stages;
+
+		if (cached_id == id_) return *cached_stage;
+
+		auto& stage = stages[id_];
+		if (!stage){
+			auto created = std::make_shared<Stage>();
+			created->buffer.reserve(buffer_size_);
+			{
+				std::lock_guard<std::mutex> lock(stages_mutex_);
+				stages_.push_back(created);
+			}
+			stage = created.get();
+		}
+		cached_id = id_;
+		cached_stage = stage;
+		return *stage;
+	}
+
+	// 全スレッドの一時バッファの内容をファイルに書き込む
+	void drain(std::string& swap_buffer)
+	{
+		std::vector<std::shared_ptr<Stage>> stages;
+		{
+			std::lock_guard<std::mutex> lock(stages_mutex_);
+			stages = stages_;
+		}
+
+		for (auto& stage : stages){
+			std::uint64_t lines;
+			{
+				std::lock_guard<std::mutex> lock(stage->mutex);
+				if (stage->buffer.empty()) continue;
+				swap_buffer.swap(stage->buffer);
+				lines = stage->lines;
+				stage->lines = 0;
+			}
+			ofs_.write(swap_buffer.data(), swap_buffer.size());
+			if (!ofs_) failed_ = true;
+
+			bytes_ += swap_buffer.size();
+			lines_ += lines;
+			swap_buffer.clear();
+		}
+	}
+
+	void run()
+	{
+		std::string swap_buffer;
+		swap_buffer.reserve(buffer_size_);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true){
+			writer_cv_.wait_for(lock, interval_, [&]{ return stop_ || requested_ != completed_ || wakeup_.load(); });
+			wakeup_ = false;
+
+			const auto target = requested_;
+			const bool stop = stop_;
+			lock.unlock();
+
+			drain(swap_buffer);
+			if (target != completed_) ofs_.flush();
+
+			lock.lock();
+			completed_ = target;
+			flush_cv_.notify_all();
+			if (stop) break;
+		}
+	}
+
+	// 1行分の値を一時バッファの末尾に追加する (文字列以外の値は std::ostream の出力形式)
+	static void append_value(std::string& buffer, std::string const& line){ buffer.append(line); }
+
+	static void append_value(std::string& buffer, char const* line){ buffer.append(line); }
+
+	static void append_value(std::string& buffer, string_view line){ buffer.append(line.data(), line.size()); }
+
+	template <class T>
+	static void append_value(std::string& buffer, T const& value)
+	{
+		std::ostringstream oss;
+		oss << value;
+		buffer.append(oss.str());
+	}
+
+	void end_line(Stage& stage)
+	{
+		stage.buffer.push_back('\n');
+		++stage.lines;
+		if (stage.buffer.size() >= buffer_size_ && !wakeup_.exchange(true)) writer_cv_.notify_one();
+	}
+
+public:
+	/// ファイルを開き、書き込みスレッドを開始する
+	/**
+		\param file_pass 保存先のパス（ファイル名含む）
+		\param open_mode [option] 上書き(overwrite) or 末尾追記(append)
+		\param buffer_size [option] 一時バッファがこのバイト数に達すると書き込みスレッドを起こす
+		\param interval_ms [option] 書き込みスレッドが一時バッファを回収する間隔（ミリ秒）
+	*/
+	explicit ConcurrentAppender(
+		FilepassString const& file_pass,
+		WriteMode open_mode = WriteMode::append,
+		uint buffer_size = 1 << 16,
+		uint interval_ms = 100)
+		: id_(new_id()), buffer_size_(std::max<uint>(buffer_size, 1)), interval_(interval_ms), requested_(0), completed_(0), stop_(false), wakeup_(false), bytes_(0), lines_(0), failed_(false)
+	{
+		const auto mode = open_mode == WriteMode::overwrite ? std::ios::out : std::ios::out | std::ios::app;
+		ofs_.open(file_pass, mode);
+
+		if (ofs_) thread_ = std::thread([this]{ run(); });
+		else failed_ = true;
+	}
+
+	~ConcurrentAppender(){ close(); }
+
+	ConcurrentAppender(ConcurrentAppender const&) = delete;
+	ConcurrentAppender& operator=(ConcurrentAppender const&) = delete;
+
+	/// ファイルを開けたか（close() 後は false）
+	bool is_open() const{ return thread_.joinable(); }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 1行追記する（末尾に改行が追加される）. 複数のスレッドから同時に呼び出してよい
+	void write(string_view line)
+	{
+		if (!is_open()) return;
+
+		auto& stage = local_stage();
+		std::lock_guard<std::mutex> lock(stage.mutex);
+		stage.buffer.append(line.data(), line.size());
+		end_line(stage);
+	}
+
+	void write(std::string const& line){ write(string_view(line.data(), line.size())); }
+
+	void write(char const* line){ write(string_view(line)); }
+
+	/// 任意の型の値を std::ostream の出力形式で1行追記する
+	template <class T,
+		typename std::enable_if<!impl::container_traits<T>::exist>::type*& = enabler
+	>
+	void write(T const& value)
+	{
+		std::ostringstream oss;
+		oss << value;
+		write(oss.str());
+	}
+
+	/// コンテナの1要素を1行としてまとめて追記する（各行は他のスレッドの行を挟まず連続して書き込まれる）
+	template <class C,
+		typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+	>
+	void write(C const& lines)
+	{
+		if (!is_open()) return;
+
+		auto& stage = local_stage();
+		std::lock_guard<std::mutex> lock(stage.mutex);
+		for (auto const& line : lines){
+			append_value(stage.buffer, line);
+			end_line(stage);
+		}
+	}
+
+	/// 呼び出し時点までに全スレッドが書き込んだ行がファイルに書き込まれるまで待機する
+	/**
+		\return これまでの書き込みが全て成功したか
+	*/
+	bool flush()
+	{
+		if (!thread_.joinable()) return !failed_;
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		const auto target = ++requested_;
+		writer_cv_.notify_one();
+		flush_cv_.wait(lock, [&]{ return completed_ >= target; });
+		return !failed_;
+	}
+
+	/// 残りの行を書き込み、書き込みスレッドを終了してファイルを閉じる
+	/**
+		close() の呼び出し後に他のスレッドから write() を呼び出してはならない
+
+		\return これまでの書き込みが全て成功したか
+	*/
+	bool close()
+	{
+		if (!thread_.joinable()) return !failed_;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+			++requested_;
+		}
+		writer_cv_.notify_one();
+		thread_.join();
+
+		ofs_.close();
+		return !failed_;
+	}
+
+	/// ファイルに書き込まれたバイト数
+	std::uint64_t bytes_written() const{ return bytes_; }
+
+	/// ファイルに書き込まれた行数
+	std::uint64_t lines_written() const{ return lines_; }
+};
+
+
+/// ConcurrentAppender へ1行追記する
+/**
+	\param src 保存対象
+	\param appender 書き込み先の ConcurrentAppender
+
+	\sa save_line(T src, typename impl::FStreamSelector<T>::ofstream& ofs)
+*/
+template <class T,
+	typename std::enable_if<!impl::container_traits<T>::exist>::type*& = enabler
+>
+void save_line(
+	T const& src,
+	ConcurrentAppender& appender)
+{
+	appender.write(src);
+}
+
+/// ConcurrentAppender へコンテナの1要素を1行としてまとめて追記する（各行は連続して書き込まれる）
+/**
+	\param src 保存対象（\ref sig_container ）
+	\param appender 書き込み先の ConcurrentAppender
+*/
+template <class C,
+	typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+>
+void save_line(
+	C const& src,
+	ConcurrentAppender& appender)
+{
+	appender.write(src);
+}
+
+}
+#endif
@@ -0,0 +1,346 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_CSV_HPP
+#define SIG_UTIL_CSV_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/maybe.hpp"
+#include "../helper/charconv.hpp"
+#include "mapped_file.hpp"
+
+#include <vector>
+#include <tuple>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+
+/// \file csv.hpp CSV, TSV形式 (RFC 4180) のファイルの読み込み
+
+namespace sig
+{
+namespace impl
+{
+
+// [first, last) から最初に現れる文字 a または b を探す (8byte単位で一括判定し、候補を含む語のみ1byteずつ調べる)
+inline char const* find_either(char const* first, char const* last, char a, char b)
+{
+	const std::uint64_t ones = 0x0101010101010101ULL;
+	const std::uint64_t highs = 0x8080808080808080ULL;
+	const std::uint64_t ma = ones * static_cast<unsigned char>(a);
+	const std::uint64_t mb = ones * static_cast<unsigned char>(b);
+
+	while (last - first >= 8){
+		std::uint64_t w;
+		std::memcpy(&w, first, sizeof(w));
+
+		const std::uint64_t xa = w ^ ma;
+		const std::uint64_t xb = w ^ mb;
+		if ((((xa - ones) & ~xa) | ((xb - ones) & ~xb)) & highs) break;	// a または b と一致するバイトを含む
+		first += 8;
+	}
+	for (; first != last; ++first){
+		if (*first == a || *first == b) return first;
+	}
+	return last;
+}
+
+// CSVの1フィールドの値を型Tに変換する
+template <class T>
+struct CsvFieldConverter
+{
+	static T convert(string_view field){ return parse_num<T>(field.data(), field.data() + field.size()); }
+};
+template <>
+struct CsvFieldConverter<string_view>
+{
+	static string_view convert(string_view field){ return field; }
+};
+template <>
+struct CsvFieldConverter<std::string>
+{
+	static std::string convert(string_view field){ return std::string(field.data(), field.size()); }
+};
+
+}	// impl
+
+
+/// CSV, TSV形式 (RFC 4180) のファイルを1レコードずつ読み込むリーダー
+/**
+	ファイルはメモリマップで読み込まれ、各フィールドはコピーせずに string_view で参照される（"" のエスケープを含むフィールドのみ内部のバッファに展開される）．\n
+	ダブルクォートで囲まれたフィールド（区切り文字・改行・エスケープされたダブルクォートを含むもの）に対応し、改行は LF, CRLF のどちらでもよい．空行は読み飛ばされる．\n
+	select() で取得する列を指定した場合、指定されていない列は区切り位置の探索のみ行い、値の展開・変換は行わない．\n
+	フィールドの値は次に next() を呼ぶまで有効である．
+
+	\code
+	// data.csv
+	id,name,score
+	1,"Smith, John",82.5
+	2,"say ""hello""",90
+
+	CsvReader csv(fpass);
+	csv.next();				// ヘッダ行を読み飛ばす
+	csv.select({ 2, 0 });	// score, id の順に取得
+
+	while (csv.next()){
+		double score = csv.get<double>(0);
+		int id = csv.get<int>(1);
+	}
+	\endcode
+*/
+class CsvReader
+{
+	MappedFile file_;
+	char const* pos_;
+	char const* end_;
+	char delimiter_;
+
+	std::vector<int> slot_;			// 列番号 -> 格納先 (-1: 取得しない)
+	std::vector<std::pair<uint, uint>> duplicates_;	// 同じ列を複数回指定した場合の (格納先, 最初の格納先)
+	bool select_all_;
+
+	std::vector<string_view> fields_;
+	std::vector<std::pair<uint, uint>> escaped_;	// buffer_ に展開したフィールド (格納先, buffer_ 中の開始位置)
+	std::string buffer_;
+	uint record_num_;
+
+private:
+	// 取得するフィールドを格納
+	void store(uint column, char const* first, char const* last)
+	{
+		if (select_all_){
+			fields_.push_back(string_view(first, last - first));
+		}
+		else if (column < slot_.size() && slot_[column] >= 0){
+			fields_[slot_[column]] = string_view(first, last - first);
+		}
+	}
+
+	bool wanted(uint column) const{ return select_all_ || (column < slot_.size() && slot_[column] >= 0); }
+
+	// ダブルクォートで囲まれたフィールドを読み、終了位置を返す
+	char const* read_quoted(uint column, char const* p)
+	{
+		char const* first = ++p;
+		char const* q = static_cast<char const*>(std::memchr(p, '"', end_ - p));
+
+		// エスケープを含まない場合はマッピングを直接参照
+		if (!q || q + 1 == end_ || *(q + 1) != '"'){
+			if (!q) q = end_;
+			store(column, first, q);
+			return q == end_ ? q : q + 1;
+		}
+
+		const bool keep = wanted(column);
+		const uint offset = buffer_.size();
+		while (q && q + 1 != end_ && *(q + 1) == '"'){
+			if (keep) buffer_.append(first, q + 1);
+			first = q + 2;
+			q = static_cast<char const*>(std::memchr(first, '"', end_ - first));
+		}
+		if (!q) q = end_;
+		if (keep){
+			buffer_.append(first, q);
+			store(column, nullptr, nullptr);
+			escaped_.push_back(std::make_pair(select_all_ ? fields_.size() - 1 : static_cast<uint>(slot_[column]), offset));
+			escaped_.push_back(std::make_pair(0, buffer_.size()));		// 終了位置
+		}
+		return q == end_ ? q : q + 1;
+	}
+
+public:
+	/// ファイルを開く
+	/**
+		\param file_pass 読み込むファイルのパス
+		\param delimiter [option] 区切り文字（CSV: ',', TSV: '\\t'）
+	*/
+	explicit CsvReader(FilepassString const& file_pass, char delimiter = ',')
+		: file_(file_pass), pos_(file_.data()), end_(file_.data() + file_.size()), delimiter_(delimiter), select_all_(true), record_num_(0)
+	{
+		// UTF-8 の BOM を読み飛ばす
+		if (end_ - pos_ >= 3 && std::memcmp(pos_, "\xEF\xBB\xBF", 3) == 0) pos_ += 3;
+	}
+
+	/// ファイルを開けたか
+	bool is_open() const{ return file_.is_open(); }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 取得する列を指定する
+	/**
+		\param columns 取得する列番号（0始まり）. 取得したフィールドはこの順番で operator[], get() から参照される．空の場合は全ての列．同じ列を複数回指定してもよい
+	*/
+	void select(std::vector<uint> const& columns)
+	{
+		select_all_ = columns.empty();
+		slot_.clear();
+		duplicates_.clear();
+
+		for (uint i = 0; i < columns.size(); ++i){
+			if (columns[i] >= slot_.size()) slot_.resize(columns[i] + 1, -1);
+			if (slot_[columns[i]] >= 0) duplicates_.push_back(std::make_pair(i, static_cast<uint>(slot_[columns[i]])));
+			else slot_[columns[i]] = static_cast<int>(i);
+		}
+		fields_.assign(columns.size(), string_view());
+	}
+
+	/// 次のレコードを読み込む
+	/**
+		\return レコードが存在したか（ファイルの終端に達した場合は false）
+	*/
+	bool next()
+	{
+		// 空行を読み飛ばす
+		while (pos_ != end_ && (*pos_ == '\n' || *pos_ == '\r')) ++pos_;
+		if (pos_ == end_) return false;
+
+		buffer_.clear();
+		escaped_.clear();
+		if (select_all_) fields_.clear();
+		else std::fill(fields_.begin(), fields_.end(), string_view());
+
+		for (uint column = 0;; ++column){
+			char const* p = pos_;
+
+			if (*p == '"'){
+				p = read_quoted(column, p);
+				// 閉じクォートの後に続く文字は区切り文字まで無視する
+				p = impl::find_either(p, end_, delimiter_, '\n');
+			}
+			else{
+				char const* last = impl::find_either(p, end_, delimiter_, '\n');
+				char const* field_end = (last != p && *(last - 1) == '\r' && (last == end_ || *last == '\n')) ? last - 1 : last;
+				store(column, p, field_end);
+				p = last;
+			}
+
+			if (p == end_){
+				pos_ = p;
+				break;
+			}
+			pos_ = p + 1;
+			if (*p == '\n') break;
+			if (pos_ == end_){
+				store(column + 1, pos_, pos_);	// 末尾の区切り文字の後の空フィールド
+				break;
+			}
+		}
+
+		// buffer_ への展開が終わってから参照を設定
+		for (uint i = 0; i < escaped_.size(); i += 2){
+			fields_[escaped_[i].first] = string_view(buffer_.data() + escaped_[i].second, escaped_[i + 1].second - escaped_[i].second);
+		}
+		for (auto const& d : duplicates_) fields_[d.first] = fields_[d.second];
+		++record_num_;
+		return true;
+	}
+
+	/// 現在のレコードで取得したフィールド数（select() で列を指定した場合はその数）
+	uint size() const{ return fields_.size(); }
+
+	/// 現在のレコードの index 番目のフィールド（存在しない列の場合は空）
+	string_view operator[](uint index) const{ return index < fields_.size() ? fields_[index] : string_view(); }
+
+	/// 現在のレコードの index 番目のフィールドを型Tに変換して取得
+	/**
+		\tparam T 数値型, string_view, std::string のいずれか
+
+		\exception std::invalid_argument（数値に変換できない場合）, std::out_of_range（変換後の値が型Tで表現できない場合）
+	*/
+	template <class T>
+	T get(uint index) const{ return impl::CsvFieldConverter<T>::convert((*this)[index]); }
+
+	/// これまでに読み込んだレコード数
+	uint record_num() const{ return record_num_; }
+
+	/// 参照しているマッピング
+	MappedFile const& file() const{ return file_; }
+};
+
+
+namespace impl
+{
+template <uint I, class TUPLE>
+struct CsvColumnAppender
+{
+	static void append(TUPLE& dest, CsvReader const& csv)
+	{
+		using T = typename std::tuple_element<I - 1, TUPLE>::type::value_type;
+		std::get<I - 1>(dest).push_back(csv.get<T>(I - 1));
+		CsvColumnAppender<I - 1, TUPLE>::append(dest, csv);
+	}
+};
+template <class TUPLE>
+struct CsvColumnAppender<0, TUPLE>
+{
+	static void append(TUPLE&, CsvReader const&){}
+};
+
+// 型の並び Ts に T が含まれるか
+template <class T, class... Ts>
+struct contains_type : std::false_type{};
+template <class T, class U, class... Ts>
+struct contains_type<T, U, Ts...> : std::integral_constant<bool, std::is_same<T, U>::value || contains_type<T, Ts...>::value>{};
+}	// impl
+
+/// CSV, TSV形式のファイルから指定した列を型を指定して読み込む
+/**
+	指定していない列は値の変換を行わずに読み飛ばす
+
+	\tparam Ts 各列の型（数値型 または std::string）. 読み込み後にファイルは閉じられるため string_view は指定できない
+
+	\param file_pass 読み込むファイルのパス
+	\param columns 読み込む列番号（0始まり）. Ts と同じ順番で指定
+	\param delimiter [option] 区切り文字（CSV: ',', TSV: '\\t'）
+	\param skip_header [option] 先頭行をヘッダとして読み飛ばすか
+
+	\return 各列の値を格納した std::vector の tuple（値は\ref sig_maybe で返される）
+
+	\exception std::invalid_argument（数値に変換できない場合）, std::out_of_range（変換後の値が型Tで表現できない場合）
+
+	\code
+	// data.csv
+	id,name,score
+	1,"Smith, John",82.5
+	2,"say ""hello""",90
+
+	auto data = load_csv_columns<int, double>(fpass, { 0, 2 }, ',', true);
+
+	auto& ids = std::get<0>(*data);		// std::vector<int>{ 1, 2 }
+	auto& scores = std::get<1>(*data);	// std::vector<double>{ 82.5, 90 }
+	\endcode
+*/
+template <class... Ts>
+auto load_csv_columns(
+	FilepassString const& file_pass,
+	std::array<uint, sizeof...(Ts)> const& columns,
+	char delimiter = ',',
+	bool skip_header = false)
+	->Maybe<std::tuple<std::vector<Ts>...>>
+{
+	static_assert(!std::is_same<std::tuple<Ts...>, std::tuple<>>::value, "specify column types");
+	static_assert(!impl::contains_type<string_view, Ts...>::value, "string_view would refer to the closed file. use std::string instead");
+
+	using ResultType = std::tuple<std::vector<Ts>...>;
+
+	ResultType result;
+	CsvReader csv(file_pass, delimiter);
+
+	if (!csv) return Nothing(std::move(result));
+	if (skip_header) csv.next();
+
+	csv.select(std::vector<uint>(columns.begin(), columns.end()));
+
+	while (csv.next()){
+		impl::CsvColumnAppender<sizeof...(Ts), ResultType>::append(result, csv);
+	}
+	return Just<ResultType>(std::move(result));
+}
+
+}
+#endif
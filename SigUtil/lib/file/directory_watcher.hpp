@@ -0,0 +1,363 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_DIRECTORY_WATCHER_HPP
+#define SIG_UTIL_DIRECTORY_WATCHER_HPP
+
+#include "pass.hpp"
+#include "mapped_file.hpp"
+#include "../helper/utf8.hpp"
+#include "../string/convert.hpp"
+
+#include <set>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+#if SIG_LINUX_ENV
+	#include <sys/inotify.h>
+	#include <poll.h>
+	#include <unistd.h>
+#endif
+
+
+/// \file directory_watcher.hpp ディレクトリ内のファイルの作成・変更・削除の監視
+
+namespace sig
+{
+
+/// ファイルに対する変更の種類
+enum class FileEvent
+{
+	created,	///< 作成された（名前の変更で現れた場合を含む）
+	modified,	///< 内容が変更された
+	removed		///< 削除された（名前の変更で消えた場合を含む）
+};
+
+/// ファイルに対する変更
+struct FileChange
+{
+	FileEvent event;
+	std::wstring name;		///< ファイル名
+};
+
+
+/// ディレクトリ内のファイルの一覧を保持し、ファイルの作成・変更・削除をまとめて通知するウォッチャー
+/**
+	get_file_names と同じ条件（隠しファイルか否か, 拡張子）に合うファイルの一覧をメモリ上に保持し、poll() を呼ぶ毎に前回からの変更を返す．\n
+	Linux環境では inotify でディレクトリの変更を受け取るため、ディレクトリの再走査は行わない（カーネルのイベントキューが溢れた場合のみ再走査する）．\n
+	その他の環境では poll() の度にディレクトリを走査し、ファイルの一覧・サイズ・更新時刻を比較して変更を検出する．\n
+	1回の poll() で返される変更はファイル毎にまとめられる（作成後に変更された場合は created のみ、作成後に削除された場合は何も返さない）．\n
+	サブディレクトリは監視しない．poll() と files() は異なるスレッドから同時に呼び出してよい．
+
+	\code
+	DirectoryWatcher watcher(SIG_TO_FPSTR("./inbox"), false, L".csv");
+
+	for (auto const& name : watcher.files()) ingest(name);	// 既存のファイル
+
+	while (watcher){
+		for (auto const& change : watcher.poll(1000)){		// 変更があるまで最大1秒待機
+			if (change.event == FileEvent::created) ingest(change.name);
+		}
+	}
+	\endcode
+*/
+class DirectoryWatcher
+{
+	FilepassString directory_pass_;
+	bool hidden_file_;
+	std::wstring extension_;
+
+	std::set<std::wstring> files_;
+	mutable std::mutex mutex_;		// files_ の保護
+	std::mutex poll_mutex_;			// poll() の直列化
+	bool is_open_;
+
+#if SIG_LINUX_ENV
+	int fd_;
+	std::vector<char> buffer_;
+#else
+	std::map<std::wstring, impl::FileStamp> stamps_;
+#endif
+
+	// 1回の poll() 中に変更されたファイル (変更前に存在したか, 変更後に存在するか)
+	struct Touched
+	{
+		std::wstring name;
+		bool existed;
+		bool exists;
+	};
+
+private:
+	bool accept(std::wstring const& name, bool hidden) const
+	{
+		if (!Consistency(hidden_file_, hidden)) return false;
+		return extension_.empty() || (name.size() > extension_.size() && name.compare(name.size() - extension_.size(), extension_.size(), extension_) == 0);
+	}
+
+	// ディレクトリを走査してファイルの一覧を取得する
+	bool scan(std::set<std::wstring>& dest) const
+	{
+#if SIG_LINUX_ENV
+		std::vector<FilepassString> names;
+		if (!impl::scan_names(directory_pass_, impl::ScanCondition{ SIG_TO_FPSTR(""), false, true, false }, 1, names)) return false;
+
+		for (auto const& name : names){
+			std::wstring wname;
+			impl::append_utf8_as_wide(name.data(), name.data() + name.size(), wname);
+			if (accept(wname, name[0] == '.')) dest.insert(std::move(wname));
+		}
+		return true;
+#else
+		try{
+			auto names = get_file_names(directory_pass_, hidden_file_, extension_);
+			if (isNothing(names)) return false;
+			dest.insert(fromJust(names).begin(), fromJust(names).end());
+			return true;
+		}
+		catch (std::exception const&){
+			return false;	// boost::filesystem はディレクトリが存在しない場合に例外を送出する
+		}
+#endif
+	}
+
+#if !SIG_LINUX_ENV
+	impl::FileStamp stamp(std::wstring const& name) const
+	{
+	#if SIG_MSVC_ENV
+		return impl::get_file_stamp(modify_dirpass_tail(directory_pass_, true) + name);
+	#else
+		return impl::get_file_stamp(modify_dirpass_tail(directory_pass_, true) + wstr_to_str(name));
+	#endif
+	}
+#endif
+
+	// 新しい一覧 current と保持している一覧を比較して変更を求め、一覧を置き換える
+	void replace_files(std::set<std::wstring>& current, std::vector<Touched> const& touched, std::vector<FileChange>& changes)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		for (auto const& name : files_){
+			if (!current.count(name)) changes.push_back(FileChange{ FileEvent::removed, name });
+		}
+		for (auto const& name : current){
+			if (!files_.count(name)) changes.push_back(FileChange{ FileEvent::created, name });
+		}
+		for (auto const& t : touched){
+			if (files_.count(t.name) && current.count(t.name)) changes.push_back(FileChange{ FileEvent::modified, t.name });
+		}
+		files_.swap(current);
+	}
+
+	// 監視対象のディレクトリが削除・移動された
+	void close(std::vector<FileChange>& changes)
+	{
+		std::set<std::wstring> empty;
+		replace_files(empty, std::vector<Touched>(), changes);
+#if SIG_LINUX_ENV
+		::close(fd_);
+		fd_ = -1;
+#endif
+		is_open_ = false;
+	}
+
+#if SIG_LINUX_ENV
+	// 読み込み可能なイベントを全て読み込み、ファイル毎にまとめる. 監視を続けられない場合は false
+	bool read_events(std::vector<Touched>& touched, bool& overflow)
+	{
+		std::unordered_map<std::wstring, uint> index;
+
+		while (true){
+			const ssize_t n = ::read(fd_, buffer_.data(), buffer_.size());
+			if (n <= 0) break;
+
+			for (char const* p = buffer_.data(); p < buffer_.data() + n;){
+				inotify_event ev;
+				std::memcpy(&ev, p, sizeof(ev));
+				char const* name = p + sizeof(ev);
+				p += sizeof(ev) + ev.len;
+
+				if (ev.mask & IN_Q_OVERFLOW) overflow = true;
+				if (ev.mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) return false;
+				if (ev.len == 0 || (ev.mask & IN_ISDIR)) continue;
+
+				std::wstring wname;
+				impl::append_utf8_as_wide(name, name + std::strlen(name), wname);
+				if (!accept(wname, name[0] == '.')) continue;
+
+				const bool exists = (ev.mask & (IN_DELETE | IN_MOVED_FROM)) == 0;
+				auto it = index.find(wname);
+				if (it != index.end()){
+					touched[it->second].exists = exists;
+					continue;
+				}
+				bool existed;
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					existed = files_.count(wname) != 0;
+				}
+				index.emplace(wname, touched.size());
+				touched.push_back(Touched{ std::move(wname), existed, exists });
+			}
+		}
+		return true;
+	}
+#endif
+
+public:
+	/// ディレクトリの監視を開始する
+	/**
+		\param directory_pass 監視するディレクトリのパス
+		\param hidden_file [option] true:隠しファイルのみ, false:非隠しファイルのみ
+		\param extension [option] 拡張子指定
+	*/
+	explicit DirectoryWatcher(
+		FilepassString const& directory_pass,
+		bool hidden_file = false,
+		std::wstring const& extension = L"")
+		: directory_pass_(directory_pass), hidden_file_(hidden_file), extension_(extension), is_open_(false)
+	{
+#if SIG_LINUX_ENV
+		fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd_ < 0) return;
+
+		// 監視を開始してから走査する（走査中の変更は最初の poll() で通知される）
+		const uint32_t mask = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+		if (::inotify_add_watch(fd_, directory_pass.c_str(), mask) < 0 || !scan(files_)){
+			::close(fd_);
+			fd_ = -1;
+			return;
+		}
+		buffer_.resize(1 << 16);
+#else
+		if (!scan(files_)) return;
+		for (auto const& name : files_) stamps_[name] = stamp(name);
+#endif
+		is_open_ = true;
+	}
+
+	~DirectoryWatcher()
+	{
+#if SIG_LINUX_ENV
+		if (fd_ >= 0) ::close(fd_);
+#endif
+	}
+
+	DirectoryWatcher(DirectoryWatcher const&) = delete;
+	DirectoryWatcher& operator=(DirectoryWatcher const&) = delete;
+
+	/// 監視中か（ディレクトリを開けなかった場合、監視中のディレクトリが削除・移動された場合は false）
+	bool is_open() const{ return is_open_; }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 前回の呼び出し以降の変更を取得する
+	/**
+		監視中のディレクトリが削除・移動された場合は、残っていた全てのファイルの removed を返して監視を終了する
+
+		\param timeout_ms [option] 変更が無い場合に待機する時間（ミリ秒. 0の場合は待機しない, 負の場合は変更があるまで待機する）
+
+		\return ファイルに対する変更（ファイル毎に1つ）
+	*/
+	std::vector<FileChange> poll(int timeout_ms = 0)
+	{
+		std::lock_guard<std::mutex> poll_lock(poll_mutex_);
+		std::vector<FileChange> changes;
+		if (!is_open_) return changes;
+
+#if SIG_LINUX_ENV
+		pollfd pfd = { fd_, POLLIN, 0 };
+		if (::poll(&pfd, 1, timeout_ms) <= 0) return changes;
+
+		std::vector<Touched> touched;
+		bool overflow = false;
+
+		if (!read_events(touched, overflow)){
+			close(changes);
+			return changes;
+		}
+		if (overflow){
+			// 取りこぼしたイベントがあるため走査し直す
+			std::set<std::wstring> current;
+			if (!scan(current)){
+				close(changes);
+				return changes;
+			}
+			replace_files(current, touched, changes);
+			return changes;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto const& t : touched){
+			if (t.existed && t.exists) changes.push_back(FileChange{ FileEvent::modified, t.name });
+			else if (t.existed){
+				changes.push_back(FileChange{ FileEvent::removed, t.name });
+				files_.erase(t.name);
+			}
+			else if (t.exists){
+				changes.push_back(FileChange{ FileEvent::created, t.name });
+				files_.insert(t.name);
+			}
+		}
+#else
+		const auto limit = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+		while (true){
+			std::set<std::wstring> current;
+			if (!scan(current)){
+				close(changes);
+				stamps_.clear();
+				return changes;
+			}
+
+			std::map<std::wstring, impl::FileStamp> stamps;
+			std::vector<Touched> touched;
+			for (auto const& name : current){
+				stamps[name] = stamp(name);
+				auto it = stamps_.find(name);
+				if (it != stamps_.end() && it->second != stamps[name]) touched.push_back(Touched{ name, true, true });
+			}
+			replace_files(current, touched, changes);
+			stamps_.swap(stamps);
+
+			if (!changes.empty() || (timeout_ms >= 0 && std::chrono::steady_clock::now() >= limit)) break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+#endif
+		return changes;
+	}
+
+	/// 現在のファイルの一覧（辞書順）
+	std::vector<std::wstring> files() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return std::vector<std::wstring>(files_.begin(), files_.end());
+	}
+
+	/// ファイルが一覧に含まれるか
+	bool contains(std::wstring const& name) const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return files_.count(name) != 0;
+	}
+
+	/// 一覧に含まれるファイル数
+	uint size() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return files_.size();
+	}
+
+	/// 監視しているディレクトリのパス
+	FilepassString const& directory_pass() const{ return directory_pass_; }
+};
+
+}
+#endif
@@ -0,0 +1,417 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_EXTERNAL_SORT_HPP
+#define SIG_UTIL_EXTERNAL_SORT_HPP
+
+#include "load.hpp"
+#include "pass.hpp"
+#include "../helper/parallel.hpp"
+
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <cstring>
+
+
+/// \file external_sort.hpp メモリに収まらないテキストファイルの行単位のソート（外部マージソート）
+
+namespace sig
+{
+namespace impl
+{
+
+// 行とその比較キー
+template <class K>
+struct SortRecord
+{
+	K key;
+	string_view line;
+};
+
+// 行全体をキーとする
+struct LineAsKey
+{
+	string_view operator()(string_view line) const{ return line; }
+};
+
+// [first, last) を thread_num 個に分けて並列に安定ソートし、順にマージする
+template <class It, class F>
+void parallel_stable_sort(It first, It last, F const& less, uint thread_num)
+{
+	const uint size = last - first;
+	const uint n = std::max<uint>(std::min<uint>(resolve_thread_num(thread_num), size / (1 << 12)), 1);
+
+	std::vector<uint> bounds(n + 1);
+	for (uint i = 0; i <= n; ++i) bounds[i] = size * i / n;
+
+	parallel_generate<int>(n, n, [&](uint i){
+		std::stable_sort(first + bounds[i], first + bounds[i + 1], less);
+		return 0;
+	});
+	for (uint step = 1; step < n; step *= 2){
+		parallel_generate<int>((n + 2 * step - 1) / (2 * step), n, [&](uint i){
+			const uint lo = i * 2 * step, mid = std::min(lo + step, n), hi = std::min(lo + 2 * step, n);
+			if (mid < hi) std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], less);
+			return 0;
+		});
+	}
+}
+
+// 行をバッファに溜めてまとめて書き込む
+class SortedLineWriter
+{
+	std::ofstream ofs_;
+	std::string buffer_;
+	uint buffer_size_;
+
+public:
+	SortedLineWriter(FilepassString const& file_pass, std::ios::openmode mode, uint buffer_size)
+		: ofs_(file_pass, mode | std::ios::trunc), buffer_size_(buffer_size)
+	{
+		buffer_.reserve(buffer_size_);
+	}
+
+	bool is_open() const{ return ofs_.is_open(); }
+
+	void write(string_view line)
+	{
+		buffer_.append(line.data(), line.size());
+		buffer_.push_back('\n');
+		if (buffer_.size() >= buffer_size_) flush();
+	}
+
+	void flush()
+	{
+		ofs_.write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+
+	bool close()
+	{
+		flush();
+		ofs_.close();
+		return !ofs_.fail();
+	}
+};
+
+// ソート済みのランを先頭から1行ずつ読み込む
+template <class K, class KF>
+class SortedRunReader
+{
+	std::ifstream ifs_;
+	std::vector<char> buffer_;
+	uint begin_;
+	uint end_;
+	bool eof_;
+	KF const* key_func_;
+
+public:
+	string_view line;
+	std::vector<K> key;		// 現在の行のキー (要素数1)
+
+public:
+	SortedRunReader(FilepassString const& file_pass, uint buffer_size, KF const& key_func)
+		: ifs_(file_pass, std::ios::in | std::ios::binary), buffer_(std::max<uint>(buffer_size, 1)), begin_(0), end_(0), eof_(false), key_func_(&key_func)
+	{}
+
+	// 次の行を読み込む (終端に達した場合は false)
+	bool next()
+	{
+		while (true){
+			auto nl = static_cast<char const*>(std::memchr(buffer_.data() + begin_, '\n', end_ - begin_));
+			if (nl || (eof_ && begin_ != end_)){
+				const uint line_end = nl ? nl - buffer_.data() : end_;
+				line = string_view(buffer_.data() + begin_, line_end - begin_);
+				begin_ = nl ? line_end + 1 : end_;
+				key.clear();
+				key.push_back((*key_func_)(line));
+				return true;
+			}
+			if (eof_) return false;
+
+			// 未読の部分を先頭に移して補充する（1行がバッファに収まらない場合は拡張）
+			std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+			end_ -= begin_;
+			begin_ = 0;
+			if (end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+
+			ifs_.read(buffer_.data() + end_, buffer_.size() - end_);
+			end_ += static_cast<uint>(ifs_.gcount());
+			if (!ifs_) eof_ = true;
+		}
+	}
+
+	bool good() const{ return !ifs_.bad(); }
+};
+
+// 作成した一時ファイルを終了時に削除する
+struct TemporaryFiles
+{
+	std::vector<FilepassString> passes;
+
+	~TemporaryFiles(){ for (auto const& p : passes) remove_file(p); }
+};
+
+// 複数のソート済みのランを1つにマージする
+template <class K, class KF, class LF>
+bool merge_sorted_runs(
+	std::vector<FilepassString> const& runs,
+	FilepassString const& dest_pass,
+	std::ios::openmode mode,
+	KF const& key_func,
+	LF const& less,
+	bool unique,
+	uint memory_size)
+{
+	using Reader = SortedRunReader<K, KF>;
+
+	const uint buffer_size = std::max<uint>(memory_size / (runs.size() + 1), 1 << 16);
+
+	std::vector<std::unique_ptr<Reader>> readers;
+	for (auto const& run : runs) readers.emplace_back(new Reader(run, buffer_size, key_func));
+
+	// キーが最小の行を持つランを先頭にする (キーが等しい場合は前のランを優先)
+	auto greater = [&](uint a, uint b){
+		if (less(readers[b]->key[0], readers[a]->key[0])) return true;
+		if (less(readers[a]->key[0], readers[b]->key[0])) return false;
+		return a > b;
+	};
+	std::priority_queue<uint, std::vector<uint>, decltype(greater)> heap(greater);
+	for (uint i = 0; i < readers.size(); ++i){
+		if (readers[i]->next()) heap.push(i);
+	}
+
+	SortedLineWriter writer(dest_pass, mode, buffer_size);
+	if (!writer.is_open()) return false;
+
+	std::string last_line;
+	std::vector<K> last_key;
+
+	while (!heap.empty()){
+		const uint i = heap.top();
+		heap.pop();
+		auto& reader = *readers[i];
+
+		if (!unique || last_key.empty() || less(last_key[0], reader.key[0])){
+			writer.write(reader.line);
+			if (unique){
+				last_line.assign(reader.line.data(), reader.line.size());
+				last_key.clear();
+				last_key.push_back(key_func(string_view(last_line.data(), last_line.size())));
+			}
+		}
+		if (reader.next()) heap.push(i);
+	}
+
+	for (auto const& reader : readers){
+		if (!reader->good()) return false;
+	}
+	return writer.close();
+}
+
+template <class K, class KF, class LF>
+bool external_sort(
+	FilepassString const& src_pass,
+	FilepassString const& dest_pass,
+	KF const& key_func,
+	LF const& less,
+	bool unique,
+	uint memory_size,
+	uint thread_num,
+	FilepassString const& tmp_dir)
+{
+	const uint fan_in = 128;		// 1度にマージするランの最大数
+	const auto text_mode = std::ios::out;
+	const auto binary_mode = std::ios::out | std::ios::binary;
+
+	std::ifstream ifs(src_pass, std::ios::in | std::ios::binary);
+	if (!ifs) return false;
+
+	const auto run_base = tmp_dir.empty() ? dest_pass + SIG_TO_FPSTR(".run") : modify_dirpass_tail(tmp_dir, true) + SIG_TO_FPSTR("sort_run");
+	const auto dest_tmp = dest_pass + unique_tmp_suffix();
+
+	TemporaryFiles tmp_files;
+	tmp_files.passes.push_back(dest_tmp);
+
+	std::vector<FilepassString> runs;
+	auto new_run_pass = [&](){
+		tmp_files.passes.push_back(run_base + to_fpstring(tmp_files.passes.size()) + unique_tmp_suffix());
+		return tmp_files.passes.back();
+	};
+	auto new_run = [&](){
+		runs.push_back(new_run_pass());
+		return runs.back();
+	};
+
+	auto record_less = [&](SortRecord<K> const& a, SortRecord<K> const& b){ return less(a.key, b.key); };
+
+	// 1. memory_size 毎に読み込んでソートし、ランとして書き出す
+	std::vector<char> buffer(std::max<uint>(memory_size / 2, 1 << 16));
+	std::vector<SortRecord<K>> records;
+	uint filled = 0;
+	bool eof = false;
+	bool single_run = false;
+
+	while (true){
+		while (!eof && filled < buffer.size()){
+			ifs.read(buffer.data() + filled, buffer.size() - filled);
+			filled += static_cast<uint>(ifs.gcount());
+			if (!ifs) eof = true;
+		}
+		if (ifs.bad()) return false;
+		if (filled == 0 && !runs.empty()) break;
+
+		// 最後の改行までを1つのランとする（1行がバッファに収まらない場合は拡張）
+		uint cut = filled;
+		if (!eof){
+			while (cut && buffer[cut - 1] != '\n') --cut;
+			if (cut == 0){
+				buffer.resize(buffer.size() * 2);
+				continue;
+			}
+		}
+
+		records.clear();
+		for_each_line(buffer.data(), buffer.data() + cut, [&](char const* first, char const* last){
+			const string_view line(first, last - first);
+			records.push_back(SortRecord<K>{ key_func(line), line });
+		});
+		parallel_stable_sort(records.begin(), records.end(), record_less, thread_num);
+
+		// 全体が1つのランに収まる場合は直接出力する
+		single_run = eof && runs.empty();
+
+		SortedLineWriter writer(single_run ? dest_tmp : new_run(), single_run ? text_mode : binary_mode, 1 << 20);
+		if (!writer.is_open()) return false;
+
+		for (uint i = 0; i < records.size(); ++i){
+			if (unique && i && !less(records[i - 1].key, records[i].key)) continue;
+			writer.write(records[i].line);
+		}
+		if (!writer.close()) return false;
+
+		std::memmove(buffer.data(), buffer.data() + cut, filled - cut);
+		filled -= cut;
+		if (eof && filled == 0) break;
+	}
+	ifs.close();
+
+	// 2. ランの数が fan_in 以下になるまで段階的にマージし、最後に出力先へマージする
+	if (!single_run){
+		std::vector<char>().swap(buffer);
+		std::vector<SortRecord<K>>().swap(records);
+
+		// merge_sorted_runs は等しい行をランの番号順に出力するため、各段の出力は元のランの順番に並べて安定性を保つ
+		while (runs.size() > fan_in){
+			std::vector<FilepassString> merged;
+			for (std::size_t head = 0; head < runs.size(); head += fan_in){
+				std::vector<FilepassString> group(runs.begin() + head, runs.begin() + std::min<std::size_t>(head + fan_in, runs.size()));
+				if (group.size() == 1){
+					merged.push_back(group[0]);
+					continue;
+				}
+				merged.push_back(new_run_pass());
+				if (!merge_sorted_runs<K>(group, merged.back(), binary_mode, key_func, less, unique, memory_size)) return false;
+				for (auto const& run : group) remove_file(run);
+			}
+			runs.swap(merged);
+		}
+		if (!merge_sorted_runs<K>(runs, dest_tmp, text_mode, key_func, less, unique, memory_size)) return false;
+	}
+
+	return replace_file(dest_tmp, dest_pass);
+}
+
+}	// impl
+
+
+/// テキストファイルを行単位でソートする（外部マージソート）
+/**
+	ファイル全体をメモリに読み込まずにソートする．\n
+	ファイルを memory_size の半分程度ずつ読み込んで並列にソートし、一時ファイル（ラン）に書き出した後、全てのランを1度にマージして出力する．
+	（ランが128個を超える場合は段階的にマージする）\n
+	行の区切り方は load_line と同じで、出力の各行は改行で終わる．ソートは安定で、比較結果が等しい行は元のファイル中の順番で出力される．\n
+	出力は一時ファイルに書き込んでから置き換えるため、src_pass と dest_pass に同じパスを指定してもよい．
+
+	\param src_pass ソートするファイルのパス
+	\param dest_pass 出力先のパス
+	\param comp [option] 2つの行 (string_view) の大小比較を行う関数オブジェクト
+	\param unique [option] true の場合、比較結果が等しい行は最初の1行のみ出力する
+	\param memory_size [option] ソートに使用するメモリ量の目安（バイト数）
+	\param thread_num [option] ソートに使用するスレッド数（0の場合はハードウェアの並列数）
+	\param tmp_dir [option] 一時ファイルを作成するディレクトリ（空の場合は出力先と同じディレクトリ）
+
+	\return ソートの成否（読み込み・書き込みに失敗した場合は false. 作成した一時ファイルは削除される）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+
+	// 辞書順に並べ、重複する行を除く
+	sort_file(dir + SIG_TO_FPSTR("huge.txt"), dir + SIG_TO_FPSTR("sorted.txt"), std::less<string_view>(), true);
+
+	// 行の長さの降順, 1GBのメモリで
+	sort_file(dir + SIG_TO_FPSTR("huge.txt"), dir + SIG_TO_FPSTR("sorted.txt"), [](string_view a, string_view b){ return a.size() > b.size(); }, false, 1 << 30);
+	\endcode
+*/
+template <class F = std::less<string_view>>
+bool sort_file(
+	FilepassString const& src_pass,
+	FilepassString const& dest_pass,
+	F const& comp = F(),
+	bool unique = false,
+	uint memory_size = 1 << 28,
+	uint thread_num = 0,
+	FilepassString const& tmp_dir = FilepassString())
+{
+	return impl::external_sort<string_view>(src_pass, dest_pass, impl::LineAsKey(), comp, unique, memory_size, thread_num, tmp_dir);
+}
+
+/// テキストファイルを行から取り出したキーの昇順でソートする（外部マージソート）
+/**
+	キーは各行につき、ランの作成時とマージ時に1度ずつ計算される．\n
+	その他の動作は sort_file と同じ
+
+	\param src_pass ソートするファイルのパス
+	\param dest_pass 出力先のパス
+	\param key_func 行 (string_view) からキーを取り出す関数オブジェクト．キーは operator< で比較され、行を参照する string_view でもよい
+	\param unique [option] true の場合、キーが等しい行は最初の1行のみ出力する
+	\param memory_size [option] ソートに使用するメモリ量の目安（バイト数）
+	\param thread_num [option] ソートに使用するスレッド数（0の場合はハードウェアの並列数）
+	\param tmp_dir [option] 一時ファイルを作成するディレクトリ（空の場合は出力先と同じディレクトリ）
+
+	\return ソートの成否
+
+	\code
+	// "id,name" 形式の行を id の数値順に並べ、id の重複を除く
+	sort_file_by_key(src, dest, [](string_view line){
+		return std::stoll(std::string(line.data(), line.find(',')));
+	}, true);
+	\endcode
+
+	\sa sort_file
+*/
+template <class KF>
+bool sort_file_by_key(
+	FilepassString const& src_pass,
+	FilepassString const& dest_pass,
+	KF const& key_func,
+	bool unique = false,
+	uint memory_size = 1 << 28,
+	uint thread_num = 0,
+	FilepassString const& tmp_dir = FilepassString())
+{
+	using K = typename std::decay<decltype(key_func(std::declval<string_view>()))>::type;
+
+	return impl::external_sort<K>(src_pass, dest_pass, key_func, std::less<K>(), unique, memory_size, thread_num, tmp_dir);
+}
+
+}
+#endif
@@ -0,0 +1,351 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_LINE_INDEX_HPP
+#define SIG_UTIL_LINE_INDEX_HPP
+
+#include "load.hpp"
+
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+/// \file line_index.hpp テキストファイルの各行の位置の索引と任意の行の読み込み
+
+namespace sig
+{
+namespace impl
+{
+
+// 索引ファイルのヘッダ (48byte. 続けて各行の開始位置を width byte ずつ 行数+1 個格納する. 最後の値はファイルサイズ)
+struct LineIndexHeader
+{
+	char magic[8];				// "SIGLIDX"
+	std::uint32_t version;
+	std::uint32_t width;		// 開始位置1つのバイト数 (4 or 8)
+	std::uint64_t file_size;	// 索引を作成した時のファイルサイズ
+	std::uint64_t file_mtime;	// 索引を作成した時の最終更新時刻
+	std::uint64_t lines;		// 行数
+	std::uint64_t reserved;
+};
+static_assert(sizeof(LineIndexHeader) == 48, "unexpected padding in LineIndexHeader");
+
+static const char line_index_magic[8] = { 'S', 'I', 'G', 'L', 'I', 'D', 'X', '\0' };
+static const std::uint32_t line_index_version = 1;
+
+}	// impl
+
+
+/// テキストファイルの各行の開始位置の索引
+/**
+	ファイルを1度だけ走査して各行の開始位置の表を作成し、任意の行やある範囲の行をファイル全体を読み込まずに直接読み込む．\n
+	行の区切り方は load_line と同じ．作成した表は元ファイルと同じディレクトリに "元ファイル名.lidx" として保存され、
+	次回以降は元ファイルのサイズと最終更新時刻が一致する場合に限り、その表をメモリマップして再利用する．\n
+	開始位置は元ファイルが4GB未満の場合は4byte、それ以上の場合は8byteで保持する．\n
+	各行の読み込みは位置を指定した読み込み (pread) で行うため、複数のスレッドから同時に line(), lines() を呼び出してよい．\n
+	索引の作成後に元ファイルが書き換えられた場合の読み込み結果は保証されない．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("huge.txt");
+
+	LineIndex index(fpass);		// 初回のみファイルを走査し、huge.txt.lidx を保存
+
+	std::cout << index.size() << " lines" << std::endl;
+
+	auto line = index.line(123456);					// 123456行目 (0始まり. 値は\ref sig_maybe で返される)
+	auto block = index.lines(1000000, 100);		// 1000000行目から100行 (std::vector<std::string>)
+	\endcode
+*/
+class LineIndex
+{
+	FilepassString file_pass_;
+	std::uint64_t file_size_;
+
+	MappedFile mapped_table_;		// 保存した表を再利用する場合
+	std::vector<char> table_;		// 表を作成した場合
+	char const* offsets_;
+	uint width_;
+	uint line_num_;
+
+#if SIG_MSVC_ENV
+	HANDLE handle_;
+#elif SIG_LINUX_ENV
+	int fd_;
+#else
+	mutable std::ifstream ifs_;
+	mutable std::mutex mutex_;
+#endif
+
+private:
+	static FilepassString to_index_pass(FilepassString const& file_pass){ return file_pass + SIG_TO_FPSTR(".lidx"); }
+
+	static std::uint64_t read_offset(char const* table, uint width, uint i)
+	{
+		if (width == 4){
+			std::uint32_t v;
+			std::memcpy(&v, table + i * 4, 4);
+			return v;
+		}
+		std::uint64_t v;
+		std::memcpy(&v, table + i * 8, 8);
+		return v;
+	}
+
+	// 保存された表を検証して使用する
+	bool load_table(impl::FileStamp const& stamp)
+	{
+		MappedFile file(to_index_pass(file_pass_));
+		if (!file || file.size() < sizeof(impl::LineIndexHeader)) return false;
+
+		impl::LineIndexHeader h;
+		std::memcpy(&h, file.data(), sizeof(h));
+
+		if (std::memcmp(h.magic, impl::line_index_magic, sizeof(h.magic)) != 0 || h.version != impl::line_index_version) return false;
+		if (h.width != 4 && h.width != 8) return false;
+		if (h.file_size != stamp.size || h.file_mtime != stamp.mtime) return false;
+
+		// 行数は乗算でオーバーフローしないように検査し、開始位置は昇順で最後がファイルサイズであること
+		if (h.lines >= (file.size() - sizeof(h)) / h.width || file.size() != sizeof(h) + (h.lines + 1) * h.width) return false;
+
+		char const* table = file.data() + sizeof(h);
+		std::uint64_t prev = 0;
+		for (std::uint64_t i = 0; i <= h.lines; ++i){
+			const auto pos = read_offset(table, h.width, static_cast<uint>(i));
+			if (pos < prev) return false;
+			prev = pos;
+		}
+		if (prev != stamp.size) return false;
+
+		mapped_table_ = std::move(file);
+		offsets_ = mapped_table_.data() + sizeof(h);
+		width_ = h.width;
+		line_num_ = static_cast<uint>(h.lines);
+		return true;
+	}
+
+	// ファイルを走査して表を作成する
+	template <class W>
+	void build_table(MappedFile const& file)
+	{
+		const uint line_num = impl::count_lines(file.begin(), file.end());
+
+		table_.resize(sizeof(impl::LineIndexHeader) + (line_num + 1) * sizeof(W));
+		char* out = table_.data() + sizeof(impl::LineIndexHeader);
+
+		W pos = 0;
+		impl::for_each_line(file.begin(), file.end(), [&](char const* first, char const*){
+			pos = static_cast<W>(first - file.begin());
+			std::memcpy(out, &pos, sizeof(W));
+			out += sizeof(W);
+		});
+		pos = static_cast<W>(file.size());
+		std::memcpy(out, &pos, sizeof(W));
+
+		offsets_ = table_.data() + sizeof(impl::LineIndexHeader);
+		width_ = sizeof(W);
+		line_num_ = line_num;
+	}
+
+	bool save_table(impl::FileStamp const& stamp)
+	{
+		impl::LineIndexHeader h;
+		std::memcpy(h.magic, impl::line_index_magic, sizeof(h.magic));
+		h.version = impl::line_index_version;
+		h.width = width_;
+		h.file_size = stamp.size;
+		h.file_mtime = stamp.mtime;
+		h.lines = line_num_;
+		h.reserved = 0;
+		std::memcpy(table_.data(), &h, sizeof(h));
+
+		const auto index_pass = to_index_pass(file_pass_);
+		const auto tmp_pass = index_pass + impl::unique_tmp_suffix();
+		{
+			std::ofstream ofs(tmp_pass, std::ios::out | std::ios::binary | std::ios::trunc);
+			ofs.write(table_.data(), table_.size());
+			if (!ofs.flush()){
+				ofs.close();
+				impl::remove_file(tmp_pass);
+				return false;
+			}
+		}
+		return impl::replace_file(tmp_pass, index_pass);
+	}
+
+	// ファイルの pos から size byte を dest に読み込む
+	bool read_at(std::uint64_t pos, uint size, char* dest) const
+	{
+#if SIG_MSVC_ENV
+		while (size){
+			OVERLAPPED ov = {};
+			ov.Offset = static_cast<DWORD>(pos);
+			ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+			DWORD read = 0;
+			const DWORD n = static_cast<DWORD>(std::min<uint>(size, 1u << 30));
+			if (!ReadFile(handle_, dest, n, &read, &ov) || read == 0) return false;
+			pos += read; dest += read; size -= read;
+		}
+		return true;
+#elif SIG_LINUX_ENV
+		while (size){
+			const ssize_t read = ::pread(fd_, dest, size, static_cast<off_t>(pos));
+			if (read <= 0) return false;
+			pos += read; dest += read; size -= read;
+		}
+		return true;
+#else
+		std::lock_guard<std::mutex> lock(mutex_);
+		ifs_.clear();
+		ifs_.seekg(pos, std::ios::beg);
+		ifs_.read(dest, size);
+		return static_cast<uint>(ifs_.gcount()) == size;
+#endif
+	}
+
+	// 読み込んだ行の末尾の改行を除いた長さ
+	static uint trim_newline(char const* first, uint size)
+	{
+		if (size && first[size - 1] == '\n') --size;
+#if SIG_MSVC_ENV
+		if (size && first[size - 1] == '\r') --size;
+#endif
+		return size;
+	}
+
+public:
+	/// ファイルの索引を作成する（保存された索引が有効な場合はそれを使用する）
+	/**
+		\param file_pass 索引を作成するファイルのパス
+		\param persist [option] 作成した索引を "ファイル名.lidx" に保存するか
+	*/
+	explicit LineIndex(FilepassString const& file_pass, bool persist = true)
+		: file_pass_(file_pass), file_size_(0), offsets_(nullptr), width_(0), line_num_(0)
+	{
+#if SIG_MSVC_ENV
+		handle_ = CreateFileW(file_pass.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle_ == INVALID_HANDLE_VALUE) return;
+#elif SIG_LINUX_ENV
+		fd_ = ::open(file_pass.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd_ < 0) return;
+#else
+		ifs_.open(file_pass, std::ios::in | std::ios::binary);
+		if (!ifs_) return;
+#endif
+		const auto stamp = impl::get_file_stamp(file_pass);
+		file_size_ = stamp.size;
+
+		if (stamp.valid && load_table(stamp)) return;
+
+		MappedFile file(file_pass);
+		file_size_ = file.size();
+		if (file_size_ <= 0xffffffffULL) build_table<std::uint32_t>(file);
+		else build_table<std::uint64_t>(file);
+
+		if (persist && stamp.valid && impl::get_file_stamp(file_pass) == stamp) save_table(stamp);
+	}
+
+	~LineIndex()
+	{
+#if SIG_MSVC_ENV
+		if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+#elif SIG_LINUX_ENV
+		if (fd_ >= 0) ::close(fd_);
+#endif
+	}
+
+	LineIndex(LineIndex const&) = delete;
+	LineIndex& operator=(LineIndex const&) = delete;
+
+	/// ファイルを開けたか
+	bool is_open() const{ return offsets_ != nullptr; }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 行数
+	uint size() const{ return line_num_; }
+
+	bool empty() const{ return line_num_ == 0; }
+
+	/// i行目の開始位置（ファイル先頭からのバイト数. i == size() の場合はファイルサイズ）
+	std::uint64_t offset(uint i) const{ return read_offset(offsets_, width_, i); }
+
+	/// i行目を読み込む
+	/**
+		\param i 行番号（0始まり）
+
+		\return 読み込んだ行（改行文字は除く. 値は\ref sig_maybe で返される. 範囲外または読み込みに失敗した場合は Nothing）
+	*/
+	auto line(uint i) const ->Maybe<std::string>
+	{
+		if (i >= line_num_) return Nothing(std::string());
+
+		const auto first = offset(i);
+		std::string tmp(static_cast<uint>(offset(i + 1) - first), '\0');
+
+		if (!read_at(first, tmp.size(), &tmp[0])) return Nothing(std::string());
+		tmp.resize(trim_newline(tmp.data(), tmp.size()));
+		return Just<std::string>(std::move(tmp));
+	}
+
+	/// first行目から最大 count 行をまとめて読み込み、dest に追加する
+	/**
+		範囲全体を1度の読み込みで取得する
+
+		\param dest 保存先のコンテナ（\ref sig_container ）. 要素型は std::string 等の (char const*, char const*) から構築可能な型
+		\param first 先頭の行番号（0始まり）
+		\param count 読み込む行数（ファイルの末尾を超える分は無視される）
+
+		\return 追加した行数（読み込みに失敗した場合は 0）
+	*/
+	template <class C>
+	uint read_lines(C& dest, uint first, uint count) const
+	{
+		if (first >= line_num_) return 0;
+		const uint last = count < line_num_ - first ? first + count : line_num_;
+
+		const auto begin = offset(first);
+		std::vector<char> buffer(static_cast<uint>(offset(last) - begin));
+		if (!buffer.empty() && !read_at(begin, buffer.size(), buffer.data())) return 0;
+
+		impl::reserve_additional(dest, last - first);
+		for (uint i = first; i < last; ++i){
+			char const* p = buffer.data() + (offset(i) - begin);
+			const uint size = trim_newline(p, static_cast<uint>(offset(i + 1) - offset(i)));
+			impl::container_traits<C>::add_element(dest, typename impl::container_traits<C>::value_type(p, p + size));
+		}
+		return last - first;
+	}
+
+	/// first行目から最大 count 行をまとめて読み込む
+	/**
+		\return 読み込んだ行
+	*/
+	std::vector<std::string> lines(uint first, uint count) const
+	{
+		std::vector<std::string> tmp;
+		read_lines(tmp, first, count);
+		return tmp;
+	}
+
+	/// 索引を保存するファイルのパス
+	FilepassString index_pass() const{ return to_index_pass(file_pass_); }
+};
+
+}
+#endif
@@ -0,0 +1,298 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_LINE_STREAM_HPP
+#define SIG_UTIL_LINE_STREAM_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/eval.hpp"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <iterator>
+
+
+/// \file line_stream.hpp ファイルから1行ずつ遅延読み込みを行う入力レンジ
+
+namespace sig
+{
+namespace impl
+{
+
+// 固定長のバッファを使い回しながらファイルから1行ずつ取り出す
+class LineReader
+{
+	std::ifstream ifs_;
+	std::vector<char> buffer_;
+	uint pos_;			// 未読の先頭
+	uint scanned_;		// 改行の探索が済んでいる位置
+	uint filled_;		// バッファ中の有効なデータの末尾
+	bool eof_;
+
+private:
+	void assign(std::string& line, char const* first, char const* last) const
+	{
+#if SIG_MSVC_ENV
+		if (last != first && *(last - 1) == '\r') --last;	// テキストモードのifstreamと同様にCRLFを改行とみなす
+#endif
+		line.assign(first, last);
+	}
+
+public:
+	LineReader(FilepassString const& file_pass, uint buffer_size)
+		: buffer_(std::max<uint>(buffer_size, 1)), pos_(0), scanned_(0), filled_(0), eof_(false)
+	{
+		ifs_.rdbuf()->pubsetbuf(nullptr, 0);	// 自前のバッファに直接読み込む
+		ifs_.open(file_pass, std::ios::in | std::ios::binary);
+		eof_ = !ifs_;
+	}
+
+	bool is_open() const{ return ifs_.is_open(); }
+
+	// 次の行(改行文字は除く)を line に格納する. 行が残っていなければ false
+	bool next(std::string& line)
+	{
+		while (true){
+			char* data = buffer_.data();
+			auto nl = static_cast<char const*>(std::memchr(data + scanned_, '\n', filled_ - scanned_));
+
+			if (nl){
+				assign(line, data + pos_, nl);
+				pos_ = scanned_ = static_cast<uint>(nl - data) + 1;
+				return true;
+			}
+			if (eof_){
+				if (pos_ == filled_) return false;
+				assign(line, data + pos_, data + filled_);
+				pos_ = scanned_ = filled_;
+				return true;
+			}
+
+			// 未読部分をバッファの先頭に移して読み足す (バッファより長い行の場合のみバッファを拡張)
+			if (pos_ > 0){
+				std::memmove(data, data + pos_, filled_ - pos_);
+				filled_ -= pos_;
+				pos_ = 0;
+			}
+			scanned_ = filled_;
+			if (filled_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+
+			const auto n = ifs_.rdbuf()->sgetn(buffer_.data() + filled_, buffer_.size() - filled_);
+			if (n > 0) filled_ += static_cast<uint>(n);
+			else eof_ = true;
+		}
+	}
+};
+
+// 次の行を読み込み、変換関数を適用して value に格納する
+template <class T>
+bool fetch_line(LineReader& reader, std::string& line, T& value, std::function<T(std::string const&)> const& conv)
+{
+	if (!reader.next(line)) return false;
+	value = conv(line);
+	return true;
+}
+
+// 変換関数が無い場合は value のバッファに直接読み込む
+inline bool fetch_line(LineReader& reader, std::string& line, std::string& value, std::function<std::string(std::string const&)> const& conv)
+{
+	if (!conv) return reader.next(value);
+	if (!reader.next(line)) return false;
+	value = conv(line);
+	return true;
+}
+
+}	// impl
+
+
+/// ファイルの各行を1行ずつ遅延読み込みする入力レンジ
+/**
+	ファイル全体をメモリに読み込まず、固定長のバッファを使い回しながら1行ずつ取り出すため、メモリ使用量はファイルサイズに依存しない．\n
+	range-based for や sig::map, sig::filter, Histgram::count 等にそのまま渡すことができる．\n
+	入力レンジであるため各行は1度しか走査できない（走査を中断した場合、再度 begin() を呼ぶと続きから走査される）．\n
+	コピーはファイルの読み込み位置を共有する．
+
+	\tparam T 要素の型（std::string または変換関数の返り値の型）
+
+	\sa load_line_stream(FilepassString const& file_pass, uint buffer_size)
+*/
+template <class T>
+class LineStream
+{
+	struct State
+	{
+		impl::LineReader reader;
+		std::function<T(std::string const&)> conv;
+		std::string line;
+		T value;
+		bool has_value;
+
+		State(FilepassString const& file_pass, uint buffer_size, std::function<T(std::string const&)>&& conv)
+			: reader(file_pass, buffer_size), conv(std::move(conv)), has_value(false){}
+
+		void fetch(){ has_value = impl::fetch_line(reader, line, value, conv); }
+	};
+
+	std::shared_ptr<State> state_;
+
+public:
+	using value_type = T;
+
+	class const_iterator
+	{
+		State* state_;		// nullptr: end
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T const*;
+		using reference = T const&;
+
+		const_iterator() : state_(nullptr){}
+		explicit const_iterator(State* state) : state_(state && state->has_value ? state : nullptr){}
+
+		T const& operator*() const{ return state_->value; }
+		T const* operator->() const{ return &state_->value; }
+
+		const_iterator& operator++()
+		{
+			state_->fetch();
+			if (!state_->has_value) state_ = nullptr;
+			return *this;
+		}
+		void operator++(int){ ++*this; }
+
+		bool operator==(const_iterator const& other) const{ return state_ == other.state_; }
+		bool operator!=(const_iterator const& other) const{ return state_ != other.state_; }
+	};
+	using iterator = const_iterator;
+
+	LineStream(FilepassString const& file_pass, uint buffer_size, std::function<T(std::string const&)> conv)
+		: state_(std::make_shared<State>(file_pass, buffer_size, std::move(conv))){}
+
+	/// ファイルを開けたか
+	bool is_open() const{ return state_->reader.is_open(); }
+
+	explicit operator bool() const{ return is_open(); }
+
+	const_iterator begin() const
+	{
+		if (!state_->has_value) state_->fetch();
+		return const_iterator(state_.get());
+	}
+
+	const_iterator end() const{ return const_iterator(); }
+};
+
+namespace impl
+{
+template <class T>
+struct container_traits<LineStream<T>>
+{
+	static const bool exist = true;
+
+	using value_type = T;
+
+	template <class U>
+	using rebind = std::vector<U>;
+};
+}
+
+
+/// ファイルから1行ずつ遅延読み込みを行う入力レンジを返す
+/**
+	\param file_pass 読み込むファイルのパス
+	\param buffer_size [option] 読み込みに使用するバッファのバイト数（バッファより長い行がある場合のみ拡張される）
+
+	\return 各行(std::string)を順に返す入力レンジ. ファイルを開けなかった場合は空のレンジ (is_open() == false)
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("huge.txt");
+
+	for (auto const& line : load_line_stream(fpass)){
+		std::cout << line << std::endl;
+	}
+
+	auto errors = filter([](std::string const& line){ return line.find("ERROR") != std::string::npos; }, load_line_stream(fpass));	// std::vector<std::string>
+	\endcode
+*/
+inline auto load_line_stream(
+	FilepassString const& file_pass,
+	uint buffer_size = 1 << 16)
+	->LineStream<std::string>
+{
+	return LineStream<std::string>(file_pass, buffer_size, nullptr);
+}
+
+/// ファイルから1行ずつ遅延読み込みし、同時に変換処理を行う入力レンジを返す
+/**
+	\param file_pass 読み込むファイルのパス
+	\param conv 読み込んだ文字列から任意型への変換関数 (std::string const& -> R)
+	\param buffer_size [option] 読み込みに使用するバッファのバイト数（バッファより長い行がある場合のみ拡張される）
+
+	\return 各行の変換結果を順に返す入力レンジ. ファイルを開けなかった場合は空のレンジ (is_open() == false)
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("huge_num.txt");
+
+	Histgram<double, 10> hist(0, 1);
+	hist.count(load_line_stream(fpass, [](std::string const& line){ return std::stod(line); }));
+	\endcode
+*/
+template <class F, class R = typename impl::remove_const_reference<decltype(impl::eval(std::declval<F>(), std::declval<std::string const&>()))>::type>
+auto load_line_stream(
+	FilepassString const& file_pass,
+	F const& conv,
+	uint buffer_size = 1 << 16)
+	->LineStream<R>
+{
+	return LineStream<R>(file_pass, buffer_size, conv);
+}
+
+
+/// 1引数高階関数（LineStream 版）
+/**
+	(a -> b) -> [a] -> [b] \n
+	各行を読み込みながら関数を適用し、結果をstd::vectorに格納する
+
+	\sa map(F&& func, C&& list)
+*/
+template <class F, class T>
+auto map(F&& func, LineStream<T> list)
+	->std::vector<typename impl::remove_const_reference<decltype(impl::eval(std::forward<F>(func), std::declval<T const&>()))>::type>
+{
+	std::vector<typename impl::remove_const_reference<decltype(impl::eval(std::forward<F>(func), std::declval<T const&>()))>::type> result;
+
+	for (auto const& e : list) result.push_back(impl::eval(std::forward<F>(func), e));
+	return result;
+}
+
+/// コンテナから指定条件を満たす要素を抽出する（LineStream 版）
+/**
+	(a -> Bool) -> [a] -> [a] \n
+	各行を読み込みながら条件を判定し、条件を満たす要素のみをstd::vectorに格納する
+
+	\sa filter(F&& pred, C&& list)
+*/
+template <class F, class T>
+auto filter(F&& pred, LineStream<T> list) ->std::vector<T>
+{
+	std::vector<T> result;
+
+	for (auto const& e : list){
+		if (std::forward<F>(pred)(e)) result.push_back(e);
+	}
+	return result;
+}
+
+}
+#endif
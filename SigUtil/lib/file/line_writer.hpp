@@ -0,0 +1,250 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_LINE_WRITER_HPP
+#define SIG_UTIL_LINE_WRITER_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/string_view.hpp"
+#include "save.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/// \file line_writer.hpp バックグラウンドのスレッドで書き込みを行うバッファ付きの行単位ライター
+
+namespace sig
+{
+
+/// ファイルを開いたまま1行ずつ書き込むバッファ付きのライター
+/**
+	書き込んだ行は内部のバッファに蓄積され、バッファが一杯になるとバックグラウンドのスレッドに渡されてファイルに書き込まれる．\n
+	そのため、呼び出し元のスレッドはディスクへの書き込みを待たない（未処理のバッファが max_pending 個に達した場合のみ待機する）．\n
+	flush() で蓄積した全ての行の書き込み完了を待ち、close() またはデストラクタでファイルを閉じる．\n
+	出力内容は save_line で1行ずつ保存した場合と同じになる．\n
+	1つのライターを複数のスレッドから同時に使用することはできない．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("log.txt");
+
+	LineWriter writer(fpass, WriteMode::append);
+
+	for (int i = 0; i < 1000000; ++i){
+		writer.write("step: " + std::to_string(i));
+		save_line(i * 0.5, writer);	// save_line にも渡せる
+	}
+	writer.flush();	// ここまでの内容がファイルに書き込まれる
+	\endcode
+*/
+class LineWriter
+{
+	std::ofstream ofs_;
+	std::string buffer_;				// 呼び出し元のスレッドが書き込み中のバッファ
+	uint buffer_size_;
+	uint max_pending_;
+
+	std::deque<std::string> pending_;	// 書き込み待ちのバッファ
+	std::vector<std::string> spare_;	// 再利用するバッファ
+	bool writing_;
+	bool stop_;
+	bool failed_;
+	std::mutex mutex_;
+	std::condition_variable writer_cv_;
+	std::condition_variable producer_cv_;
+	std::thread thread_;
+
+	std::ostringstream oss_;
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		while (true){
+			writer_cv_.wait(lock, [&]{ return stop_ || !pending_.empty(); });
+			if (pending_.empty()) break;
+
+			std::string buf = std::move(pending_.front());
+			pending_.pop_front();
+			writing_ = true;
+			lock.unlock();
+
+			ofs_.write(buf.data(), buf.size());
+			const bool ok = static_cast<bool>(ofs_);
+			buf.clear();
+
+			lock.lock();
+			if (!ok) failed_ = true;
+			if (spare_.size() < max_pending_) spare_.push_back(std::move(buf));
+			writing_ = false;
+			producer_cv_.notify_all();
+		}
+	}
+
+	// 現在のバッファを書き込みスレッドに渡す
+	void submit()
+	{
+		if (buffer_.empty()) return;
+		if (!thread_.joinable()){ buffer_.clear(); return; }
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			producer_cv_.wait(lock, [&]{ return pending_.size() < max_pending_; });
+
+			pending_.push_back(std::move(buffer_));
+			if (spare_.empty()) buffer_ = std::string();
+			else{
+				buffer_ = std::move(spare_.back());
+				spare_.pop_back();
+			}
+		}
+		writer_cv_.notify_one();
+		buffer_.reserve(buffer_size_);
+	}
+
+	void end_line()
+	{
+		buffer_.push_back('\n');
+		if (buffer_.size() >= buffer_size_) submit();
+	}
+
+public:
+	/// ファイルを開き、書き込みスレッドを開始する
+	/**
+		\param file_pass 保存先のパス（ファイル名含む）
+		\param open_mode [option] 上書き(overwrite) or 追記(append)
+		\param buffer_size [option] 1つのバッファのバイト数（このサイズに達する毎に書き込みスレッドに渡される）
+		\param max_pending [option] 書き込み待ちのバッファの上限数
+	*/
+	explicit LineWriter(
+		FilepassString const& file_pass,
+		WriteMode open_mode = WriteMode::overwrite,
+		uint buffer_size = 1 << 20,
+		uint max_pending = 8)
+		: buffer_size_(std::max<uint>(buffer_size, 1)), max_pending_(std::max<uint>(max_pending, 1)), writing_(false), stop_(false), failed_(false)
+	{
+		const auto mode = open_mode == WriteMode::overwrite ? std::ios::out : std::ios::out | std::ios::app;
+		ofs_.open(file_pass, mode);
+
+		if (ofs_){
+			buffer_.reserve(buffer_size_);
+			thread_ = std::thread([this]{ run(); });
+		}
+		else failed_ = true;
+	}
+
+	~LineWriter(){ close(); }
+
+	LineWriter(LineWriter const&) = delete;
+	LineWriter& operator=(LineWriter const&) = delete;
+
+	/// ファイルを開けたか（close() 後は false）
+	bool is_open() const{ return thread_.joinable(); }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 1行書き込む（末尾に改行が追加される）
+	void write(std::string const& line){ buffer_.append(line); end_line(); }
+
+	void write(char const* line){ buffer_.append(line); end_line(); }
+
+	void write(string_view line){ buffer_.append(line.data(), line.size()); end_line(); }
+
+	/// 任意の型の値を std::ostream の出力形式で1行書き込む
+	template <class T,
+		typename std::enable_if<!impl::container_traits<T>::exist>::type*& = enabler
+	>
+	void write(T const& value)
+	{
+		oss_.str("");
+		oss_ << value;
+		buffer_.append(oss_.str());
+		end_line();
+	}
+
+	/// これまでに書き込んだ全ての行がファイルに書き込まれるまで待機する
+	/**
+		\return これまでの書き込みが全て成功したか
+	*/
+	bool flush()
+	{
+		submit();
+		if (!thread_.joinable()) return !failed_;
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		producer_cv_.wait(lock, [&]{ return pending_.empty() && !writing_; });
+
+		ofs_.flush();		// 書き込みスレッドは待機中
+		if (!ofs_) failed_ = true;
+		return !failed_;
+	}
+
+	/// 残りの行を書き込み、書き込みスレッドを終了してファイルを閉じる
+	/**
+		\return これまでの書き込みが全て成功したか
+	*/
+	bool close()
+	{
+		if (!thread_.joinable()) return !failed_;
+
+		flush();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		writer_cv_.notify_one();
+		thread_.join();
+
+		ofs_.close();
+		if (ofs_.fail()) failed_ = true;		// 閉じる際の書き込みの失敗
+		return !failed_;
+	}
+};
+
+
+/// LineWriter へ1行書き込む
+/**
+	\param src 保存対象
+	\param writer 書き込み先の LineWriter
+
+	\sa save_line(T src, typename impl::FStreamSelector<T>::ofstream& ofs)
+*/
+template <class T,
+	typename std::enable_if<!impl::container_traits<T>::exist>::type*& = enabler
+>
+void save_line(
+	T const& src,
+	LineWriter& writer)
+{
+	writer.write(src);
+}
+
+/// LineWriter へコンテナの1要素を1行としてまとめて書き込む
+/**
+	\param src 保存対象（\ref sig_container ）
+	\param writer 書き込み先の LineWriter
+*/
+template <class C,
+	typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+>
+void save_line(
+	C const& src,
+	LineWriter& writer)
+{
+	for (auto const& e : src) writer.write(e);
+}
+
+}
+#endif
@@ -10,9 +10,16 @@ http://opensource.org/licenses/mit-license.php
 
 #include "../helper/helper_modules.hpp"
 #include "../helper/maybe.hpp"
+#include "../helper/container_helper.hpp"
+#include "../helper/charconv.hpp"
+#include "../helper/parallel.hpp"
+#include "../helper/utf8.hpp"
+#include "../helper/token.hpp"
+#include "mapped_file.hpp"
 
 #include <fstream>
 #include <locale>
+#include <cstring>
 
 
 /// \file load.hpp ファイルの読込
@@ -33,6 +40,222 @@ using IfsSelector = typename SameIf<
 	>::type
 >::type;
 
+// [first, last) を改行で区切り、各行（改行文字は除く）に関数を適用する（std::getline と同じ区切り規則）
+template <class F>
+void for_each_line(char const* first, char const* last, F&& func)
+{
+	while (first < last){
+		auto nl = static_cast<char const*>(std::memchr(first, '\n', last - first));
+		auto line_end = nl ? nl : last;
+#if SIG_MSVC_ENV
+		if (line_end != first && *(line_end - 1) == '\r') --line_end;	// テキストモードのifstreamと同様にCRLFを改行とみなす
+#endif
+		func(first, line_end);
+
+		if (!nl) break;
+		first = nl + 1;
+	}
+}
+
+// [first, last) の行数（for_each_line で関数が適用される回数）
+inline uint count_lines(char const* first, char const* last)
+{
+	uint num = 0;
+	for (char const* p = first; p < last; ++num){
+		auto nl = static_cast<char const*>(std::memchr(p, '\n', last - p));
+		if (!nl) return num + 1;
+		p = nl + 1;
+	}
+	return num;
+}
+
+// 並列処理のためのファイルの分割数（小さなファイルは分割しない）
+inline uint line_chunk_num(uint byte_size, uint thread_num)
+{
+	const uint min_chunk_size = 1 << 20;
+	const uint n = resolve_thread_num(thread_num);
+	return n == 1 ? 1 : std::max<uint>(1, std::min<uint>(n * 4, byte_size / min_chunk_size));
+}
+
+// [first, last) を行の途中で切れないように（改行の直後で）おおよそ均等に chunk_num 個に分割する
+inline auto split_line_chunks(char const* first, char const* last, uint chunk_num) ->std::vector<std::pair<char const*, char const*>>
+{
+	std::vector<std::pair<char const*, char const*>> chunks;
+	const uint size = last - first;
+	char const* begin = first;
+
+	for (uint i = 1; i < chunk_num && begin < last; ++i){
+		char const* p = std::max(begin, first + static_cast<uint>(static_cast<unsigned long long>(size) * i / chunk_num));
+		auto nl = static_cast<char const*>(std::memchr(p, '\n', last - p));
+		char const* end = nl ? nl + 1 : last;
+
+		chunks.emplace_back(begin, end);
+		begin = end;
+	}
+	if (begin < last || chunks.empty()) chunks.emplace_back(begin, last);
+
+	return chunks;
+}
+
+// ファイルを行の途中で切れないように分割し、各範囲 [first, last) を並列に処理してファイル中の順番通りに結果を返す
+template <class R, class F>
+auto parallel_parse_chunks(MappedFile const& file, uint thread_num, F const& chunk_parser) ->std::vector<R>
+{
+	const auto chunks = split_line_chunks(file.begin(), file.end(), line_chunk_num(file.size(), thread_num));
+
+	return parallel_generate<R>(chunks.size(), thread_num, [&](uint i){
+		return chunk_parser(chunks[i].first, chunks[i].second);
+	});
+}
+
+// 分割した各範囲の行を並列に変換し、ファイル中の順番通りに結果を返す
+template <class R, class F>
+auto parallel_parse_lines(MappedFile const& file, uint thread_num, F const& line_parser) ->std::vector<std::vector<R>>
+{
+	return parallel_parse_chunks<std::vector<R>>(file, thread_num, [&](char const* cfirst, char const* clast){
+		std::vector<R> parsed;
+		for_each_line(cfirst, clast, [&](char const* first, char const* last){
+			parsed.push_back(line_parser(first, last));
+		});
+		return parsed;
+	});
+}
+
+}	// impl
+
+
+/// 数値に変換できないトークンの扱い
+enum class BadTokenPolicy
+{
+	skip,			///< 読み飛ばす
+	fill_default	///< 既定値で置き換える
+};
+
+/// 数値の読み込み中に変換できなかったトークンの記録
+/**
+	load_num, load_num2d に渡すと、数値に変換できないトークンがあっても例外を投げずに読み込みを続け、そのトークンを BadTokenPolicy に従って処理する．\n
+	変換できなかったトークンはファイル中の位置（行番号, 行内で何番目のトークンか. どちらも1始まり）と共に、ファイル中の順番で max_record 個まで記録される
+
+	\code
+	ParseReport report(BadTokenPolicy::fill_default, -1);
+	std::vector<std::vector<double>> mat;
+
+	load_num2d(mat, fpass, ",", report);
+
+	std::cout << report.count() << " bad tokens" << std::endl;
+	for (auto const& e : report.errors()){
+		std::cout << "line " << e.line << ", column " << e.column << ": " << e.token << std::endl;
+	}
+	\endcode
+*/
+class ParseReport
+{
+public:
+	/// 変換できなかったトークン
+	struct BadToken
+	{
+		uint line;			///< 行番号（1始まり）
+		uint column;		///< 行内で何番目のトークンか（1始まり）
+		ParseStatus status;	///< 変換結果
+		std::string token;	///< トークンの文字列
+	};
+
+private:
+	BadTokenPolicy policy_;
+	double default_value_;
+	uint max_record_;
+	uint count_;
+	std::vector<BadToken> errors_;
+
+public:
+	/**
+		\param policy [option] 変換できないトークンの扱い
+		\param default_value [option] BadTokenPolicy::fill_default の場合に代わりに格納する値（読み込む数値型に変換される）
+		\param max_record [option] 記録するトークンの上限数
+	*/
+	explicit ParseReport(BadTokenPolicy policy = BadTokenPolicy::skip, double default_value = 0, uint max_record = 1000)
+		: policy_(policy), default_value_(default_value), max_record_(max_record), count_(0)
+	{}
+
+	BadTokenPolicy policy() const{ return policy_; }
+
+	double default_value() const{ return default_value_; }
+
+	uint max_record() const{ return max_record_; }
+
+	/// 変換できなかったトークンの総数（記録されなかったものも含む）
+	uint count() const{ return count_; }
+
+	/// 全てのトークンを変換できたか
+	bool empty() const{ return count_ == 0; }
+
+	/// 記録したトークン
+	std::vector<BadToken> const& errors() const{ return errors_; }
+
+	/// 変換できなかったトークンを記録する
+	void record(uint line, uint column, ParseStatus status, string_view token)
+	{
+		++count_;
+		if (errors_.size() < max_record_) errors_.push_back(BadToken{ line, column, status, std::string(token.data(), token.size()) });
+	}
+
+	/// 他の記録を、行番号に line_offset を加えて末尾に追加する
+	void merge(ParseReport const& other, uint line_offset)
+	{
+		count_ += other.count_;
+		for (uint i = 0; i < other.errors_.size() && errors_.size() < max_record_; ++i){
+			errors_.push_back(other.errors_[i]);
+			errors_.back().line += line_offset;
+		}
+	}
+
+	/// 記録を消去する
+	void clear()
+	{
+		count_ = 0;
+		errors_.clear();
+	}
+};
+
+
+namespace impl
+{
+// トークン [first, last) を数値に変換する. 変換できない場合は report に記録し、格納する値がある（fill_default の場合）かを返す
+template <class T>
+bool parse_num_reported(char const* first, char const* last, uint line, uint column, ParseReport& report, T& value)
+{
+	const auto status = try_parse_num(first, last, value);
+	if (status == ParseStatus::ok) return true;
+
+	report.record(line, column, status, string_view(first, last - first));
+	if (report.policy() == BadTokenPolicy::skip) return false;
+
+	value = static_cast<T>(report.default_value());
+	return true;
+}
+
+// 分割した範囲毎の変換結果と変換できなかったトークンの記録
+template <class R>
+struct ReportedChunk
+{
+	std::vector<R> values;
+	ParseReport report;
+	uint line_num;
+
+	ReportedChunk() : line_num(0){}
+};
+
+// 範囲毎の記録を行番号を調整して report に追加し、変換結果を順に func に渡す
+template <class R, class F>
+void merge_reported_chunks(std::vector<ReportedChunk<R>>& parsed, ParseReport& report, F&& func)
+{
+	uint line_offset = 0;
+	for (auto& part : parsed){
+		for (auto& v : part.values) func(v);
+		report.merge(part.report, line_offset);
+		line_offset += part.line_num;
+	}
+}
 }	// impl
 
 //@{ 
@@ -63,12 +286,49 @@ bool load_line(
 	return static_cast<bool>(ifs);
 }
 
+namespace impl
+{
+// std::string の場合はメモリマップから直接読み込む（行数を数えた同じマッピングから各行を切り出す）
+template <class C, class R>
+bool load_line_file(C& empty_dest, FilepassString const& file_pass, std::true_type)
+{
+	MappedFile file(file_pass);
+	if (!file.is_open()) return false;
+
+	reserve_additional(empty_dest, count_lines(file.begin(), file.end()));
+	for_each_line(file.begin(), file.end(), [&](char const* first, char const* last){
+		container_traits<C>::add_element(empty_dest, R(first, last));
+	});
+	return true;
+}
+
+// ロケールによる変換が必要な場合は ifstream で読み込む
+template <class C, class R>
+bool load_line_file(C& empty_dest, FilepassString const& file_pass, std::false_type)
+{
+	IfsSelector<R> ifs(file_pass);
+	if (!ifs) return false;
+
+#if SIG_LINUX_ENV || SIG_MSVC_ENV
+	{
+		// 行数を数えて格納先の容量を確保する（ファイルの内容をコピーしないメモリマップが使える場合のみ）
+		MappedFile file(file_pass);
+		reserve_additional(empty_dest, count_lines(file.begin(), file.end()));
+	}
+#endif
+	load_line(empty_dest, ifs);
+	return !ifs.bad();
+}
+}	// impl
+
 /// ファイルから1行ずつ読み込む（ファイル名を指定）
 /**
+	読み込む文字列型が std::string の場合はメモリマップから直接読み込む
+
 	\param empty_dest 保存先のコンテナ（\ref sig_container )
 	\param file_pass 保存先のパス（ファイル名含む）
 
-	\return 読み込みの成否
+	\return 読み込みの成否（ファイルを開いて最後まで読み込めた場合は true. 以前は読み込み後のストリームの状態を返していたため、最後まで読み込んだ場合も false となっていた）
 
 	\code
 	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
@@ -86,13 +346,7 @@ bool load_line(
 	C& empty_dest,
 	FilepassString const& file_pass)
 {
-	impl::IfsSelector<R> ifs(file_pass);
-
-	if (!ifs){
-		//FileOpenErrorPrint(file_pass);
-		return false;
-	}
-	return load_line(empty_dest, ifs);
+	return impl::load_line_file<C, R>(empty_dest, file_pass, std::is_same<R, std::string>());
 }
 
 //@}
@@ -137,14 +391,7 @@ template <
 auto load_line(FilepassString const& file_pass) ->Maybe<C>
 {
 	C tmp;
-	impl::IfsSelector<ISTR> ifs(file_pass);
-
-	if (!ifs){
-		//FileOpenErrorPrint(file_pass);
-		return Nothing(C());
-	}
-
-	load_line(tmp, ifs);
+	load_line(tmp, file_pass);
 
 	return tmp.empty() ? Nothing(tmp) : Just<C>(std::move(tmp));
 }
@@ -168,6 +415,229 @@ auto load_line(FilepassStringC file_pass) ->Maybe<C>
 
 //@{ 
 
+/// UTF-8 のファイルからワイド文字列として1行ずつ読み込む
+/**
+	ファイルをメモリマップでまとめて読み込み、ロケールやストリームを介さずに UTF-8 から直接変換する（ASCII文字は8byte単位でまとめて変換）．\n
+	大きなファイルは行単位で分割して複数のスレッドで並列に変換される．\n
+	格納されるコンテナの形は load_line と同じ．ファイル先頭の BOM は読み飛ばし、不正なバイト列は U+FFFD に置き換える．\n
+	文字列の型は wchar_t が2byteの環境(Windows)では UTF-16、4byteの環境(Linux)では UTF-32 となる（std::u16string, std::u32string も指定可能）
+
+	\param empty_dest 保存先のコンテナ（\ref sig_container ）. 要素型は std::wstring 等
+	\param file_pass 読み込むファイルのパス
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込みの成否
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.txt");
+
+	std::vector<std::wstring> input;
+	load_line_utf8(input, fpass);	// load_line(input, fpass) と同じ結果（ファイルが UTF-8 の場合）
+	\endcode
+*/
+template <
+	class C,
+	class R = typename impl::container_traits<C>::value_type,
+	typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+>
+bool load_line_utf8(
+	C& empty_dest,
+	FilepassString const& file_pass,
+	uint thread_num = 0)
+{
+	MappedFile file(file_pass);
+
+	if (!file){
+		//FileOpenErrorPrint(file_pass);
+		return false;
+	}
+
+	auto parsed = impl::parallel_parse_lines<R>(file, thread_num, [](char const* first, char const* last){
+		R line;
+		impl::append_utf8_as_wide(first, last, line);
+		return line;
+	});
+
+	uint line_num = 0;
+	for (auto const& part : parsed) line_num += part.size();
+	impl::reserve_additional(empty_dest, line_num);
+
+	bool head = true;
+	for (auto& part : parsed){
+		for (auto& line : part){
+			if (head && !line.empty() && line[0] == 0xFEFF) line.erase(0, 1);	// BOM
+			head = false;
+			impl::container_traits<C>::add_element(empty_dest, std::move(line));
+		}
+	}
+	return true;
+}
+
+/// UTF-8 のファイルからワイド文字列として1行ずつ読み込み、結果を返す
+/**
+	\tparam ISTR [option] 読み込んだ文字列を保持する型（std::wstring, std::u16string, std::u32string）
+
+	\param file_pass 読み込むファイルのパス
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\sa load_line_utf8(C& empty_dest, FilepassString const& file_pass, uint thread_num)
+*/
+template <
+	class ISTR = std::wstring,
+	class C = std::vector<ISTR>
+>
+auto load_line_utf8(
+	FilepassString const& file_pass,
+	uint thread_num = 0
+	) ->Maybe<C>
+{
+	C tmp;
+	load_line_utf8(tmp, file_pass, thread_num);
+	return tmp.empty() ? Nothing(std::move(tmp)) : Just<C>(std::move(tmp));
+}
+
+//@}
+
+//@{ 
+
+/// メモリマップを用いてファイルから1行ずつ読み込む（ファイル名を指定）
+/**
+	ファイルをメモリマップし、各行を指す string_view をコンテナに格納する．\n
+	行毎の文字列の確保やファイル内容のコピーを行わないため、巨大なファイルを高速かつ省メモリに読み込める．\n
+	格納された string_view は、返り値の MappedFile（またはそのコピー）が生存している間のみ有効
+
+	\param empty_dest 保存先のコンテナ（\ref sig_container ）. 要素型は string_view
+	\param file_pass 読み込むファイルのパス
+
+	\return 各行が参照するマッピングのハンドル（値は\ref sig_maybe で返される. 読み込み失敗時はNothing）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.txt");
+
+	std::vector<string_view> lines;
+	auto handle = load_line_mapped(lines, fpass);	// load_line(lines, fpass) と同じ感覚で使用可能
+
+	if (handle){
+		std::string first(lines[0].data(), lines[0].size());
+	}
+	\endcode
+*/
+template <
+	class C,
+	class R = typename impl::container_traits<C>::value_type
+>
+auto load_line_mapped(
+	C& empty_dest,
+	FilepassString const& file_pass)
+	->Maybe<MappedFile>
+{
+	static_assert(std::is_constructible<R, char const*, uint>::value, "element type of container must be string_view");
+
+	MappedFile file(file_pass);
+
+	if (!file){
+		//FileOpenErrorPrint(file_pass);
+		return Nothing(std::move(file));
+	}
+
+	impl::reserve_additional(empty_dest, impl::count_lines(file.begin(), file.end()));
+	impl::for_each_line(file.begin(), file.end(), [&](char const* first, char const* last){
+		impl::container_traits<C>::add_element(empty_dest, R(first, static_cast<uint>(last - first)));
+	});
+
+	return Just(std::move(file));
+}
+
+
+/// load_line_mapped の読み込み結果
+/**
+	各行の string_view を格納したコンテナと、それらが参照するマッピングを一緒に保持する．\n
+	コピー・ムーブしても各行の string_view は無効にならない
+
+	\tparam C 各行を格納するコンテナの型（\ref sig_container ）
+*/
+template <class C>
+class MappedLines
+{
+	MappedFile file_;
+	C lines_;
+
+public:
+	using value_type = typename impl::container_traits<C>::value_type;
+	using const_iterator = typename C::const_iterator;
+	using iterator = const_iterator;
+
+	MappedLines(MappedFile file, C&& lines) : file_(std::move(file)), lines_(std::move(lines)){}
+
+	const_iterator begin() const{ return std::begin(lines_); }
+	const_iterator end() const{ return std::end(lines_); }
+
+	uint size() const{ return lines_.size(); }
+	bool empty() const{ return lines_.empty(); }
+
+	template <class I>
+	auto operator[](I index) const ->decltype(std::declval<C const&>()[index]){ return lines_[index]; }
+
+	/// 各行を格納したコンテナ（sig::map や sig::filter 等にそのまま渡すことができる）
+	C const& lines() const{ return lines_; }
+
+	/// 各行が参照しているマッピング
+	MappedFile const& file() const{ return file_; }
+};
+
+/// メモリマップを用いてファイルから1行ずつ読み込み、結果を返す（ファイル名を指定）
+/**
+	\tparam C [option] 各行を格納するコンテナの型（\ref sig_container ）. 要素型は string_view
+
+	\param file_pass 読み込むファイルのパス
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.txt");
+
+	auto input = load_line_mapped(fpass);	// load_line(fpass) の代わりに使用可能
+
+	auto& data = *input;		// MappedLines<std::vector<string_view>>
+	for (auto line : data) std::cout << line << std::endl;
+	\endcode
+*/
+template <
+	class C = std::vector<string_view>
+>
+auto load_line_mapped(FilepassString const& file_pass) ->Maybe<MappedLines<C>>
+{
+	C tmp;
+	auto file = load_line_mapped(tmp, file_pass);
+
+	if (!isJust(file) || tmp.empty()){
+		return Nothing(MappedLines<C>(MappedFile(), C()));
+	}
+	return Just(MappedLines<C>(fromJust(std::move(file)), std::move(tmp)));
+}
+
+/**
+	file_pass が const char* , const wcahr_t* である場合のオーバーロード
+
+	\sa load_line_mapped(FilepassString const& file_pass)
+*/
+template <
+	class C = std::vector<string_view>
+>
+auto load_line_mapped(FilepassStringC file_pass) ->Maybe<MappedLines<C>>
+{
+	return load_line_mapped<C>(static_cast<impl::string_t<FilepassStringC>>(file_pass));
+}
+
+//@}
+
+//@{ 
+
 /// ファイルから1行ずつ読み込み、同時に変換処理を行う（ifstreamを指定）
 /**
 	\param empty_dest 保存先のコンテナ（\ref sig_container )
@@ -254,9 +724,13 @@ bool load_line(
 
 /// 数値列を読み込む
 /**
+	ファイルはメモリマップで読み込まれ、改行区切りの場合は行単位で分割して複数のスレッドで並列に変換される．\n
+	数値への変換はロケールに依存しない（小数点は常に'.'）
+
 	\param empty_dest 保存先のコンテナ（\ref sig_container )
 	\param file_pass 保存先のパス（ファイル名含む）
-	\param delimiter [option] 数値間の区切り文字
+	\param delimiter [option] 数値間の区切り文字（"\n"以外の場合はファイルの1行目のみ読み込む）
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
 
 	\return 読み込みの成否
 
@@ -293,20 +767,26 @@ template <
 bool load_num(
 	C& empty_dest,
 	FilepassString const& file_pass,
-	std::string delimiter = "\n")
+	std::string delimiter = "\n",
+	uint thread_num = 0)
 {
-	auto read_str = load_line<std::string>(file_pass);
+	MappedFile file(file_pass);
 
-	if (!isJust(read_str)) return false;
+	if (file.empty()) return false;
 
 	if (delimiter == "\n"){
-		for (auto const& line : fromJust(read_str)){
-			impl::container_traits<C>::add_element(empty_dest, impl::Str2NumSelector<RT>()(line));
+		auto parsed = impl::parallel_parse_lines<RT>(file, thread_num, &impl::parse_num<RT>);
+
+		for (auto const& part : parsed){
+			for (auto v : part) impl::container_traits<C>::add_element(empty_dest, v);
 		}
 	}
 	else{
-		auto sp = split(fromJust(read_str)[0], delimiter);
-		for (auto v : sp) impl::container_traits<C>::add_element(empty_dest, impl::Str2NumSelector<RT>()(v));
+		auto nl = static_cast<char const*>(std::memchr(file.data(), '\n', file.size()));
+
+		impl::for_each_token(file.begin(), nl ? nl : file.end(), delimiter.data(), delimiter.size(), [&](char const* first, char const* last){
+			impl::container_traits<C>::add_element(empty_dest, impl::parse_num<RT>(first, last));
+		});
 	}
 	return true;
 }
@@ -318,6 +798,7 @@ bool load_num(
 
 	\param file_pass 保存先のパス（ファイル名含む）
 	\param delimiter [option] 数値間の区切り文字
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
 
 	\return 読み込み結果（値は\ref sig_maybe で返される）
 
@@ -350,11 +831,110 @@ template <
 >
 auto load_num(
 	FilepassString const& file_pass,
-	std::string delimiter = "\n"
+	std::string delimiter = "\n",
+	uint thread_num = 0
+	) ->Maybe<C>
+{
+	C tmp;
+	load_num(tmp, file_pass, delimiter, thread_num);
+	return tmp.size() ? Just<C>(std::move(tmp)) : Nothing(std::move(tmp));
+}
+
+/// 数値列を読み込む（数値に変換できないトークンは例外を投げずに report に記録する）
+/**
+	変換できないトークンは report の BadTokenPolicy に従って読み飛ばすか既定値で置き換え、その位置を report に記録する．\n
+	それ以外は load_num(C& empty_dest, FilepassString const& file_pass, std::string delimiter, uint thread_num) と同じ
+
+	\param empty_dest 保存先のコンテナ（\ref sig_container )
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param delimiter 数値間の区切り文字（"\n"以外の場合はファイルの1行目のみ読み込む）
+	\param report 変換できなかったトークンの扱いの指定と記録先
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込みの成否
+
+	\code
+	ParseReport report(BadTokenPolicy::skip);
+	std::vector<int> input;
+
+	load_num(input, fpass, "\n", report);	// input: { 1, 3 }, report.errors()[0]: { line: 2, column: 1, token: "x" }
+	\endcode
+
+	\code
+	// test.txt
+	1
+	x
+	3
+	\endcode
+*/
+template <
+	class C,
+	class RT = typename impl::container_traits<C>::value_type, typename std::enable_if<!impl::container_traits<typename impl::container_traits<C>::value_type>::exist>::type*& = enabler
+>
+bool load_num(
+	C& empty_dest,
+	FilepassString const& file_pass,
+	std::string delimiter,
+	ParseReport& report,
+	uint thread_num = 0)
+{
+	MappedFile file(file_pass);
+
+	if (file.empty()) return false;
+
+	if (delimiter == "\n"){
+		auto parsed = impl::parallel_parse_chunks<impl::ReportedChunk<RT>>(file, thread_num, [&](char const* cfirst, char const* clast){
+			impl::ReportedChunk<RT> part;
+			part.report = ParseReport(report.policy(), report.default_value(), report.max_record());
+
+			impl::for_each_line(cfirst, clast, [&](char const* first, char const* last){
+				RT v;
+				if (impl::parse_num_reported(first, last, ++part.line_num, 1, part.report, v)) part.values.push_back(v);
+			});
+			return part;
+		});
+
+		impl::merge_reported_chunks(parsed, report, [&](RT v){ impl::container_traits<C>::add_element(empty_dest, v); });
+	}
+	else{
+		auto nl = static_cast<char const*>(std::memchr(file.data(), '\n', file.size()));
+		uint column = 0;
+
+		impl::for_each_token(file.begin(), nl ? nl : file.end(), delimiter.data(), delimiter.size(), [&](char const* first, char const* last){
+			RT v;
+			if (impl::parse_num_reported(first, last, 1, ++column, report, v)) impl::container_traits<C>::add_element(empty_dest, v);
+		});
+	}
+	return true;
+}
+
+/// 数値列を読み込み、結果を返す（数値に変換できないトークンは例外を投げずに report に記録する）
+/**
+	\tparam R 数値の型（int, double等）
+	\tparam C [option] コンテナの型（\ref sig_container )
+
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param delimiter 数値間の区切り文字
+	\param report 変換できなかったトークンの扱いの指定と記録先
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\sa load_num(C& empty_dest, FilepassString const& file_pass, std::string delimiter, ParseReport& report, uint thread_num)
+*/
+template <
+	class R,
+	class C = std::vector<R>, typename std::enable_if<impl::container_traits<C>::exist && !impl::container_traits<typename impl::container_traits<C>::value_type>::exist>::type*& = enabler
+>
+auto load_num(
+	FilepassString const& file_pass,
+	std::string delimiter,
+	ParseReport& report,
+	uint thread_num = 0
 	) ->Maybe<C>
 {
 	C tmp;
-	load_num(tmp, file_pass, delimiter);
+	load_num(tmp, file_pass, delimiter, report, thread_num);
 	return tmp.size() ? Just<C>(std::move(tmp)) : Nothing(std::move(tmp));
 }
 
@@ -364,9 +944,13 @@ auto load_num(
 
 /// 2次元配列の数値(ex:行列)を読み込む
 /**
+	ファイルはメモリマップで読み込まれ、行単位で分割して複数のスレッドで並列に変換される．\n
+	変換結果はファイル中の行の順番通りに格納される．数値への変換はロケールに依存しない（小数点は常に'.'）
+
 	\param empty_dest 保存先のコンテナ（\ref sig_container )
 	\param file_pass 保存先のパス（ファイル名含む）
 	\param delimiter 数値間の区切り文字
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
 	
 	\return 読み込みの成否
 
@@ -397,19 +981,23 @@ template <
 bool load_num2d(
 	CC& empty_dest,
 	FilepassString const& file_pass,
-	std::string delimiter)
+	std::string delimiter,
+	uint thread_num = 0)
 {
-	auto read_str = load_line<std::string>(file_pass);
-	if (!isJust(read_str)) return false;
+	MappedFile file(file_pass);
 
-	for (auto const& line : fromJust(read_str)){
-		RC tmp;
-		auto sp = split(line, delimiter);
+	if (file.empty()) return false;
 
-		for (auto const& v : sp){
-			impl::container_traits<RC>::add_element(tmp, impl::Str2NumSelector<RT>()(v));
-		}
-		impl::container_traits<CC>::add_element(empty_dest, std::move(tmp));
+	auto parsed = impl::parallel_parse_lines<RC>(file, thread_num, [&](char const* first, char const* last){
+		RC row;
+		impl::for_each_token(first, last, delimiter.data(), delimiter.size(), [&](char const* tfirst, char const* tlast){
+			impl::container_traits<RC>::add_element(row, impl::parse_num<RT>(tfirst, tlast));
+		});
+		return row;
+	});
+
+	for (auto& part : parsed){
+		for (auto& row : part) impl::container_traits<CC>::add_element(empty_dest, std::move(row));
 	}
 	return true;
 }
@@ -422,6 +1010,7 @@ bool load_num2d(
 
 	\param file_pass 保存先のパス（ファイル名含む）
 	\param delimiter 数値間の区切り文字
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
 	
 	\return 読み込み結果（値は\ref sig_maybe で返される）
 
@@ -449,11 +1038,108 @@ template <
 >
 auto load_num2d(
 	FilepassString const& file_pass,
-	std::string delimiter
+	std::string delimiter,
+	uint thread_num = 0
+	) ->Maybe<CC>
+{
+	CC tmp;
+	load_num2d(tmp, file_pass, delimiter, thread_num);
+	return tmp.size() ? Just<CC>(std::move(tmp)) : Nothing(std::move(tmp));
+}
+
+/// 2次元配列の数値(ex:行列)を読み込む（数値に変換できないトークンは例外を投げずに report に記録する）
+/**
+	変換できないトークンは report の BadTokenPolicy に従って読み飛ばすか既定値で置き換え、その位置を report に記録する．\n
+	BadTokenPolicy::fill_default を指定すると、各行の要素数は変換できないトークンを含まない場合と同じになる．\n
+	それ以外は load_num2d(CC& empty_dest, FilepassString const& file_pass, std::string delimiter, uint thread_num) と同じ
+
+	\param empty_dest 保存先のコンテナ（\ref sig_container )
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param delimiter 数値間の区切り文字
+	\param report 変換できなかったトークンの扱いの指定と記録先
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込みの成否
+
+	\code
+	ParseReport report(BadTokenPolicy::fill_default, -1);
+	std::vector<std::vector<int>> input_mat;
+
+	load_num2d(input_mat, fpass, ",", report);	// input_mat[1]: { 4, -1, 6 }, report.errors()[0]: { line: 2, column: 2, token: "N/A" }
+	\endcode
+
+	\code
+	// test.txt
+	1,2,3
+	4,N/A,6
+	\endcode
+*/
+template <
+	class CC,
+	class RC = typename impl::container_traits<CC>::value_type,
+	class RT = typename impl::container_traits<RC>::value_type
+>
+bool load_num2d(
+	CC& empty_dest,
+	FilepassString const& file_pass,
+	std::string delimiter,
+	ParseReport& report,
+	uint thread_num = 0)
+{
+	MappedFile file(file_pass);
+
+	if (file.empty()) return false;
+
+	auto parsed = impl::parallel_parse_chunks<impl::ReportedChunk<RC>>(file, thread_num, [&](char const* cfirst, char const* clast){
+		impl::ReportedChunk<RC> part;
+		part.report = ParseReport(report.policy(), report.default_value(), report.max_record());
+
+		impl::for_each_line(cfirst, clast, [&](char const* first, char const* last){
+			RC row;
+			uint column = 0;
+			++part.line_num;
+
+			impl::for_each_token(first, last, delimiter.data(), delimiter.size(), [&](char const* tfirst, char const* tlast){
+				RT v;
+				if (impl::parse_num_reported(tfirst, tlast, part.line_num, ++column, part.report, v)) impl::container_traits<RC>::add_element(row, v);
+			});
+			part.values.push_back(std::move(row));
+		});
+		return part;
+	});
+
+	impl::merge_reported_chunks(parsed, report, [&](RC& row){ impl::container_traits<CC>::add_element(empty_dest, std::move(row)); });
+	return true;
+}
+
+/// 2次元配列の数値(ex:行列)を読み込む（数値に変換できないトークンは例外を投げずに report に記録する）
+/**
+	\tparam R 数値の型（int, double等）
+	\tparam CC [option] コンテナの型（\ref sig_container )
+
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param delimiter 数値間の区切り文字
+	\param report 変換できなかったトークンの扱いの指定と記録先
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\sa load_num2d(CC& empty_dest, FilepassString const& file_pass, std::string delimiter, ParseReport& report, uint thread_num)
+*/
+template <
+	class R,
+	class CC = std::vector<std::vector<R>>,
+	typename std::enable_if<impl::container_traits<typename impl::container_traits<CC>::value_type>::exist>::type*& = enabler
+>
+auto load_num2d(
+	FilepassString const& file_pass,
+	std::string delimiter,
+	ParseReport& report,
+	uint thread_num = 0
 	) ->Maybe<CC>
 {
 	CC tmp;
-	load_num2d(tmp, file_pass, delimiter);
+	load_num2d(tmp, file_pass, delimiter, report, thread_num);
 	return tmp.size() ? Just<CC>(std::move(tmp)) : Nothing(std::move(tmp));
 }
 
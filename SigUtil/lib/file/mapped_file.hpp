@@ -0,0 +1,256 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_MAPPED_FILE_HPP
+#define SIG_UTIL_MAPPED_FILE_HPP
+
+#include "../sigutil.hpp"
+#include "../helper/string_view.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#else
+	#include <fstream>
+	#include <vector>
+#endif
+
+
+/// \file mapped_file.hpp メモリマップトファイル（読み込み専用）
+
+namespace sig
+{
+namespace impl
+{
+// マッピングの実体. 生存期間は MappedFile が参照カウントで管理する
+class MappedRegion
+{
+	char const* data_;
+	uint size_;
+	bool is_open_;
+
+#if SIG_MSVC_ENV
+	HANDLE file_;
+	HANDLE map_;
+#elif !SIG_LINUX_ENV
+	std::vector<char> buffer_;
+#endif
+
+public:
+	explicit MappedRegion(FilepassString const& file_pass) : data_(nullptr), size_(0), is_open_(false)
+	{
+#if SIG_MSVC_ENV
+		map_ = nullptr;
+		file_ = CreateFileW(file_pass.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER fsize;
+		if (!GetFileSizeEx(file_, &fsize)) return;
+		size_ = static_cast<uint>(fsize.QuadPart);
+		is_open_ = true;
+		if (size_ == 0) return;
+
+		map_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (map_ == nullptr){ is_open_ = false; return; }
+
+		data_ = static_cast<char const*>(MapViewOfFile(map_, FILE_MAP_READ, 0, 0, 0));
+		if (data_ == nullptr) is_open_ = false;
+
+#elif SIG_LINUX_ENV
+		const int fd = ::open(file_pass.c_str(), O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		if (::fstat(fd, &st) == 0){
+			size_ = static_cast<uint>(st.st_size);
+			is_open_ = true;
+
+			if (size_ > 0){
+				void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p == MAP_FAILED) is_open_ = false;
+				else{
+					::madvise(p, size_, MADV_SEQUENTIAL);
+					data_ = static_cast<char const*>(p);
+				}
+			}
+		}
+		::close(fd);	// マッピングはfdを閉じても維持される
+
+#else
+		std::ifstream ifs(file_pass, std::ios::binary);
+		if (!ifs) return;
+		buffer_.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+		data_ = buffer_.data();
+		size_ = buffer_.size();
+		is_open_ = true;
+#endif
+	}
+
+	~MappedRegion()
+	{
+#if SIG_MSVC_ENV
+		if (data_) UnmapViewOfFile(data_);
+		if (map_) CloseHandle(map_);
+		if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#elif SIG_LINUX_ENV
+		if (data_) ::munmap(const_cast<char*>(data_), size_);
+#endif
+	}
+
+	MappedRegion(MappedRegion const&) = delete;
+	MappedRegion& operator=(MappedRegion const&) = delete;
+
+	char const* data() const{ return data_; }
+	uint size() const{ return is_open_ ? size_ : 0; }
+	bool is_open() const{ return is_open_; }
+};
+
+
+// ファイルの更新を判定するための値 (サイズと最終更新時刻[ns]). 取得できない場合は valid == false
+struct FileStamp
+{
+	bool valid;
+	std::uint64_t size;
+	std::uint64_t mtime;
+
+	bool operator==(FileStamp const& other) const{ return valid == other.valid && size == other.size && mtime == other.mtime; }
+	bool operator!=(FileStamp const& other) const{ return !(*this == other); }
+};
+
+inline FileStamp get_file_stamp(FilepassString const& file_pass)
+{
+	FileStamp stamp = { false, 0, 0 };
+
+#if SIG_MSVC_ENV
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (GetFileAttributesExW(file_pass.c_str(), GetFileExInfoStandard, &info)){
+		stamp.valid = true;
+		stamp.size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+		stamp.mtime = ((static_cast<std::uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime) * 100;
+	}
+#elif SIG_LINUX_ENV
+	struct stat st;
+	if (::stat(file_pass.c_str(), &st) == 0){
+		stamp.valid = true;
+		stamp.size = static_cast<std::uint64_t>(st.st_size);
+		stamp.mtime = static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(st.st_mtim.tv_nsec);
+	}
+#endif
+	return stamp;
+}
+
+// 同時に作成される一時ファイルが衝突しないように付加する名前（プロセスID, スレッド, 呼び出し毎に異なる）
+inline FilepassString unique_tmp_suffix()
+{
+	static std::atomic<std::uint64_t> counter(0);
+#if SIG_MSVC_ENV
+	const std::uint64_t pid = GetCurrentProcessId();
+#elif SIG_LINUX_ENV
+	const std::uint64_t pid = static_cast<std::uint64_t>(::getpid());
+#else
+	const std::uint64_t pid = 0;
+#endif
+	const std::uint64_t tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+	return SIG_TO_FPSTR(".") + to_fpstring(pid) + SIG_TO_FPSTR(".") + to_fpstring(tid) + SIG_TO_FPSTR(".") + to_fpstring(++counter) + SIG_TO_FPSTR(".tmp");
+}
+
+inline bool remove_file(FilepassString const& file_pass)
+{
+#if SIG_MSVC_ENV
+	return _wremove(file_pass.c_str()) == 0;
+#else
+	return std::remove(file_pass.c_str()) == 0;
+#endif
+}
+
+// from を to に置き換える（同じファイルシステム上では不可分に置き換えられる）. 失敗した場合は from を削除する
+inline bool replace_file(FilepassString const& from, FilepassString const& to)
+{
+#if SIG_MSVC_ENV
+	if (MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING)) return true;
+#else
+	if (std::rename(from.c_str(), to.c_str()) == 0) return true;
+#endif
+	remove_file(from);
+	return false;
+}
+
+}	// impl
+
+
+/// 読み込み専用のメモリマップトファイル
+/**
+	ファイル全体を仮想メモリに割り当て、コピーせずに内容を参照する．\n
+	コピーは参照カウントによる共有となり、最後のコピーが破棄された時点でマッピングが解除される．\n
+	そのため、data() や view() から得たポインタ・string_view はいずれかのコピーが生存している間有効である．\n
+	空のファイルは is_open() == true かつ size() == 0 として扱われる．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("test.txt");
+
+	MappedFile file(fpass);
+
+	if (file){
+		string_view whole = file.view();
+		auto lines = std::count(whole.begin(), whole.end(), '\n');
+	}
+	\endcode
+*/
+class MappedFile
+{
+	std::shared_ptr<impl::MappedRegion const> region_;
+
+public:
+	using value_type = char;
+	using const_iterator = char const*;
+	using iterator = const_iterator;
+
+	/// 何もマッピングしていない状態で構築
+	MappedFile() = default;
+
+	/// ファイルをマッピングする
+	/**
+		\param file_pass 読み込むファイルのパス
+	*/
+	explicit MappedFile(FilepassString const& file_pass) : region_(std::make_shared<impl::MappedRegion>(file_pass))
+	{
+		if (!region_->is_open()) region_.reset();
+	}
+
+	/// マッピングに成功しているか
+	bool is_open() const{ return static_cast<bool>(region_); }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// マッピングされた領域の先頭
+	char const* data() const{ return region_ ? region_->data() : nullptr; }
+
+	/// マッピングされた領域のバイト数
+	uint size() const{ return region_ ? region_->size() : 0; }
+
+	bool empty() const{ return size() == 0; }
+
+	const_iterator begin() const{ return data(); }
+	const_iterator end() const{ return data() + size(); }
+
+	/// 領域全体を文字列として参照
+	string_view view() const{ return string_view(data(), size()); }
+};
+
+}
+#endif
@@ -0,0 +1,578 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_MAPPED_VECTOR_HPP
+#define SIG_UTIL_MAPPED_VECTOR_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/file.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#else
+	#include <fstream>
+#endif
+
+
+/// \file mapped_vector.hpp メモリマップトファイルを記憶領域とする可変長配列
+
+namespace sig
+{
+namespace impl
+{
+
+// MappedVector のファイルのヘッダ (64byte. 続けて要素を capacity 個分格納する)
+struct MappedVectorHeader
+{
+	char magic[8];					// "SIGMVEC"
+	std::uint32_t version;
+	std::uint32_t element_size;
+	std::atomic<std::uint64_t> size;	// 書き込み済みの要素数. 複数のプロセスから参照される
+	char reserved[40];
+};
+static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t), "std::atomic<uint64_t> must have the same layout as uint64_t");
+static_assert(sizeof(MappedVectorHeader) == 64, "unexpected padding in MappedVectorHeader");
+
+static const char mapped_vector_magic[8] = { 'S', 'I', 'G', 'M', 'V', 'E', 'C', '\0' };
+static const std::uint32_t mapped_vector_version = 1;
+
+}	// impl
+
+
+/// メモリマップトファイルを記憶領域とする可変長配列
+/**
+	std::vector と同様に使用でき、要素はファイルに直接格納される．ファイルを開き直すと以前の内容がそのまま参照でき、読み込みの処理は必要ない．\n
+	容量が不足するとファイルを拡張して再マップする（その際、要素へのポインタ・イテレータは無効になる）．\n
+	\ref sig_container に対応しているため、メモリに収まらないデータにも map, filter, sum や距離関数などを直接適用できる
+	（map, filter 等の結果はメモリ上の MappedVector または std::vector となる）．\n
+	1つのファイルに対して書き込み可能なインスタンスは1つだけ作成でき（ファイルロックで排他される）、読み込み専用のインスタンスは他のプロセスからも含めて複数作成できる．
+	読み込み専用のインスタンスは開いた時点の要素数を参照し、refresh() でその後に追加された要素を参照できるようになる．\n
+	デフォルトコンストラクタで構築した場合はファイルを持たず、メモリ上の配列として動作する．\n
+	Linux, Windows 以外の環境ではファイル全体をメモリに読み込み、sync() またはデストラクタでファイルに書き戻す（他のインスタンスとの共有はできない）．
+
+	\tparam T 要素の型（trivially copyable な型）
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("features.bin");
+
+	{
+		MappedVector<double> vec(fpass);		// 存在しない場合は作成
+		for (int i = 0; i < 100000000; ++i) vec.push_back(i * 0.5);
+	}
+
+	MappedVector<double> reader(fpass, true);	// 読み込み専用（前回の内容を参照）
+	double total = sum(reader);
+	auto positive = filter([](double v){ return v > 0; }, reader);
+	\endcode
+*/
+template <class T>
+class MappedVector
+{
+	static_assert(std::is_trivially_copyable<T>::value, "MappedVector requires a trivially copyable element type");
+	static_assert(alignof(T) <= sizeof(impl::MappedVectorHeader), "unsupported alignment");
+
+public:
+	using value_type = T;
+	using size_type = uint;
+	using difference_type = std::ptrdiff_t;
+	using reference = T&;
+	using const_reference = T const&;
+	using pointer = T*;
+	using const_pointer = T const*;
+	using iterator = T*;
+	using const_iterator = T const*;
+
+private:
+	using Header = impl::MappedVectorHeader;
+	static const uint header_size = sizeof(Header);
+
+	FilepassString file_pass_;
+	bool read_only_;
+	bool is_open_;
+
+	char* base_;			// ヘッダの位置
+	uint mapped_size_;		// マップしているバイト数
+	uint size_;
+	uint capacity_;
+
+	std::vector<std::max_align_t> buffer_;	// ファイルを持たない場合・マップできない環境の記憶領域
+
+#if SIG_MSVC_ENV
+	HANDLE file_;
+	HANDLE map_;
+#elif SIG_LINUX_ENV
+	int fd_;
+#endif
+
+private:
+	Header* header() const{ return reinterpret_cast<Header*>(base_); }
+
+	T* elements() const{ return reinterpret_cast<T*>(base_ + header_size); }
+
+	bool mapped() const{ return buffer_.empty() && base_ != nullptr; }
+
+	static uint capacity_of(uint bytes){ return bytes < header_size ? 0 : (bytes - header_size) / sizeof(T); }
+
+	void init_header()
+	{
+		Header* h = header();
+		std::memcpy(h->magic, impl::mapped_vector_magic, sizeof(h->magic));
+		h->version = impl::mapped_vector_version;
+		h->element_size = sizeof(T);
+		h->size.store(0);
+	}
+
+	bool valid_header() const
+	{
+		Header const* h = header();
+		return std::memcmp(h->magic, impl::mapped_vector_magic, sizeof(h->magic)) == 0 && h->version == impl::mapped_vector_version && h->element_size == sizeof(T);
+	}
+
+	// 記憶領域を bytes バイトにする（ファイルを持つ場合はファイルサイズを変更して再マップ）
+	bool remap(uint bytes)
+	{
+		if (!mapped()){
+			std::vector<std::max_align_t> tmp((bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+			if (base_) std::memcpy(tmp.data(), base_, std::min(bytes, mapped_size_));
+			buffer_.swap(tmp);
+			base_ = reinterpret_cast<char*>(buffer_.data());
+			mapped_size_ = bytes;
+			return true;
+		}
+#if SIG_MSVC_ENV
+		UnmapViewOfFile(base_);
+		CloseHandle(map_);
+		base_ = nullptr;
+
+		const DWORD access = read_only_ ? PAGE_READONLY : PAGE_READWRITE;
+		map_ = CreateFileMappingW(file_, nullptr, access, static_cast<DWORD>(static_cast<std::uint64_t>(bytes) >> 32), static_cast<DWORD>(bytes), nullptr);
+		if (map_ == nullptr) return false;
+
+		base_ = static_cast<char*>(MapViewOfFile(map_, read_only_ ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, bytes));
+		if (base_ == nullptr) return false;
+#elif SIG_LINUX_ENV
+		if (!read_only_ && ::ftruncate(fd_, bytes) != 0) return false;
+
+		void* p = ::mremap(base_, mapped_size_, bytes, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED) return false;
+		base_ = static_cast<char*>(p);
+#endif
+		mapped_size_ = bytes;
+		return true;
+	}
+
+	void check_writable() const
+	{
+		if (read_only_) throw std::logic_error("MappedVector: the vector is read-only");
+		if (!is_open_) throw std::logic_error("MappedVector: the vector is not open");	// 開けなかった・閉じた後の変更はファイルに反映できない
+	}
+
+	void grow(uint n)
+	{
+		if (n <= capacity_) return;
+
+		const uint new_capacity = std::max(n, std::max<uint>(capacity_ * 2, 4096 / sizeof(T) + 1));
+		if (!remap(header_size + new_capacity * sizeof(T))){
+			close();
+			throw std::runtime_error("MappedVector: failed to extend the mapping");
+		}
+		capacity_ = new_capacity;
+	}
+
+	void publish_size(){ if (!read_only_) header()->size.store(size_, std::memory_order_release); }
+
+	void open(FilepassString const& file_pass)
+	{
+#if SIG_MSVC_ENV
+		map_ = nullptr;
+		file_ = CreateFileW(file_pass.c_str(), read_only_ ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, read_only_ ? OPEN_EXISTING : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) return;
+
+		// 書き込み可能なインスタンスの排他 (データの範囲外の1byteをロック)
+		OVERLAPPED ov = {};
+		ov.Offset = 0xFFFFFFFF;
+		ov.OffsetHigh = 0x7FFFFFFF;
+		if (!read_only_ && !LockFileEx(file_, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &ov)) return;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file_, &file_size)) return;
+		uint bytes = static_cast<uint>(file_size.QuadPart);
+
+		const bool created = bytes == 0;
+		if (created){
+			if (read_only_) return;
+			bytes = header_size;
+		}
+		map_ = CreateFileMappingW(file_, nullptr, read_only_ ? PAGE_READONLY : PAGE_READWRITE, static_cast<DWORD>(static_cast<std::uint64_t>(bytes) >> 32), static_cast<DWORD>(bytes), nullptr);
+		if (map_ == nullptr) return;
+		base_ = static_cast<char*>(MapViewOfFile(map_, read_only_ ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, bytes));
+		if (base_ == nullptr) return;
+#elif SIG_LINUX_ENV
+		fd_ = ::open(file_pass.c_str(), read_only_ ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (fd_ < 0) return;
+		if (!read_only_ && ::flock(fd_, LOCK_EX | LOCK_NB) != 0) return;
+
+		struct stat st;
+		if (::fstat(fd_, &st) != 0) return;
+		uint bytes = static_cast<uint>(st.st_size);
+
+		const bool created = bytes == 0;
+		if (created){
+			if (read_only_ || ::ftruncate(fd_, header_size) != 0) return;
+			bytes = header_size;
+		}
+		void* p = ::mmap(nullptr, bytes, read_only_ ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+		if (p == MAP_FAILED) return;
+		base_ = static_cast<char*>(p);
+#else
+		std::ifstream ifs(file_pass, std::ios::in | std::ios::binary);
+		if (ifs){
+			ifs.seekg(0, std::ios::end);
+			const uint bytes = static_cast<uint>(ifs.tellg());
+			remap(bytes);
+			ifs.seekg(0, std::ios::beg);
+			ifs.read(base_, bytes);
+		}
+		else if (read_only_) return;
+
+		const bool created = mapped_size_ == 0;
+		if (created) remap(header_size);
+		const uint bytes = mapped_size_;
+#endif
+		mapped_size_ = bytes;
+
+		if (created) init_header();
+		else if (bytes < header_size || !valid_header()){
+			close();
+			return;
+		}
+		capacity_ = capacity_of(bytes);
+		size_ = static_cast<uint>(std::min<std::uint64_t>(header()->size.load(std::memory_order_acquire), capacity_));
+		is_open_ = true;
+	}
+
+	void move_from(MappedVector& other)
+	{
+		file_pass_ = std::move(other.file_pass_);
+		read_only_ = other.read_only_;
+		is_open_ = other.is_open_;
+		base_ = other.base_;
+		mapped_size_ = other.mapped_size_;
+		size_ = other.size_;
+		capacity_ = other.capacity_;
+		buffer_ = std::move(other.buffer_);
+#if SIG_MSVC_ENV
+		file_ = other.file_;
+		map_ = other.map_;
+		other.file_ = INVALID_HANDLE_VALUE;
+		other.map_ = nullptr;
+#elif SIG_LINUX_ENV
+		fd_ = other.fd_;
+		other.fd_ = -1;
+#endif
+		other.base_ = nullptr;
+		other.buffer_.clear();
+		other.is_open_ = false;
+		other.mapped_size_ = other.size_ = other.capacity_ = 0;
+	}
+
+	void reset()
+	{
+		base_ = nullptr;
+		mapped_size_ = size_ = capacity_ = 0;
+		is_open_ = false;
+#if SIG_MSVC_ENV
+		file_ = INVALID_HANDLE_VALUE;
+		map_ = nullptr;
+#elif SIG_LINUX_ENV
+		fd_ = -1;
+#endif
+	}
+
+public:
+	/// ファイルを持たない空の配列を構築
+	MappedVector() : read_only_(false)
+	{
+		reset();
+		remap(header_size);
+		init_header();
+		is_open_ = true;
+	}
+
+	/// ファイルを開く（存在しない場合は作成する）
+	/**
+		\param file_pass ファイルのパス
+		\param read_only [option] 読み込み専用で開くか（ファイルが存在しない場合は失敗する）
+
+		書き込み可能なインスタンスが既に存在する場合・ファイルの形式や要素の型が異なる場合は開けない（is_open() が false）
+	*/
+	explicit MappedVector(FilepassString const& file_pass, bool read_only = false)
+		: file_pass_(file_pass), read_only_(read_only)
+	{
+		reset();
+		open(file_pass);
+		if (!is_open_) close();
+	}
+
+	/// 要素を指定して構築（ファイルを持たない）
+	MappedVector(std::initializer_list<T> init) : MappedVector()
+	{
+		assign(init.begin(), init.end());
+	}
+
+	~MappedVector(){ close(); }
+
+	MappedVector(MappedVector const&) = delete;
+	MappedVector& operator=(MappedVector const&) = delete;
+
+	MappedVector(MappedVector&& other) : read_only_(false)
+	{
+		reset();
+		move_from(other);
+	}
+
+	MappedVector& operator=(MappedVector&& other)
+	{
+		if (this != &other){
+			close();
+			move_from(other);
+		}
+		return *this;
+	}
+
+	/// ファイルを開けたか（ファイルを持たない場合は常に true）
+	bool is_open() const{ return is_open_; }
+
+	explicit operator bool() const{ return is_open(); }
+
+	/// 読み込み専用か
+	bool read_only() const{ return read_only_; }
+
+	/// 記憶領域のファイルのパス（ファイルを持たない場合は空）
+	FilepassString const& file_pass() const{ return file_pass_; }
+
+	uint size() const{ return size_; }
+
+	uint capacity() const{ return capacity_; }
+
+	bool empty() const{ return size_ == 0; }
+
+	T* data(){ return base_ ? elements() : nullptr; }
+	T const* data() const{ return base_ ? elements() : nullptr; }
+
+	iterator begin(){ return data(); }
+	const_iterator begin() const{ return data(); }
+	const_iterator cbegin() const{ return data(); }
+
+	iterator end(){ return data() + size_; }
+	const_iterator end() const{ return data() + size_; }
+	const_iterator cend() const{ return data() + size_; }
+
+	T& operator[](uint i){ return elements()[i]; }
+	T const& operator[](uint i) const{ return elements()[i]; }
+
+	T& at(uint i)
+	{
+		if (i >= size_) throw std::out_of_range("MappedVector: index out of range");
+		return elements()[i];
+	}
+	T const& at(uint i) const
+	{
+		if (i >= size_) throw std::out_of_range("MappedVector: index out of range");
+		return elements()[i];
+	}
+
+	T& front(){ return elements()[0]; }
+	T const& front() const{ return elements()[0]; }
+
+	T& back(){ return elements()[size_ - 1]; }
+	T const& back() const{ return elements()[size_ - 1]; }
+
+	/// 末尾に要素を追加（容量が不足する場合はファイルを拡張する）
+	/**
+		\exception std::logic_error（読み込み専用の場合・開いていない場合）, std::runtime_error（ファイルを拡張できない場合. ファイルは閉じられる）
+	*/
+	void push_back(T const& value)
+	{
+		check_writable();
+		if (size_ == capacity_){
+			const T tmp = value;	// value が自身の要素を参照している場合に備える
+			grow(size_ + 1);
+			elements()[size_] = tmp;
+		}
+		else elements()[size_] = value;
+		++size_;
+		publish_size();
+	}
+
+	template <class... Args>
+	void emplace_back(Args&&... args){ push_back(T(std::forward<Args>(args)...)); }
+
+	void pop_back()
+	{
+		check_writable();
+		--size_;
+		publish_size();
+	}
+
+	/// 末尾に範囲 [first, last) の要素を追加
+	template <class It>
+	void append(It first, It last)
+	{
+		for (; first != last; ++first) push_back(*first);
+	}
+
+	template <class It>
+	void assign(It first, It last)
+	{
+		clear();
+		append(first, last);
+	}
+
+	/// 容量を n 以上にする
+	void reserve(uint n)
+	{
+		check_writable();
+		grow(n);
+	}
+
+	/// 要素数を n にする（増えた要素は value で初期化）
+	void resize(uint n, T const& value = T())
+	{
+		check_writable();
+		grow(n);
+		for (uint i = size_; i < n; ++i) elements()[i] = value;
+		size_ = n;
+		publish_size();
+	}
+
+	void clear()
+	{
+		check_writable();
+		size_ = 0;
+		publish_size();
+	}
+
+	/// 容量を要素数に合わせて縮小する（メモリ上の配列の場合のみ）
+	/**
+		ファイルを持つ場合は何もしない（ファイルを縮小すると、それを参照している読み込み専用のインスタンスが範囲外にアクセスしてしまうため）
+	*/
+	void shrink_to_fit()
+	{
+		if (read_only_ || !file_pass_.empty() || size_ == capacity_) return;
+		if (remap(header_size + size_ * sizeof(T))) capacity_ = size_;
+		else close();
+	}
+
+	/// 変更をファイルに書き込む（通常は不要. OSのクラッシュに備える場合や、Linux, Windows 以外の環境で使用）
+	/**
+		\return 書き込みの成否
+	*/
+	bool sync()
+	{
+		if (read_only_ || !is_open_ || file_pass_.empty()) return is_open_;
+#if SIG_MSVC_ENV
+		return FlushViewOfFile(base_, mapped_size_) && FlushFileBuffers(file_);
+#elif SIG_LINUX_ENV
+		return ::msync(base_, mapped_size_, MS_SYNC) == 0;
+#else
+		std::ofstream ofs(file_pass_, std::ios::out | std::ios::binary | std::ios::trunc);
+		ofs.write(base_, mapped_size_);
+		return static_cast<bool>(ofs.flush());
+#endif
+	}
+
+	/// 他のインスタンスが追加した要素を参照できるようにする（読み込み専用の場合）
+	/**
+		\return 新たに参照できるようになった要素数
+	*/
+	uint refresh()
+	{
+		if (!read_only_ || !is_open_ || !mapped()) return 0;
+
+		const uint old_size = size_;
+		std::uint64_t size = header()->size.load(std::memory_order_acquire);
+
+		if (size > capacity_){
+#if SIG_MSVC_ENV
+			LARGE_INTEGER file_size;
+			const uint bytes = GetFileSizeEx(file_, &file_size) ? static_cast<uint>(file_size.QuadPart) : 0;
+#elif SIG_LINUX_ENV
+			struct stat st;
+			const uint bytes = ::fstat(fd_, &st) == 0 ? static_cast<uint>(st.st_size) : 0;
+#else
+			const uint bytes = 0;
+#endif
+			if (bytes > mapped_size_){
+				if (!remap(bytes)){
+					close();
+					return 0;
+				}
+				capacity_ = capacity_of(bytes);
+				size = header()->size.load(std::memory_order_acquire);
+			}
+		}
+		size_ = static_cast<uint>(std::min<std::uint64_t>(size, capacity_));
+		return size_ > old_size ? size_ - old_size : 0;
+	}
+
+	/// ファイルを閉じる（ファイルを持たない場合は全ての要素を破棄する）
+	void close()
+	{
+		if (!file_pass_.empty() && is_open_ && !mapped()) sync();
+#if SIG_MSVC_ENV
+		if (base_ && mapped()) UnmapViewOfFile(base_);
+		if (map_) CloseHandle(map_);
+		if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#elif SIG_LINUX_ENV
+		if (base_ && mapped()) ::munmap(base_, mapped_size_);
+		if (fd_ >= 0) ::close(fd_);
+#endif
+		buffer_.clear();
+		reset();
+	}
+};
+
+
+namespace impl
+{
+template <class T>
+struct container_traits<MappedVector<T>>
+{
+	static const bool exist = true;
+
+	using value_type = T;
+
+	template <class U>
+	using rebind = typename std::conditional<std::is_trivially_copyable<U>::value, MappedVector<U>, std::vector<U>>::type;
+
+	static MappedVector<T> make(size_t n){ MappedVector<T> tmp; tmp.reserve(n); return tmp; }
+
+	static void add_element(MappedVector<T>& c, T const& t){ c.push_back(t); }
+
+	static void concat(MappedVector<T>& lhs, MappedVector<T> const& rhs){ lhs.append(rhs.begin(), rhs.end()); }
+};
+}	// impl
+
+}
+#endif
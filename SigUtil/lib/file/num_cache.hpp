@@ -0,0 +1,296 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_NUM_CACHE_HPP
+#define SIG_UTIL_NUM_CACHE_HPP
+
+#include "pass.hpp"
+#include "load.hpp"
+#include "binary_num.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <sys/stat.h>
+#endif
+
+
+/// \file num_cache.hpp テキストファイルから読み込んだ数値データのキャッシュ
+
+namespace sig
+{
+namespace impl
+{
+
+// FNV-1a
+inline std::uint64_t hash_bytes(void const* data, uint size, std::uint64_t hash = 14695981039346656037ULL)
+{
+	auto p = static_cast<unsigned char const*>(data);
+	for (uint i = 0; i < size; ++i){
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// キャッシュファイルの末尾に付加するキーの目印 (キー, キーのバイト数(8byte), 目印 の順に格納する)
+static const char num_cache_key_magic[8] = { 'S', 'I', 'G', 'N', 'C', 'K', 'E', 'Y' };
+
+}	// impl
+
+
+/// テキストファイルから読み込んだ数値データのキャッシュ
+/**
+	load_num, load_num2d で読み込んだ結果をバイナリ形式（save_num_binary の形式）でキャッシュ用のディレクトリに保存し、
+	次回以降の読み込みでは元のテキストファイルを変換し直さずにキャッシュから読み込む．\n
+	キャッシュは元ファイルのパス・サイズ・最終更新時刻、読み込む数値型、読み込み方法（区切り文字等）の組に対して作成されるため、
+	元ファイルが更新された場合は自動的に変換し直される（古いキャッシュファイルは自動では削除されない）．
+	キャッシュファイルの名前はこの組のハッシュ値で、ファイルの末尾に組そのものを保存して読み込み時に照合する．\n
+	キャッシュは一時ファイルに書き込んでから置き換えるため、複数のプロセスが同時に同じキャッシュを作成しても、読み込み途中・書き込み途中のキャッシュが参照されることはない．\n
+	ファイルの更新時刻を取得できない環境ではキャッシュを使用せずに毎回変換する．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("matrix.txt");
+
+	NumCache cache(dir + SIG_TO_FPSTR("cache"));
+
+	auto mat = cache.load_num2d<double>(fpass, ",");			// 初回はテキストを変換し、キャッシュを作成
+	auto mat2 = cache.load_num2d<double>(fpass, ",");			// 2回目以降はキャッシュから読み込む
+	auto mapped = cache.load_num2d_mapped<double>(fpass, ",");	// キャッシュをメモリマップして参照 (MappedMatrix<double>)
+	\endcode
+*/
+class NumCache
+{
+	FilepassString dir_;
+
+private:
+	static FilepassString to_hex(std::uint64_t v)
+	{
+		const char digits[] = "0123456789abcdef";
+		FilepassString s(16, '0');
+		for (int i = 15; i >= 0; --i, v >>= 4) s[i] = digits[v & 0xf];
+		return s;
+	}
+
+	template <class V>
+	static void append_bytes(std::string& dest, V const& v){ dest.append(reinterpret_cast<char const*>(&v), sizeof(v)); }
+
+	// 元ファイルのパス・サイズ・最終更新時刻、数値型 T、読み込み方法 kind を並べたキャッシュのキー
+	template <class T>
+	static std::string cache_key(FilepassString const& file_pass, impl::FileStamp const& stamp, std::string const& kind)
+	{
+		std::string key;
+		append_bytes(key, static_cast<std::uint64_t>(file_pass.size() * sizeof(file_pass[0])));
+		key.append(reinterpret_cast<char const*>(file_pass.data()), file_pass.size() * sizeof(file_pass[0]));
+		append_bytes(key, stamp.size);
+		append_bytes(key, stamp.mtime);
+		append_bytes(key, static_cast<std::uint32_t>(impl::binary_dtype<T>::value));
+		key += kind;
+		return key;
+	}
+
+	// キーに対するキャッシュファイルのパス（ファイル名はキーのハッシュ値）
+	FilepassString cache_pass(std::string const& key) const
+	{
+		return dir_ + to_hex(impl::hash_bytes(key.data(), key.size())) + SIG_TO_FPSTR(".signum");
+	}
+
+	// save_num_binary で保存したファイルの末尾にキーを付加する（load_num2d_binary 等は要素の後ろのデータを無視する）
+	static bool append_key(FilepassString const& cpass, std::string const& key)
+	{
+		std::ofstream ofs(cpass, std::ios::out | std::ios::binary | std::ios::app);
+		ofs.write(key.data(), key.size());
+		const std::uint64_t size = key.size();
+		ofs.write(reinterpret_cast<char const*>(&size), sizeof(size));
+		ofs.write(impl::num_cache_key_magic, sizeof(impl::num_cache_key_magic));
+		ofs.close();
+		return !ofs.fail();
+	}
+
+	// キャッシュファイルに付加されたキーが一致するか（ハッシュ値が衝突した別のキャッシュを使用しない）
+	static bool match_key(FilepassString const& cpass, std::string const& key)
+	{
+		MappedFile file(cpass);
+		const uint trailer = key.size() + sizeof(std::uint64_t) + sizeof(impl::num_cache_key_magic);
+		if (!file || file.size() < sizeof(impl::BinaryNumHeader) + trailer) return false;
+
+		char const* tail = file.data() + file.size() - trailer;
+		std::uint64_t size;
+		std::memcpy(&size, tail + key.size(), sizeof(size));
+
+		return size == key.size() && std::memcmp(tail, key.data(), key.size()) == 0
+			&& std::memcmp(tail + key.size() + sizeof(size), impl::num_cache_key_magic, sizeof(impl::num_cache_key_magic)) == 0;
+	}
+
+	// キャッシュが無ければ parse() で読み込んで保存し、キャッシュのパスを返す (キャッシュを使用できない場合は空)
+	template <class T, class F>
+	FilepassString prepare(FilepassString const& file_pass, std::string const& kind, F&& parse) const
+	{
+		const auto stamp = impl::get_file_stamp(file_pass);
+		if (!stamp.valid) return FilepassString();
+
+		const auto key = cache_key<T>(file_pass, stamp, kind);
+		const auto cpass = cache_pass(key);
+		if (match_key(cpass, key)) return cpass;		// キーが一致しない場合（ハッシュ値の衝突・壊れたキャッシュ）は作り直す
+
+		const auto tmp_pass = cpass + impl::unique_tmp_suffix();
+		if (!parse(tmp_pass) || !append_key(tmp_pass, key)){
+			impl::remove_file(tmp_pass);	// 途中まで書き込まれている場合がある
+			return FilepassString();
+		}
+
+		// 変換中に元ファイルが更新された場合は保存しない
+		if (impl::get_file_stamp(file_pass) != stamp){
+			impl::remove_file(tmp_pass);
+			return FilepassString();
+		}
+		return impl::replace_file(tmp_pass, cpass) || match_key(cpass, key) ? cpass : FilepassString();
+	}
+
+public:
+	/// キャッシュ用のディレクトリを指定する（存在しない場合は作成する）
+	explicit NumCache(FilepassString const& cache_dir)
+		: dir_(modify_dirpass_tail(cache_dir, true))
+	{
+#if SIG_MSVC_ENV
+		CreateDirectoryW(cache_dir.c_str(), nullptr);
+#elif SIG_LINUX_ENV
+		::mkdir(cache_dir.c_str(), 0755);
+#endif
+	}
+
+	/// キャッシュ用のディレクトリ
+	FilepassString directory() const{ return dir_; }
+
+	/// 2次元配列の数値(ex:行列)を読み込む（キャッシュがあればキャッシュから読み込む）
+	/**
+		\tparam R 数値の型（int, double等）
+		\tparam CC [option] コンテナの型（\ref sig_container )
+
+		\param file_pass 読み込むテキストファイルのパス
+		\param delimiter 数値間の区切り文字
+		\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+		\return 読み込み結果（値は\ref sig_maybe で返される）
+
+		\exception std::invalid_argument, std::out_of_range（テキストの変換時. load_num2d と同じ）
+
+		\sa load_num2d(FilepassString const& file_pass, std::string delimiter, uint thread_num)
+	*/
+	template <
+		class R,
+		class CC = std::vector<std::vector<R>>
+	>
+	auto load_num2d(
+		FilepassString const& file_pass,
+		std::string delimiter,
+		uint thread_num = 0) const
+		->Maybe<CC>
+	{
+		CC result;
+		bool loaded = false;
+
+		const auto cpass = prepare<R>(file_pass, "num2d:" + delimiter, [&](FilepassString const& tmp_pass){
+			loaded = sig::load_num2d(result, file_pass, delimiter, thread_num);
+			return loaded && save_num_binary(result, tmp_pass);
+		});
+
+		// キャッシュを読み込めた場合は結果が空でも変換し直さない
+		if (!loaded && (cpass.empty() || !load_num2d_binary(result, cpass))){
+			result = CC();
+			sig::load_num2d(result, file_pass, delimiter, thread_num);
+		}
+		return result.size() ? Just<CC>(std::move(result)) : Nothing(std::move(result));
+	}
+
+	/// 2次元配列の数値(ex:行列)を読み込み、キャッシュをメモリマップして参照する
+	/**
+		キャッシュが無い場合はテキストを変換してキャッシュを作成してから参照する
+
+		\tparam T 数値の型（int, double等）
+
+		\param file_pass 読み込むテキストファイルのパス
+		\param delimiter 数値間の区切り文字
+		\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+		\return キャッシュを参照する MappedMatrix（値は\ref sig_maybe で返される. キャッシュを作成できない場合は Nothing）
+
+		\exception std::invalid_argument, std::out_of_range（テキストの変換時. load_num2d と同じ）
+	*/
+	template <class T>
+	auto load_num2d_mapped(
+		FilepassString const& file_pass,
+		std::string delimiter,
+		uint thread_num = 0) const
+		->Maybe<MappedMatrix<T>>
+	{
+		const auto cpass = prepare<T>(file_pass, "num2d:" + delimiter, [&](FilepassString const& tmp_pass){
+			auto mat = sig::load_num2d<T, std::vector<std::vector<T>>>(file_pass, delimiter, thread_num);
+			return isJust(mat) && save_num_binary(fromJust(mat), tmp_pass);
+		});
+
+		if (cpass.empty()) return Nothing(MappedMatrix<T>());
+		return sig::load_num2d_mapped<T>(cpass);
+	}
+
+	/// 数値列を読み込む（キャッシュがあればキャッシュから読み込む）
+	/**
+		\tparam R 数値の型（int, double等）
+		\tparam C [option] コンテナの型（\ref sig_container )
+
+		\param file_pass 読み込むテキストファイルのパス
+		\param delimiter [option] 数値間の区切り文字
+		\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+		\return 読み込み結果（値は\ref sig_maybe で返される）
+
+		\exception std::invalid_argument, std::out_of_range（テキストの変換時. load_num と同じ）
+
+		\sa load_num(FilepassString const& file_pass, std::string delimiter, uint thread_num)
+	*/
+	template <
+		class R,
+		class C = std::vector<R>
+	>
+	auto load_num(
+		FilepassString const& file_pass,
+		std::string delimiter = "\n",
+		uint thread_num = 0) const
+		->Maybe<C>
+	{
+		std::vector<C> tmp(1);		// 1行の行列として保存する
+		C& result = tmp[0];
+		bool loaded = false;
+
+		const auto cpass = prepare<R>(file_pass, "num:" + delimiter, [&](FilepassString const& tmp_pass){
+			loaded = sig::load_num(result, file_pass, delimiter, thread_num);
+			return loaded && save_num_binary(tmp, tmp_pass);
+		});
+
+		// キャッシュを読み込めた場合は結果が空でも変換し直さない
+		bool cached = false;
+		if (!loaded && !cpass.empty()){
+			auto mapped = sig::load_num2d_mapped<R>(cpass);
+			if (isJust(mapped)){
+				for (auto v : fromJust(mapped)) impl::container_traits<C>::add_element(result, v);
+				cached = true;
+			}
+		}
+		if (!loaded && !cached){
+			sig::load_num(result, file_pass, delimiter, thread_num);
+		}
+		return result.size() ? Just<C>(std::move(result)) : Nothing(std::move(result));
+	}
+};
+
+}
+#endif
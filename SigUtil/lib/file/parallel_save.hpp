@@ -0,0 +1,266 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_PARALLEL_SAVE_HPP
+#define SIG_UTIL_PARALLEL_SAVE_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/charconv.hpp"
+#include "../helper/parallel.hpp"
+#include "save.hpp"
+
+#include <fstream>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <mutex>
+#include <cstdint>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+/// \file parallel_save.hpp 大きな数値行列を並列に文字列化し、1つのファイルへ並列に書き込む保存
+
+namespace sig
+{
+namespace impl
+{
+
+// テキストモードで書き込んだ場合と同じ改行文字
+#if SIG_MSVC_ENV
+const char text_newline[] = "\r\n";
+#else
+const char text_newline[] = "\n";
+#endif
+
+// 行列の1行を save_num と同じ形式で dest の末尾に追加する
+template <class C>
+void append_num_line(std::string& dest, C const& row, std::string const& delimiter)
+{
+	auto it = std::begin(row);
+	auto end = std::end(row);
+
+	if (it != end){
+		append_num(dest, *it);
+		for (++it; it != end; ++it){
+			dest += delimiter;
+			append_num(dest, *it);
+		}
+	}
+	dest += text_newline;
+}
+
+// 位置を指定して書き込むファイル (write_at は複数のスレッドから同時に呼び出してよい)
+class PositionalWriter
+{
+#if SIG_MSVC_ENV
+	HANDLE handle_;
+#elif SIG_LINUX_ENV
+	int fd_;
+#else
+	std::fstream fs_;
+	std::mutex mutex_;
+#endif
+	std::uint64_t size_;
+
+public:
+	PositionalWriter(FilepassString const& file_pass, WriteMode open_mode) : size_(0)
+	{
+#if SIG_MSVC_ENV
+		handle_ = CreateFileW(file_pass.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, open_mode == WriteMode::overwrite ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle_ == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(handle_, &size)) size_ = static_cast<std::uint64_t>(size.QuadPart);
+#elif SIG_LINUX_ENV
+		// O_APPEND を指定すると pwrite の位置が無視されるため、追記の場合は末尾の位置から書き込む
+		fd_ = ::open(file_pass.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (open_mode == WriteMode::overwrite ? O_TRUNC : 0), 0666);
+		if (fd_ < 0) return;
+
+		const off_t size = ::lseek(fd_, 0, SEEK_END);
+		if (size > 0) size_ = static_cast<std::uint64_t>(size);
+#else
+		if (open_mode == WriteMode::append){
+			std::ofstream(file_pass, std::ios::out | std::ios::app | std::ios::binary);	// 存在しない場合は作成
+			fs_.open(file_pass, std::ios::in | std::ios::out | std::ios::binary);
+			fs_.seekp(0, std::ios::end);
+			size_ = static_cast<std::uint64_t>(fs_.tellp());
+		}
+		else{
+			fs_.open(file_pass, std::ios::out | std::ios::trunc | std::ios::binary);
+		}
+#endif
+	}
+
+	~PositionalWriter()
+	{
+#if SIG_MSVC_ENV
+		if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+#elif SIG_LINUX_ENV
+		if (fd_ >= 0) ::close(fd_);
+#endif
+	}
+
+	PositionalWriter(PositionalWriter const&) = delete;
+	PositionalWriter& operator=(PositionalWriter const&) = delete;
+
+	bool is_open() const
+	{
+#if SIG_MSVC_ENV
+		return handle_ != INVALID_HANDLE_VALUE;
+#elif SIG_LINUX_ENV
+		return fd_ >= 0;
+#else
+		return fs_.is_open();
+#endif
+	}
+
+	// 現在のファイルの長さ
+	std::uint64_t size() const{ return size_; }
+
+	// ファイルの長さを size byte に伸ばす (書き込み前に領域を確保しておく)
+	bool extend(std::uint64_t size)
+	{
+		if (size <= size_) return true;
+#if SIG_MSVC_ENV
+		LARGE_INTEGER pos;
+		pos.QuadPart = static_cast<LONGLONG>(size);
+		if (!SetFilePointerEx(handle_, pos, nullptr, FILE_BEGIN) || !SetEndOfFile(handle_)) return false;
+#elif SIG_LINUX_ENV
+		if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) return false;
+#endif
+		size_ = size;
+		return true;
+	}
+
+	// ファイルの pos の位置に [data, data + size) を書き込む
+	bool write_at(std::uint64_t pos, char const* data, std::uint64_t size)
+	{
+#if SIG_MSVC_ENV
+		while (size){
+			OVERLAPPED ov = {};
+			ov.Offset = static_cast<DWORD>(pos);
+			ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+			DWORD written = 0;
+			const DWORD n = static_cast<DWORD>(std::min<std::uint64_t>(size, 1u << 30));
+			if (!WriteFile(handle_, data, n, &written, &ov) || written == 0) return false;
+			pos += written; data += written; size -= written;
+		}
+		return true;
+#elif SIG_LINUX_ENV
+		while (size){
+			const ssize_t written = ::pwrite(fd_, data, static_cast<std::size_t>(std::min<std::uint64_t>(size, 1u << 30)), static_cast<off_t>(pos));
+			if (written <= 0) return false;
+			pos += written; data += written; size -= written;
+		}
+		return true;
+#else
+		std::lock_guard<std::mutex> lock(mutex_);
+		fs_.seekp(pos, std::ios::beg);
+		fs_.write(data, size);
+		return static_cast<bool>(fs_.flush());
+#endif
+	}
+};
+
+}	// impl
+
+
+/// 2次元配列の数値(ex:行列)を並列に文字列化して保存
+/**
+	行列を要素数が block_size 程度の行のブロックに分け、各ブロックを並列に文字列に変換する．\n
+	変換したブロックの長さからファイル上の書き込み位置を求め、ファイルの領域を確保した上で、各ブロックを位置を指定した書き込み (Linux: pwrite, Windows: WriteFile) で並列に書き込む．\n
+	変換・書き込みは thread_num × 4 ブロック毎にまとめて行うため、行列全体の文字列を同時に保持することはない．\n
+	出力内容は save_num(CC const&, FilepassString const&, std::string, WriteMode) と同じになる（浮動小数点数は精度6の書式）．\n
+	書き込みに失敗した場合、ファイルには途中までの内容が残る．
+
+	\param src 保存対象の行列（\ref sig_container )
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param delimiter 数値間の区切り文字
+	\param open_mode [option] 上書き(overwrite) or 追記(append)
+	\param thread_num [option] 使用するスレッド数（0の場合はハードウェアの並列数）
+	\param block_size [option] 1ブロックの要素数の目安
+
+	\return 保存の成否
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("matrix.txt");
+
+	std::vector<std::vector<double>> mat(100000, std::vector<double>(1000));
+	for (auto& row : mat) for (auto& v : row) v = std::rand() / 3.0;
+
+	save_num_parallel(mat, fpass, ",");	// save_num(mat, fpass, ",") と同じ内容
+	\endcode
+*/
+template <class CC,
+	typename std::enable_if<impl::container_traits<typename impl::container_traits<CC>::value_type>::exist>::type*& = enabler
+>
+bool save_num_parallel(
+	CC const& src,
+	FilepassString const& file_pass,
+	std::string const& delimiter,
+	WriteMode open_mode = WriteMode::overwrite,
+	uint thread_num = 0,
+	uint block_size = 1 << 16)
+{
+	using RowIterator = decltype(std::begin(src));
+
+	impl::PositionalWriter file(file_pass, open_mode);
+	if (!file.is_open()) return false;
+
+	// 各ブロックの先頭行
+	std::vector<RowIterator> heads;
+	uint count = block_size;
+	for (auto it = std::begin(src), end = std::end(src); it != end; ++it){
+		if (count >= block_size){
+			heads.push_back(it);
+			count = 0;
+		}
+		count += std::max<uint>(1, std::distance(std::begin(*it), std::end(*it)));
+	}
+	heads.push_back(std::end(src));
+
+	const uint block_num = heads.size() - 1;
+	const uint threads = impl::resolve_thread_num(thread_num);
+	const uint round_size = threads * 4;
+	std::uint64_t pos = file.size();
+
+	for (uint first = 0; first < block_num; first += round_size){
+		const uint num = std::min(round_size, block_num - first);
+
+		auto blocks = impl::parallel_generate<std::string>(num, threads, [&](uint i){
+			std::string block;
+			for (auto it = heads[first + i], end = heads[first + i + 1]; it != end; ++it){
+				impl::append_num_line(block, *it, delimiter);
+			}
+			return block;
+		});
+
+		std::vector<std::uint64_t> offsets(num + 1, pos);
+		for (uint i = 0; i < num; ++i) offsets[i + 1] = offsets[i] + blocks[i].size();
+		if (!file.extend(offsets[num])) return false;
+
+		const auto written = impl::parallel_generate<int>(num, threads, [&](uint i){
+			return file.write_at(offsets[i], blocks[i].data(), blocks[i].size()) ? 1 : 0;
+		});
+		if (std::count(written.begin(), written.end(), 0)) return false;
+
+		pos = offsets[num];
+	}
+	return true;
+}
+
+}
+#endif
@@ -11,6 +11,10 @@ http://opensource.org/licenses/mit-license.php
 #include "../helper/helper_modules.hpp"
 #include "../helper/maybe.hpp"
 #include "../string/manipulate.hpp"
+#include "../helper/parallel.hpp"
+
+#include <mutex>
+#include <condition_variable>
 
 #if SIG_MSVC_ENV
 #define NOMINMAX
@@ -21,6 +25,16 @@ http://opensource.org/licenses/mit-license.php
 	namespace fs = boost::filesystem;
 #endif
 
+#if SIG_LINUX_ENV
+	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <cstdint>
+	#include <cstring>
+#endif
+
 
 /// \file pass.hpp ファイル・フォルダに関する情報取得
 
@@ -110,6 +124,9 @@ inline auto get_file_names(
 		else return false;
 	};
 
+	// 拡張子の正規表現はファイル毎ではなく1度だけ取得する
+	const auto ext_reg = extension.empty() ? nullptr : sig::cached_regex(L".*(" + sig::escape_regex(extension) + L")");
+
 	fs::directory_iterator end;
 	for (fs::directory_iterator it(directory_pass); it != end; ++it)
 	{
@@ -117,8 +134,7 @@ inline auto get_file_names(
 			auto leaf = sig::split(it->path().wstring(), L"/").back();
 			if (extension.empty()) result.push_back(leaf);
 			else{
-				auto query = L".*(" + sig::escape_regex(extension) + L")";
-				auto ext = sig::regex_search(leaf, SIG_WRegex(query));
+				auto ext = sig::regex_search(leaf, *ext_reg);
 				if (isJust(ext) && fromJust(ext)[0][1] == extension) result.push_back(leaf);
 			}
 		}
@@ -191,6 +207,303 @@ inline auto get_folder_names(
 #endif
 }
 
+namespace impl
+{
+// ワイルドカード('*': 任意の文字列, '?': 任意の1文字)を含むパターンと名前を照合する
+template <class CHAR>
+bool glob_match(CHAR const* pat, CHAR const* pat_end, CHAR const* str, CHAR const* str_end)
+{
+	CHAR const* star = nullptr;		// 直前の'*'の次の位置
+	CHAR const* retry = nullptr;	// '*'に対応させた文字列の末尾
+
+	while (str != str_end){
+		if (pat != pat_end && *pat == '*'){
+			star = ++pat;
+			retry = str;
+		}
+		else if (pat != pat_end && (*pat == '?' || *pat == *str)){
+			++pat;
+			++str;
+		}
+		else if (star){
+			pat = star;
+			str = ++retry;
+		}
+		else return false;
+	}
+	while (pat != pat_end && *pat == '*') ++pat;
+	return pat == pat_end;
+}
+
+// scan_file_names, scan_folder_names の走査条件
+struct ScanCondition
+{
+	FilepassString pattern;
+	bool recursive;
+	bool include_hidden;
+	bool want_folder;
+
+	bool match(FilepassString::value_type const* name, uint length) const
+	{
+		return pattern.empty() || glob_match(pattern.data(), pattern.data() + pattern.size(), name, name + length);
+	}
+};
+
+#if SIG_LINUX_ENV
+struct LinuxDirent64
+{
+	std::uint64_t d_ino;
+	std::int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[1];
+};
+
+// root_fd からの相対パス dir (空 または '/'終端) のディレクトリを走査し、条件に合う名前を result に、再帰対象のディレクトリを subdirs に追加する
+inline bool scan_directory(int root_fd, std::string const& dir, ScanCondition const& cond, std::vector<std::string>& result, std::vector<std::string>& subdirs)
+{
+	const int fd = ::openat(root_fd, dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) return false;
+
+	std::uint64_t buffer[4096];
+
+	while (true){
+		const long n = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+		if (n <= 0) break;
+
+		for (long pos = 0; pos < n;){
+			auto entry = reinterpret_cast<LinuxDirent64 const*>(reinterpret_cast<char const*>(buffer) + pos);
+			pos += entry->d_reclen;
+
+			char const* name = entry->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+			if (name[0] == '.' && !cond.include_hidden) continue;
+
+			unsigned char type = entry->d_type;
+			if (type == DT_UNKNOWN){
+				struct stat st;
+				if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+				type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : DT_REG;
+			}
+
+			// シンボリックリンクはリンク先の種類で判定するが、再帰の対象にはしない
+			bool is_folder = type == DT_DIR;
+			if (type == DT_LNK){
+				struct stat st;
+				is_folder = ::fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+			}
+
+			const uint length = std::strlen(name);
+			if (is_folder == cond.want_folder && cond.match(name, length)){
+				result.push_back(dir);
+				result.back().append(name, length);
+			}
+			if (type == DT_DIR && cond.recursive){
+				subdirs.push_back(dir);
+				subdirs.back().append(name, length).push_back('/');
+			}
+		}
+	}
+	::close(fd);
+	return true;
+}
+
+// 未走査のディレクトリを共有し、複数のスレッドで走査する
+inline bool scan_names(FilepassString const& directory_pass, ScanCondition const& cond, uint thread_num, std::vector<FilepassString>& result)
+{
+	const int root_fd = ::open(directory_pass.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (root_fd < 0) return false;
+
+	std::vector<std::string> stack;
+	if (!scan_directory(root_fd, "", cond, result, stack)){
+		::close(root_fd);
+		return false;
+	}
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	uint active = 0;	// 走査中のスレッド数
+
+	auto worker = [&](){
+		std::vector<std::string> local, subdirs;
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true){
+			cv.wait(lock, [&]{ return !stack.empty() || active == 0; });
+			if (stack.empty()) break;
+
+			const std::string dir = std::move(stack.back());
+			stack.pop_back();
+			++active;
+			lock.unlock();
+
+			scan_directory(root_fd, dir, cond, local, subdirs);	// 読み込めないサブディレクトリは無視
+
+			lock.lock();
+			--active;
+			for (auto& sub : subdirs) stack.push_back(std::move(sub));
+			if (!subdirs.empty() || active == 0) cv.notify_all();
+			subdirs.clear();
+		}
+		result.insert(result.end(), std::make_move_iterator(local.begin()), std::make_move_iterator(local.end()));
+	};
+
+	// 起動したスレッドが stack を変更し始めるため、未走査のディレクトリの有無はスレッドの起動前に判定する
+	const uint n = stack.empty() ? 1 : resolve_thread_num(thread_num);
+	std::vector<std::thread> threads;
+
+	for (uint t = 1; t < n; ++t){
+		try{
+			threads.emplace_back(worker);
+		}
+		catch (std::system_error const&){
+			break;
+		}
+	}
+	worker();
+	for (auto& th : threads) th.join();
+
+	::close(root_fd);
+	return true;
+}
+
+#elif SIG_MSVC_ENV
+inline bool scan_names(FilepassString const& directory_pass, ScanCondition const& cond, uint thread_num, std::vector<FilepassString>& result)
+{
+	std::vector<FilepassString> stack(1, L"");
+	const auto root = modify_dirpass_tail(directory_pass, true);
+
+	for (bool first = true; !stack.empty(); first = false){
+		const auto dir = std::move(stack.back());
+		stack.pop_back();
+
+		WIN32_FIND_DATAW fd;
+		auto hFind = FindFirstFileExW((root + dir + L"*").c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+
+		if (hFind == INVALID_HANDLE_VALUE){
+			if (first) return false;
+			continue;
+		}
+		do{
+			const std::wstring name(fd.cFileName);
+			if (name == L"." || name == L"..") continue;
+			if ((fd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) && !cond.include_hidden) continue;
+
+			const bool is_folder = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+			if (is_folder == cond.want_folder && cond.match(name.data(), name.size())) result.push_back(dir + name);
+			if (is_folder && !(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && cond.recursive) stack.push_back(dir + name + L"/");
+		} while (FindNextFileW(hFind, &fd));
+
+		FindClose(hFind);
+	}
+	return true;
+}
+
+#elif SIG_ENABLE_BOOST
+inline bool scan_names(FilepassString const& directory_pass, ScanCondition const& cond, uint thread_num, std::vector<FilepassString>& result)
+{
+	boost::system::error_code ec;
+	std::vector<FilepassString> stack(1, "");
+
+	for (bool first = true; !stack.empty(); first = false){
+		const auto dir = std::move(stack.back());
+		stack.pop_back();
+
+		fs::directory_iterator it(fs::path(directory_pass) / dir, ec), end;
+		if (ec){
+			if (first) return false;
+			continue;
+		}
+		for (; it != end; it.increment(ec)){
+			const auto name = it->path().filename().string();
+			if (name[0] == '.' && !cond.include_hidden) continue;
+
+			const bool is_folder = fs::is_directory(it->status());
+			if (is_folder == cond.want_folder && cond.match(name.data(), name.size())) result.push_back(dir + name);
+			if (is_folder && !fs::is_symlink(it->symlink_status()) && cond.recursive) stack.push_back(dir + name + "/");
+		}
+	}
+	return true;
+}
+#endif
+
+inline auto scan_names(FilepassString const& directory_pass, ScanCondition const& cond, uint thread_num) ->Maybe<std::vector<FilepassString>>
+{
+	using ResultType = std::vector<FilepassString>;
+
+	ResultType result;
+
+#if SIG_LINUX_ENV || SIG_MSVC_ENV || SIG_ENABLE_BOOST
+	if (!scan_names(directory_pass, cond, thread_num, result)) return Nothing(std::move(result));
+
+	std::sort(result.begin(), result.end());
+	return Just<ResultType>(std::move(result));
+#else
+	std::cout << "I don't support this envirnment which is default. please include boost if any." << std::endl; 
+	assert(false);
+#endif
+}
+
+}	// impl
+
+
+/// 指定ディレクトリ以下にあるファイルを再帰的に走査し、パスの一覧を取得
+/**
+	get_file_names と異なり、サブディレクトリも含めて走査する．\n
+	Linux環境では getdents64 で直接ディレクトリを読み込み、サブディレクトリを複数のスレッドで並列に走査する．\n
+	名前の照合には正規表現を用いず、結果はワイド文字列に変換せず FilepassString で返す．\n
+	シンボリックリンクはリンク先の種類で判定されるが、リンク先のディレクトリは走査しない．
+
+	\param directory_pass 調べたいディレクトリのパス
+	\param pattern [option] ファイル名のパターン（'*': 任意の文字列, '?': 任意の1文字. 例: "*.txt"）. 空の場合は全てのファイル
+	\param recursive [option] サブディレクトリを走査するか
+	\param include_hidden [option] 隠しファイル・隠しディレクトリも対象とするか
+	\param thread_num [option] 使用するスレッド数（0の場合はハードウェアの並列数. Linux環境のみ）
+
+	\return directory_pass からの相対パス（区切り文字は'/'）の一覧を辞書順に並べたもの（値は\ref sig_maybe で返される）
+
+	\code
+	const auto dir = SIG_TO_FPSTR("./dataset");
+
+	auto texts = scan_file_names(dir, SIG_TO_FPSTR("*.txt"));	// { "a.txt", "sub/b.txt", ... }
+	\endcode
+*/
+inline auto scan_file_names(
+	FilepassString const& directory_pass,
+	FilepassString const& pattern = SIG_TO_FPSTR(""),
+	bool recursive = true,
+	bool include_hidden = false,
+	uint thread_num = 0
+)
+	->Maybe<std::vector<FilepassString>>
+{
+	return impl::scan_names(directory_pass, impl::ScanCondition{ pattern, recursive, include_hidden, false }, thread_num);
+}
+
+/// 指定ディレクトリ以下にあるフォルダを再帰的に走査し、パスの一覧を取得
+/**
+	\param directory_pass 調べたいディレクトリのパス
+	\param pattern [option] フォルダ名のパターン（'*': 任意の文字列, '?': 任意の1文字）. 空の場合は全てのフォルダ
+	\param recursive [option] サブディレクトリを走査するか
+	\param include_hidden [option] 隠しフォルダも対象とするか
+	\param thread_num [option] 使用するスレッド数（0の場合はハードウェアの並列数. Linux環境のみ）
+
+	\return directory_pass からの相対パス（区切り文字は'/'）の一覧を辞書順に並べたもの（値は\ref sig_maybe で返される）
+
+	\sa scan_file_names
+*/
+inline auto scan_folder_names(
+	FilepassString const& directory_pass,
+	FilepassString const& pattern = SIG_TO_FPSTR(""),
+	bool recursive = true,
+	bool include_hidden = false,
+	uint thread_num = 0
+)
+	->Maybe<std::vector<FilepassString>>
+{
+	return impl::scan_names(directory_pass, impl::ScanCondition{ pattern, recursive, include_hidden, true }, thread_num);
+}
+
 }
 
 #endif
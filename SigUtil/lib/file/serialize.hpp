@@ -0,0 +1,510 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_SERIALIZE_HPP
+#define SIG_UTIL_SERIALIZE_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/maybe.hpp"
+#include "mapped_file.hpp"
+#include "mapped_vector.hpp"
+
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+/// \file serialize.hpp 値・コンテナのバイナリ形式での保存・読み込み
+
+namespace sig
+{
+namespace impl
+{
+
+// ファイル形式 (各値は実行環境のバイトオーダーで格納)
+//  [0, 24)      : ヘッダ
+//  [24, ...)    : 型の記述 (signature_size byte). 読み込み時に型が一致するか確認する
+//  [..., ...)   : 値. 算術型はそのまま, 文字列・コンテナは要素数 (uint64) に続けて各要素, pair・tuple は各要素を順に格納
+struct BinaryHeader
+{
+	char magic[8];					// "SIGBIN\0\0"
+	std::uint32_t byte_order;		// 0x01020304 (バイトオーダーの判定用)
+	std::uint32_t version;			// ファイル形式のバージョン
+	std::uint32_t user_version;		// 保存時に指定されたデータのバージョン
+	std::uint32_t signature_size;
+};
+static_assert(sizeof(BinaryHeader) == 24, "unexpected padding in BinaryHeader");
+
+static const char binary_magic[8] = { 'S', 'I', 'G', 'B', 'I', 'N', '\0', '\0' };
+static const std::uint32_t binary_byte_order = 0x01020304;
+static const std::uint32_t binary_version = 1;
+
+// バッファにまとめてファイルに書き込む (大きな連続領域はバッファを介さない)
+class BinaryWriter
+{
+	std::ofstream& ofs_;
+	std::string buffer_;
+
+public:
+	explicit BinaryWriter(std::ofstream& ofs) : ofs_(ofs){ buffer_.reserve(1 << 20); }
+
+	void write(void const* data, uint size)
+	{
+		if (size >= (1 << 16)){
+			flush();
+			ofs_.write(static_cast<char const*>(data), size);
+			return;
+		}
+		buffer_.append(static_cast<char const*>(data), size);
+		if (buffer_.size() >= (1 << 20)) flush();
+	}
+
+	template <class T>
+	void put(T const& value){ write(&value, sizeof(T)); }
+
+	void flush()
+	{
+		ofs_.write(buffer_.data(), buffer_.size());
+		buffer_.clear();
+	}
+};
+
+// メモリ上の範囲から読み込む (範囲を超える場合は失敗)
+class BinaryReader
+{
+	char const* pos_;
+	char const* end_;
+
+public:
+	BinaryReader(char const* first, char const* last) : pos_(first), end_(last){}
+
+	bool read(void* dest, uint size)
+	{
+		if (static_cast<uint>(end_ - pos_) < size) return false;
+		std::memcpy(dest, pos_, size);
+		pos_ += size;
+		return true;
+	}
+
+	template <class T>
+	bool get(T& value){ return read(&value, sizeof(T)); }
+
+	// 要素数を読み込む（残りのバイト数より多い場合は壊れたデータとみなす）
+	bool get_size(uint& size)
+	{
+		std::uint64_t n;
+		if (!get(n) || n > remaining()) return false;
+		size = static_cast<uint>(n);
+		return true;
+	}
+
+	uint remaining() const{ return end_ - pos_; }
+};
+
+
+// 型 T の保存・読み込み方法. 特殊化を定義することで任意の型に対応できる
+template <class T, class Enable = void>
+struct BinarySerializer
+{
+	static const bool exist = false;
+};
+
+// 算術型・列挙型
+template <class T>
+struct BinarySerializer<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value>::type>
+{
+	static const bool exist = true;
+	static const bool bulk = true;	// 連続した領域をまとめてコピーできるか
+
+	static void signature(std::string& sig)
+	{
+		sig += std::is_same<T, bool>::value ? 'b' : std::is_enum<T>::value ? 'e' : std::is_floating_point<T>::value ? 'f' : std::is_signed<T>::value ? 'i' : 'u';
+		sig += std::to_string(sizeof(T));
+	}
+	static void write(BinaryWriter& out, T const& value){ out.put(value); }
+	static bool read(BinaryReader& in, T& value){ return in.get(value); }
+};
+
+// 文字列
+template <class CHAR, class TRAITS, class A>
+struct BinarySerializer<std::basic_string<CHAR, TRAITS, A>>
+{
+	static const bool exist = true;
+	static const bool bulk = false;
+
+	static void signature(std::string& sig){ sig += "s" + std::to_string(sizeof(CHAR)); }
+
+	static void write(BinaryWriter& out, std::basic_string<CHAR, TRAITS, A> const& value)
+	{
+		out.put(static_cast<std::uint64_t>(value.size()));
+		out.write(value.data(), value.size() * sizeof(CHAR));
+	}
+	static bool read(BinaryReader& in, std::basic_string<CHAR, TRAITS, A>& value)
+	{
+		uint size;
+		if (!in.get_size(size) || size * sizeof(CHAR) > in.remaining()) return false;
+		value.resize(size);
+		return in.read(&value[0], size * sizeof(CHAR));
+	}
+};
+
+// pair
+template <class T1, class T2>
+struct BinarySerializer<std::pair<T1, T2>>
+{
+	static const bool exist = BinarySerializer<typename std::remove_const<T1>::type>::exist && BinarySerializer<T2>::exist;
+	static const bool bulk = false;
+
+	static void signature(std::string& sig)
+	{
+		sig += '(';
+		BinarySerializer<typename std::remove_const<T1>::type>::signature(sig);
+		sig += ',';
+		BinarySerializer<T2>::signature(sig);
+		sig += ')';
+	}
+	static void write(BinaryWriter& out, std::pair<T1, T2> const& value)
+	{
+		BinarySerializer<typename std::remove_const<T1>::type>::write(out, value.first);
+		BinarySerializer<T2>::write(out, value.second);
+	}
+	static bool read(BinaryReader& in, std::pair<typename std::remove_const<T1>::type, T2>& value)
+	{
+		return BinarySerializer<typename std::remove_const<T1>::type>::read(in, value.first) && BinarySerializer<T2>::read(in, value.second);
+	}
+};
+
+// tuple
+template <uint I, class TUPLE>
+struct BinaryTupleSerializer
+{
+	using E = typename std::tuple_element<I - 1, TUPLE>::type;
+
+	static void signature(std::string& sig)
+	{
+		BinaryTupleSerializer<I - 1, TUPLE>::signature(sig);
+		if (I > 1) sig += ',';
+		BinarySerializer<E>::signature(sig);
+	}
+	static void write(BinaryWriter& out, TUPLE const& value)
+	{
+		BinaryTupleSerializer<I - 1, TUPLE>::write(out, value);
+		BinarySerializer<E>::write(out, std::get<I - 1>(value));
+	}
+	static bool read(BinaryReader& in, TUPLE& value)
+	{
+		return BinaryTupleSerializer<I - 1, TUPLE>::read(in, value) && BinarySerializer<E>::read(in, std::get<I - 1>(value));
+	}
+};
+template <class TUPLE>
+struct BinaryTupleSerializer<0, TUPLE>
+{
+	static void signature(std::string&){}
+	static void write(BinaryWriter&, TUPLE const&){}
+	static bool read(BinaryReader&, TUPLE&){ return true; }
+};
+
+template <class... Ts>
+struct BinaryAllExist : std::true_type{};
+template <class T, class... Ts>
+struct BinaryAllExist<T, Ts...> : std::integral_constant<bool, BinarySerializer<T>::exist && BinaryAllExist<Ts...>::value>{};
+
+template <class... Ts>
+struct BinarySerializer<std::tuple<Ts...>>
+{
+	static const bool exist = BinaryAllExist<Ts...>::value;
+	static const bool bulk = false;
+
+	static void signature(std::string& sig)
+	{
+		sig += '(';
+		BinaryTupleSerializer<sizeof...(Ts), std::tuple<Ts...>>::signature(sig);
+		sig += ')';
+	}
+	static void write(BinaryWriter& out, std::tuple<Ts...> const& value){ BinaryTupleSerializer<sizeof...(Ts), std::tuple<Ts...>>::write(out, value); }
+	static bool read(BinaryReader& in, std::tuple<Ts...>& value){ return BinaryTupleSerializer<sizeof...(Ts), std::tuple<Ts...>>::read(in, value); }
+};
+
+
+// コンテナの要素の読み込み先と追加方法
+template <class C, class T = typename container_traits<C>::value_type>
+struct BinaryElementReader
+{
+	static bool read(BinaryReader& in, C& dest)
+	{
+		T tmp;
+		if (!BinarySerializer<T>::read(in, tmp)) return false;
+		container_traits<C>::add_element(dest, std::move(tmp));
+		return true;
+	}
+};
+// map の要素 (キーは const のため書き換え可能な pair に読み込む)
+template <class C, class K, class V>
+struct BinaryElementReader<C, std::pair<K const, V>>
+{
+	static bool read(BinaryReader& in, C& dest)
+	{
+		std::pair<K, V> tmp;
+		if (!BinarySerializer<std::pair<K const, V>>::read(in, tmp)) return false;
+		container_traits<C>::add_element(dest, std::move(tmp));
+		return true;
+	}
+};
+
+// 連続した領域に要素を格納し、resize() で要素数を変更できるコンテナ
+template <class C>
+struct is_resizable_contiguous : std::false_type{};
+template <class T, class A>
+struct is_resizable_contiguous<std::vector<T, A>> : std::integral_constant<bool, !std::is_same<T, bool>::value>{};
+template <class T>
+struct is_resizable_contiguous<MappedVector<T>> : std::true_type{};
+
+// 連続した領域に要素を格納するコンテナ (要素が算術型の場合は一括でコピーする)
+template <class C>
+struct is_contiguous_container : is_resizable_contiguous<C>{};
+template <class T, size_t N>
+struct is_contiguous_container<std::array<T, N>> : std::true_type{};
+template <class T, size_t N>
+struct is_contiguous_container<sig::array<T, N>> : std::true_type{};
+
+template <class C, class Enable = void>
+struct BinaryContainerReader
+{
+	static bool read(BinaryReader& in, C& dest, uint size)
+	{
+		dest.clear();
+		reserve_if_possible(dest, size);
+		for (uint i = 0; i < size; ++i){
+			if (!BinaryElementReader<C>::read(in, dest)) return false;
+		}
+		return true;
+	}
+
+	template <class CC>
+	static auto reserve_if_possible(CC& c, uint n) ->decltype(c.reserve(n), void()){ c.reserve(n); }
+	static void reserve_if_possible(...){}
+};
+
+// 算術型の要素を連続して格納するコンテナ
+template <class C>
+struct BinaryContainerReader<C, typename std::enable_if<is_resizable_contiguous<C>::value && BinarySerializer<typename container_traits<C>::value_type>::bulk>::type>
+{
+	using T = typename container_traits<C>::value_type;
+
+	static bool read(BinaryReader& in, C& dest, uint size)
+	{
+		if (size * sizeof(T) > in.remaining()) return false;
+		dest.clear();
+		dest.resize(size);
+		return in.read(dest.data(), size * sizeof(T));
+	}
+};
+
+// 要素数が固定のコンテナ (std::array)
+template <class T, size_t N>
+struct BinaryContainerReader<std::array<T, N>>
+{
+	static bool read(BinaryReader& in, std::array<T, N>& dest, uint size)
+	{
+		if (size != N) return false;
+		if (BinarySerializer<T>::bulk) return in.read(dest.data(), N * sizeof(T));
+		for (auto& e : dest){
+			if (!BinarySerializer<T>::read(in, e)) return false;
+		}
+		return true;
+	}
+};
+
+// 最大容量が固定のコンテナ (sig::array)
+template <class T, size_t N>
+struct BinaryContainerReader<sig::array<T, N>>
+{
+	static bool read(BinaryReader& in, sig::array<T, N>& dest, uint size)
+	{
+		if (size > N) return false;
+		dest.clear();
+		for (uint i = 0; i < size; ++i){
+			if (!BinaryElementReader<sig::array<T, N>>::read(in, dest)) return false;
+		}
+		return true;
+	}
+};
+
+// container_traits に対応したコンテナ
+template <class C>
+struct BinarySerializer<C, typename std::enable_if<container_traits<C>::exist>::type>
+{
+	using T = typename container_traits<C>::value_type;
+
+	static const bool exist = BinarySerializer<T>::exist;
+	static const bool bulk = false;
+
+	static void signature(std::string& sig)
+	{
+		sig += '[';
+		BinarySerializer<T>::signature(sig);
+		sig += ']';
+	}
+
+	static void write(BinaryWriter& out, C const& value)
+	{
+		out.put(static_cast<std::uint64_t>(value.size()));
+		write_elements(out, value, std::integral_constant<bool, BinarySerializer<T>::bulk && is_contiguous_container<C>::value>());
+	}
+
+	static bool read(BinaryReader& in, C& value)
+	{
+		uint size;
+		return in.get_size(size) && BinaryContainerReader<C>::read(in, value, size);
+	}
+
+private:
+	static void write_elements(BinaryWriter& out, C const& value, std::true_type)
+	{
+		out.write(value.data(), value.size() * sizeof(T));
+	}
+	static void write_elements(BinaryWriter& out, C const& value, std::false_type)
+	{
+		for (auto const& e : value) BinarySerializer<T>::write(out, e);
+	}
+};
+
+}	// impl
+
+
+/// 値・コンテナをバイナリ形式で保存する
+/**
+	算術型, 列挙型, 文字列, std::pair, std::tuple, および \ref sig_container に対応し、それらを入れ子にした型も保存できる．\n
+	算術型の要素を連続して格納するコンテナ（std::vector, std::array, sig::array, MappedVector）は要素をまとめてコピーする．\n
+	ファイルには型の記述が格納され、読み込み時に型が一致しない場合は失敗する（std::vector, std::deque, std::list 等のコンテナの種類は区別しない）．\n
+	一時ファイルに書き込んでから置き換えるため、保存中に中断されても以前の内容が壊れることはない．\n
+	その他の型は impl::BinarySerializer を特殊化することで保存できるようになる．
+
+	\param src 保存する値
+	\param file_pass 保存先のパス（ファイル名含む）
+	\param version [option] データのバージョン（読み込み時に一致を確認する）
+
+	\return 保存の成否
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("checkpoint.bin");
+
+	std::unordered_map<std::string, std::vector<double>> features;
+	std::set<std::tuple<int, int>> edges;
+	...
+
+	save_binary(std::make_tuple(features, edges), fpass);
+
+	auto loaded = load_binary<std::tuple<decltype(features), decltype(edges)>>(fpass);
+	\endcode
+*/
+template <class T>
+bool save_binary(
+	T const& src,
+	FilepassString const& file_pass,
+	std::uint32_t version = 0)
+{
+	static_assert(impl::BinarySerializer<T>::exist, "this type is not supported by save_binary");
+
+	std::string signature;
+	impl::BinarySerializer<T>::signature(signature);
+
+	impl::BinaryHeader header;
+	std::memcpy(header.magic, impl::binary_magic, sizeof(header.magic));
+	header.byte_order = impl::binary_byte_order;
+	header.version = impl::binary_version;
+	header.user_version = version;
+	header.signature_size = static_cast<std::uint32_t>(signature.size());
+
+	const auto tmp_pass = file_pass + impl::unique_tmp_suffix();
+	{
+		std::ofstream ofs(tmp_pass, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!ofs) return false;
+
+		impl::BinaryWriter out(ofs);
+		out.put(header);
+		out.write(signature.data(), signature.size());
+		impl::BinarySerializer<T>::write(out, src);
+		out.flush();
+
+		if (!ofs.flush()){
+			ofs.close();
+			impl::remove_file(tmp_pass);
+			return false;
+		}
+	}
+	return impl::replace_file(tmp_pass, file_pass);
+}
+
+/// save_binary で保存した値を読み込む
+/**
+	\param dest 読み込み先（コンテナの場合は元の要素は破棄される）
+	\param file_pass 読み込むファイルのパス
+	\param version [option] データのバージョン（保存時に指定した値と異なる場合は失敗する）
+
+	\return 読み込みの成否（ファイル・型・バージョンが異なる、またはデータが壊れている場合は false）
+
+	\sa save_binary
+*/
+template <class T>
+bool load_binary(
+	T& dest,
+	FilepassString const& file_pass,
+	std::uint32_t version = 0)
+{
+	static_assert(impl::BinarySerializer<T>::exist, "this type is not supported by load_binary");
+
+	MappedFile file(file_pass);
+	if (!file) return false;
+
+	impl::BinaryReader in(file.begin(), file.end());
+	impl::BinaryHeader header;
+	if (!in.get(header)) return false;
+	if (std::memcmp(header.magic, impl::binary_magic, sizeof(header.magic)) != 0 || header.byte_order != impl::binary_byte_order || header.version != impl::binary_version) return false;
+	if (header.user_version != version) return false;
+
+	std::string signature;
+	impl::BinarySerializer<T>::signature(signature);
+
+	// 長さを確かめてから領域を確保する (壊れたヘッダの値で巨大な領域を確保しない)
+	if (header.signature_size != signature.size() || header.signature_size > in.remaining()) return false;
+
+	std::string stored(header.signature_size, '\0');
+	if (!in.read(&stored[0], stored.size()) || stored != signature) return false;
+
+	return impl::BinarySerializer<T>::read(in, dest) && in.remaining() == 0;
+}
+
+/// save_binary で保存した値を読み込む
+/**
+	\tparam T 保存時の型
+
+	\param file_pass 読み込むファイルのパス
+	\param version [option] データのバージョン
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\sa save_binary
+*/
+template <class T>
+auto load_binary(
+	FilepassString const& file_pass,
+	std::uint32_t version = 0)
+	->Maybe<T>
+{
+	T tmp;
+	return load_binary(tmp, file_pass, version) ? Just<T>(std::move(tmp)) : Nothing(std::move(tmp));
+}
+
+}
+#endif
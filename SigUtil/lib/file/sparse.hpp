@@ -0,0 +1,417 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_SPARSE_HPP
+#define SIG_UTIL_SPARSE_HPP
+
+#include "load.hpp"
+
+#include <vector>
+#include <limits>
+#include <iterator>
+
+
+/// \file sparse.hpp 疎な数値データ (libsvm形式) の読み込みと圧縮行形式 (CSR) による保持
+
+namespace sig
+{
+
+/// SparseMatrix の1行分の非ゼロ要素への参照
+template <class T, class I>
+class SparseRow
+{
+	I const* index_;
+	T const* value_;
+	uint size_;
+
+public:
+	using value_type = std::pair<I, T>;
+
+	/// (列番号, 値) の組を返すイテレータ
+	class const_iterator
+	{
+		I const* index_;
+		T const* value_;
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = std::pair<I, T>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		const_iterator() : index_(nullptr), value_(nullptr){}
+		const_iterator(I const* index, T const* value) : index_(index), value_(value){}
+
+		value_type operator*() const{ return value_type(*index_, *value_); }
+
+		const_iterator& operator++(){ ++index_; ++value_; return *this; }
+		const_iterator operator++(int){ auto tmp = *this; ++*this; return tmp; }
+
+		bool operator==(const_iterator const& other) const{ return index_ == other.index_; }
+		bool operator!=(const_iterator const& other) const{ return index_ != other.index_; }
+	};
+	using iterator = const_iterator;
+
+	SparseRow() : index_(nullptr), value_(nullptr), size_(0){}
+	SparseRow(I const* index, T const* value, uint size) : index_(index), value_(value), size_(size){}
+
+	/// 非ゼロ要素数
+	uint size() const{ return size_; }
+
+	bool empty() const{ return size_ == 0; }
+
+	/// k番目の非ゼロ要素の列番号
+	I index(uint k) const{ return index_[k]; }
+
+	/// k番目の非ゼロ要素の値
+	T value(uint k) const{ return value_[k]; }
+
+	/// 列番号の配列の先頭
+	I const* indices() const{ return index_; }
+
+	/// 値の配列の先頭
+	T const* values() const{ return value_; }
+
+	const_iterator begin() const{ return const_iterator(index_, value_); }
+	const_iterator end() const{ return const_iterator(index_ + size_, value_ + size_); }
+};
+
+
+/// 圧縮行形式 (CSR: Compressed Sparse Row) の疎行列
+/**
+	非ゼロ要素の値と列番号をそれぞれ1つの連続した配列に行の順番で格納し、各行の開始位置を row_ptr に保持する．\n
+	行は Row（その行の非ゼロ要素への参照）として取り出し、(列番号, 値) の組として走査できる．\n
+	load_libsvm で読み込んだ場合は各行のラベルも保持する
+
+	\tparam T 値の型
+	\tparam I 列番号の型
+
+	\code
+	SparseMatrix<double> mat;
+	mat.add_row(std::vector<std::pair<uint, double>>{ { 0, 1.5 }, { 3, -2 } });
+	mat.add_row(std::vector<std::pair<uint, double>>{});
+	mat.add_row(std::vector<std::pair<uint, double>>{ { 2, 4 } });
+
+	mat.rows();			// 3
+	mat.cols();			// 4 (列番号の最大値 + 1)
+	mat.nonzero_num();	// 3
+
+	for (auto row : mat){
+		for (auto e : row) std::cout << e.first << ":" << e.second << " ";
+		std::cout << std::endl;
+	}
+	\endcode
+*/
+template <class T = double, class I = uint>
+class SparseMatrix
+{
+public:
+	using Row = SparseRow<T, I>;
+
+	using value_type = Row;
+
+	/// 各行 (Row) を返すイテレータ
+	class const_iterator
+	{
+		SparseMatrix const* mat_;
+		uint row_;
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Row;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Row;
+
+		const_iterator() : mat_(nullptr), row_(0){}
+		const_iterator(SparseMatrix const* mat, uint row) : mat_(mat), row_(row){}
+
+		Row operator*() const{ return mat_->row(row_); }
+
+		const_iterator& operator++(){ ++row_; return *this; }
+		const_iterator operator++(int){ auto tmp = *this; ++*this; return tmp; }
+
+		bool operator==(const_iterator const& other) const{ return row_ == other.row_; }
+		bool operator!=(const_iterator const& other) const{ return row_ != other.row_; }
+	};
+	using iterator = const_iterator;
+
+private:
+	std::vector<T> values_;
+	std::vector<I> indices_;
+	std::vector<uint> row_ptr_;
+	std::vector<double> labels_;
+	uint col_num_;
+
+public:
+	SparseMatrix() : row_ptr_(1, 0), col_num_(0){}
+
+	/// 各配列から構築する
+	/**
+		\param values 非ゼロ要素の値（行の順番）
+		\param indices 非ゼロ要素の列番号（values と同じ順番）
+		\param row_ptr 各行の開始位置（要素数は行数+1. 先頭は0、末尾は非ゼロ要素数）
+		\param labels [option] 各行のラベル（空 または 要素数は行数）
+	*/
+	SparseMatrix(std::vector<T> values, std::vector<I> indices, std::vector<uint> row_ptr, std::vector<double> labels = std::vector<double>())
+		: values_(std::move(values)), indices_(std::move(indices)), row_ptr_(std::move(row_ptr)), labels_(std::move(labels)), col_num_(0)
+	{
+		if (row_ptr_.empty()) row_ptr_.push_back(0);
+		for (auto i : indices_) col_num_ = std::max(col_num_, static_cast<uint>(i) + 1);
+	}
+
+	/// 末尾に1行追加する
+	/**
+		\param row (列番号, 値) の組を格納したコンテナ（\ref sig_container ）
+	*/
+	template <class C>
+	void add_row(C const& row)
+	{
+		for (auto const& e : row){
+			indices_.push_back(static_cast<I>(e.first));
+			values_.push_back(static_cast<T>(e.second));
+			col_num_ = std::max(col_num_, static_cast<uint>(e.first) + 1);
+		}
+		row_ptr_.push_back(values_.size());
+	}
+
+	/// 末尾にラベル付きの1行を追加する
+	template <class C>
+	void add_row(C const& row, double label)
+	{
+		labels_.resize(rows(), std::numeric_limits<double>::quiet_NaN());
+		labels_.push_back(label);
+		add_row(row);
+	}
+
+	/// 行数
+	uint rows() const{ return row_ptr_.size() - 1; }
+
+	/// 列数（列番号の最大値 + 1）
+	uint cols() const{ return col_num_; }
+
+	/// 行数
+	uint size() const{ return rows(); }
+
+	bool empty() const{ return rows() == 0; }
+
+	/// 非ゼロ要素数
+	uint nonzero_num() const{ return values_.size(); }
+
+	/// i行目
+	Row row(uint i) const{ return Row(indices_.data() + row_ptr_[i], values_.data() + row_ptr_[i], row_ptr_[i + 1] - row_ptr_[i]); }
+
+	Row operator[](uint i) const{ return row(i); }
+
+	/// i行目のラベル（ラベルが無い場合は NaN）
+	double label(uint i) const{ return i < labels_.size() ? labels_[i] : std::numeric_limits<double>::quiet_NaN(); }
+
+	/// 非ゼロ要素の値（行の順番）
+	std::vector<T> const& values() const{ return values_; }
+
+	/// 非ゼロ要素の列番号（values() と同じ順番）
+	std::vector<I> const& indices() const{ return indices_; }
+
+	/// 各行の開始位置（要素数は行数+1）
+	std::vector<uint> const& row_ptr() const{ return row_ptr_; }
+
+	/// 各行のラベル（ラベルの無いデータの場合は空）
+	std::vector<double> const& labels() const{ return labels_; }
+
+	const_iterator begin() const{ return const_iterator(this, 0); }
+	const_iterator end() const{ return const_iterator(this, rows()); }
+};
+
+namespace impl
+{
+template <class T, class I>
+struct container_traits<SparseMatrix<T, I>>
+{
+	static const bool exist = true;
+
+	using value_type = typename SparseMatrix<T, I>::Row;
+
+	template <class U>
+	using rebind = std::vector<U>;
+};
+
+template <class T, class I>
+struct container_traits<SparseRow<T, I>>
+{
+	static const bool exist = true;
+
+	using value_type = std::pair<I, T>;
+
+	template <class U>
+	using rebind = std::vector<U>;
+};
+
+// libsvm形式の範囲 [first, last) を変換した結果
+template <class T, class I>
+struct SparseChunk
+{
+	std::vector<T> values;
+	std::vector<I> indices;
+	std::vector<uint> row_size;
+	std::vector<double> labels;
+	bool has_label;
+
+	SparseChunk() : has_label(false){}
+};
+
+inline bool is_sparse_space(char c){ return c == ' ' || c == '\t' || c == '\r'; }
+
+// libsvm形式の1行を変換する. 空行・コメント行の場合は false
+template <class T, class I>
+bool parse_libsvm_line(char const* first, char const* last, SparseChunk<T, I>& dest)
+{
+	auto comment = static_cast<char const*>(std::memchr(first, '#', last - first));
+	if (comment) last = comment;
+
+	const uint nnz = dest.values.size();
+	double label = std::numeric_limits<double>::quiet_NaN();
+	bool head = true;
+	bool any = false;
+
+	for (char const* p = first;;){
+		while (p != last && is_sparse_space(*p)) ++p;
+		if (p == last) break;
+
+		char const* token = p;
+		while (p != last && !is_sparse_space(*p)) ++p;
+		any = true;
+
+		auto colon = static_cast<char const*>(std::memchr(token, ':', p - token));
+		if (!colon){
+			if (!head) throw std::invalid_argument("sig::load_libsvm");
+			label = parse_num<double>(token, p);
+			dest.has_label = true;
+		}
+		else if (!(colon - token == 3 && std::memcmp(token, "qid", 3) == 0)){
+			const I index = parse_num<I>(token, colon);
+			dest.indices.push_back(index);
+			dest.values.push_back(parse_num<T>(colon + 1, p));
+		}
+		head = false;
+	}
+	if (!any) return false;
+
+	dest.row_size.push_back(dest.values.size() - nnz);
+	dest.labels.push_back(label);
+	return true;
+}
+}	// impl
+
+
+/// libsvm形式 (疎な index:value 形式) の数値データを圧縮行形式 (CSR) で読み込む
+/**
+	各行は "[ラベル] 列番号:値 列番号:値 ..." の形式で、ラベルは省略可能．'#' 以降はコメントとして無視し、空行は読み飛ばす（"qid:" の項目も無視する）．\n
+	列番号はファイル中の値のまま格納される（libsvm形式では通常1始まり）．\n
+	ファイルはメモリマップで読み込まれ、行単位で分割して複数のスレッドで並列に変換される．変換結果はファイル中の行の順番通りに格納される．
+
+	\tparam T [option] 値の型
+	\tparam I [option] 列番号の型
+
+	\param dest 保存先（元の内容は読み込んだ内容で置き換えられる）
+	\param file_pass 読み込むファイルのパス
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込みの成否
+
+	\exception std::invalid_argument（数値に変換できない場合）, std::out_of_range（変換後の値が型で表現できない場合）
+
+	\code
+	// train.txt
+	+1 1:0.5 3:1.2
+	-1 2:0.8 # comment
+	+1 1:1 4:-0.3
+
+	SparseMatrix<float> data;
+	load_libsvm(data, fpass);
+
+	data.rows();		// 3
+	data.label(1);		// -1
+	data[2].index(1);	// 4
+	data[2].value(1);	// -0.3f
+	\endcode
+*/
+template <class T, class I>
+bool load_libsvm(
+	SparseMatrix<T, I>& dest,
+	FilepassString const& file_pass,
+	uint thread_num = 0)
+{
+	MappedFile file(file_pass);
+
+	if (!file) return false;
+
+	auto parsed = impl::parallel_parse_chunks<impl::SparseChunk<T, I>>(file, thread_num, [](char const* cfirst, char const* clast){
+		impl::SparseChunk<T, I> part;
+		impl::for_each_line(cfirst, clast, [&](char const* first, char const* last){
+			impl::parse_libsvm_line(first, last, part);
+		});
+		return part;
+	});
+
+	uint nnz = 0, rows = 0;
+	bool has_label = false;
+	for (auto const& part : parsed){
+		nnz += part.values.size();
+		rows += part.row_size.size();
+		has_label = has_label || part.has_label;
+	}
+
+	std::vector<T> values;
+	std::vector<I> indices;
+	std::vector<uint> row_ptr(1, 0);
+	std::vector<double> labels;
+
+	values.reserve(nnz);
+	indices.reserve(nnz);
+	row_ptr.reserve(rows + 1);
+	if (has_label) labels.reserve(rows);
+
+	for (auto& part : parsed){
+		values.insert(values.end(), part.values.begin(), part.values.end());
+		indices.insert(indices.end(), part.indices.begin(), part.indices.end());
+		for (auto n : part.row_size) row_ptr.push_back(row_ptr.back() + n);
+		if (has_label) labels.insert(labels.end(), part.labels.begin(), part.labels.end());
+
+		std::vector<T>().swap(part.values);		// 変換済みの範囲から順に解放
+		std::vector<I>().swap(part.indices);
+	}
+
+	dest = SparseMatrix<T, I>(std::move(values), std::move(indices), std::move(row_ptr), std::move(labels));
+	return true;
+}
+
+/// libsvm形式 (疎な index:value 形式) の数値データを圧縮行形式 (CSR) で読み込み、結果を返す
+/**
+	\tparam T [option] 値の型
+	\tparam I [option] 列番号の型
+
+	\param file_pass 読み込むファイルのパス
+	\param thread_num [option] 変換に使用するスレッド数（0の場合はハードウェアの並列数）
+
+	\return 読み込み結果（値は\ref sig_maybe で返される）
+
+	\sa load_libsvm(SparseMatrix<T, I>& dest, FilepassString const& file_pass, uint thread_num)
+*/
+template <class T = double, class I = uint>
+auto load_libsvm(
+	FilepassString const& file_pass,
+	uint thread_num = 0
+	) ->Maybe<SparseMatrix<T, I>>
+{
+	SparseMatrix<T, I> tmp;
+	if (!load_libsvm(tmp, file_pass, thread_num)) return Nothing(std::move(tmp));
+	return Just<SparseMatrix<T, I>>(std::move(tmp));
+}
+
+}
+#endif
@@ -0,0 +1,241 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_TAIL_READER_HPP
+#define SIG_UTIL_TAIL_READER_HPP
+
+#include "load.hpp"
+
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+#if SIG_MSVC_ENV
+	#define NOMINMAX
+	#include <windows.h>
+#elif SIG_LINUX_ENV
+	#include <sys/stat.h>
+#endif
+
+
+/// \file tail_reader.hpp 追記されるファイルから新しい行のみを読み込むリーダー
+
+namespace sig
+{
+namespace impl
+{
+
+// ファイルの実体を識別する値 (Linux: デバイス番号とiノード番号, Windows: ボリュームのシリアル番号とファイルインデックス). 取得できない場合は {0, 0}
+struct FileIdentity
+{
+	std::uint64_t device;
+	std::uint64_t index;
+
+	bool valid() const{ return device != 0 || index != 0; }
+	bool operator==(FileIdentity const& other) const{ return device == other.device && index == other.index; }
+	bool operator!=(FileIdentity const& other) const{ return !(*this == other); }
+};
+
+inline FileIdentity get_file_identity(FilepassString const& file_pass)
+{
+	FileIdentity id = { 0, 0 };
+
+#if SIG_MSVC_ENV
+	HANDLE h = CreateFileW(file_pass.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE) return id;
+
+	BY_HANDLE_FILE_INFORMATION info;
+	if (GetFileInformationByHandle(h, &info)){
+		id.device = info.dwVolumeSerialNumber;
+		id.index = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+	}
+	CloseHandle(h);
+#elif SIG_LINUX_ENV
+	struct stat st;
+	if (::stat(file_pass.c_str(), &st) == 0){
+		id.device = static_cast<std::uint64_t>(st.st_dev);
+		id.index = static_cast<std::uint64_t>(st.st_ino);
+	}
+#endif
+	return id;
+}
+
+}	// impl
+
+
+/// 追記されていくファイルから、前回読み込んだ位置以降に追加された行のみを読み込むリーダー (tail -F 相当)
+/**
+	poll() を呼ぶ毎に、前回の読み込み位置以降に追記された「改行で終わる行」のみを返す（書き込み途中の最後の行は次回以降に読み込まれる）．\n
+	読み込み位置は save_checkpoint() でファイルに保存し、load_checkpoint() で復元できる．\n
+	ファイルが読み込み位置より短く切り詰められた場合は先頭から読み直す．\n
+	ファイルが別のファイルに置き換えられた（ローテーションされた）場合は、開いていた旧ファイルの残りの行を読み切ってから新しいファイルの先頭から読み込む．
+
+	\code
+	const auto dir = modify_dirpass_tail( SIG_TO_FPSTR("./example"), true);
+	const auto fpass = dir + SIG_TO_FPSTR("log.txt");
+	const auto cpass = dir + SIG_TO_FPSTR("log.checkpoint");
+
+	TailReader reader(fpass);
+	reader.load_checkpoint(cpass);	// 前回の続きから
+
+	while (true){
+		for (auto const& line : reader.poll()) std::cout << line << std::endl;
+		reader.save_checkpoint(cpass);
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+	}
+	\endcode
+*/
+class TailReader
+{
+	FilepassString file_pass_;
+	std::ifstream ifs_;
+	impl::FileIdentity identity_;
+	std::uint64_t offset_;
+	std::vector<char> buffer_;
+
+private:
+	void open()
+	{
+		// 識別値の取得と open の間にファイルが置き換えられた場合、識別値が開いたファイルと食い違うため、
+		// open の前後で識別値が変わらなくなるまで開き直す
+		for (int retry = 0; retry < 16; ++retry){
+			ifs_.close();
+			ifs_.clear();
+			identity_ = impl::get_file_identity(file_pass_);
+			ifs_.open(file_pass_, std::ios::in | std::ios::binary);
+
+			if (!ifs_.is_open() || impl::get_file_identity(file_pass_) == identity_) return;
+		}
+	}
+
+	// 開いているファイルの offset_ 以降を読み込み、改行で終わる行を dest に追加する. include_partial が true の場合は改行で終わらない最後の行も追加する
+	template <class C>
+	uint read_lines(C& dest, bool include_partial)
+	{
+		if (!ifs_.is_open()) return 0;
+
+		ifs_.clear();
+		ifs_.seekg(0, std::ios::end);
+		const std::uint64_t size = static_cast<std::uint64_t>(ifs_.tellg());
+
+		if (size < offset_) offset_ = 0;	// 切り詰められた
+		if (size == offset_) return 0;
+
+		buffer_.resize(static_cast<uint>(size - offset_));
+		ifs_.seekg(offset_, std::ios::beg);
+		ifs_.read(buffer_.data(), buffer_.size());
+		buffer_.resize(static_cast<uint>(ifs_.gcount()));
+
+		char const* first = buffer_.data();
+		char const* last = first + buffer_.size();
+		if (!include_partial){
+			while (last != first && *(last - 1) != '\n') --last;
+		}
+
+		uint num = 0;
+		impl::for_each_line(first, last, [&](char const* lfirst, char const* llast){
+			impl::container_traits<C>::add_element(dest, typename impl::container_traits<C>::value_type(lfirst, llast));
+			++num;
+		});
+		offset_ += last - first;
+		return num;
+	}
+
+public:
+	/// 読み込むファイルを指定して構築
+	/**
+		\param file_pass 読み込むファイルのパス（存在しなくてもよい）
+		\param offset [option] 読み込みを開始する位置（バイト数）
+	*/
+	explicit TailReader(FilepassString const& file_pass, std::uint64_t offset = 0)
+		: file_pass_(file_pass), offset_(offset)
+	{
+		open();
+	}
+
+	/// 前回の読み込み以降に追記された行を読み込む
+	/**
+		\param dest 読み込んだ行を追加するコンテナ（\ref sig_container ）. 要素型は std::string 等の (char const*, char const*) から構築可能な型
+
+		\return 追加した行数
+	*/
+	template <class C>
+	uint poll(C& dest)
+	{
+		uint num = 0;
+		const auto identity = impl::get_file_identity(file_pass_);
+
+		if (!ifs_.is_open() || (identity.valid() && identity != identity_)){
+			// ローテーション: 旧ファイルの残りを読み切ってから新しいファイルに切り替える
+			num += read_lines(dest, true);
+			offset_ = 0;
+			open();
+		}
+		return num + read_lines(dest, false);
+	}
+
+	/// 前回の読み込み以降に追記された行を読み込む
+	/**
+		\return 読み込んだ行
+	*/
+	std::vector<std::string> poll()
+	{
+		std::vector<std::string> tmp;
+		poll(tmp);
+		return tmp;
+	}
+
+	/// 読み込み済みの位置（ファイル先頭からのバイト数）
+	std::uint64_t offset() const{ return offset_; }
+
+	/// 読み込み位置をファイルに保存する
+	/**
+		一時ファイルに書き込んでから置き換えるため、保存中に中断されても以前の内容が壊れることはない
+
+		\param checkpoint_pass 保存先のパス
+
+		\return 保存の成否
+	*/
+	bool save_checkpoint(FilepassString const& checkpoint_pass) const
+	{
+		const auto tmp_pass = checkpoint_pass + impl::unique_tmp_suffix();
+		{
+			std::ofstream ofs(tmp_pass, std::ios::out | std::ios::trunc);
+			ofs << offset_ << " " << identity_.device << " " << identity_.index << "\n";
+			ofs.close();
+			if (ofs.fail()){
+				impl::remove_file(tmp_pass);
+				return false;
+			}
+		}
+		return impl::replace_file(tmp_pass, checkpoint_pass);
+	}
+
+	/// save_checkpoint で保存した読み込み位置を復元する
+	/**
+		保存後にファイルが置き換えられていた場合は新しいファイルの先頭から、切り詰められていた場合は次回の poll() で先頭から読み込む
+
+		\param checkpoint_pass 読み込み位置を保存したファイルのパス
+
+		\return 復元の成否（保存したファイルが存在しない・形式が異なる場合は false）
+	*/
+	bool load_checkpoint(FilepassString const& checkpoint_pass)
+	{
+		std::ifstream ifs(checkpoint_pass);
+		std::uint64_t offset;
+		impl::FileIdentity identity;
+
+		if (!(ifs >> offset >> identity.device >> identity.index)) return false;
+
+		open();
+		offset_ = (identity.valid() && identity_.valid() && identity != identity_) ? 0 : offset;
+		return true;
+	}
+};
+
+}
+#endif
@@ -0,0 +1,417 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_CHARCONV_HPP
+#define SIG_UTIL_CHARCONV_HPP
+
+#include "../sigutil.hpp"
+#include <system_error>
+#include <limits>
+#include <cstdlib>
+#include <cerrno>
+#include <clocale>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#if SIG_ENABLE_CHARCONV
+#include <charconv>
+#endif
+
+
+/// \file charconv.hpp ロケールに依存しない文字列 <-> 数値変換（std::from_chars, std::to_chars 相当）
+
+namespace sig
+{
+
+/// 文字列から数値への変換結果
+enum class ParseStatus
+{
+	ok,					///< 変換に成功
+	invalid_argument,	///< 数値に変換できない
+	out_of_range		///< 変換後の値が型で表現できない
+};
+
+/// 数値から文字列への変換の書式
+enum class NumFormat
+{
+	general,	///< std::ostream の既定の書式と同じ %g 相当の表記（精度は有効桁数）
+	fixed,		///< %f 相当の固定小数点表記（精度は小数点以下の桁数）
+	shortest	///< 読み込んだ際に元の値に戻る最短の表記（精度は無視される）
+};
+
+namespace impl
+{
+
+#if SIG_ENABLE_CHARCONV
+using std::from_chars_result;
+
+template <class T>
+from_chars_result from_chars_std(char const* first, char const* last, T& value, std::true_type){ return std::from_chars(first, last, value); }
+
+template <class T>
+from_chars_result from_chars_std(char const* first, char const* last, T& value, std::false_type){ return std::from_chars(first, last, value, std::chars_format::general); }
+
+/// 文字列 [first, last) を数値に変換する (std::from_chars)
+template <class T>
+from_chars_result from_chars(char const* first, char const* last, T& value)
+{
+	return from_chars_std(first, last, value, std::is_integral<T>());
+}
+
+#else
+struct from_chars_result
+{
+	char const* ptr;
+	std::errc ec;
+};
+
+// 整数型
+template <class T, typename std::enable_if<std::is_integral<T>::value>::type*& = enabler>
+from_chars_result from_chars(char const* first, char const* last, T& value)
+{
+	using U = typename std::make_unsigned<T>::type;
+
+	char const* p = first;
+	const bool minus = std::is_signed<T>::value && p != last && *p == '-';
+	if (minus) ++p;
+
+	const U limit = minus ? static_cast<U>(static_cast<U>(std::numeric_limits<T>::max()) + 1) : static_cast<U>(std::numeric_limits<T>::max());
+	U v = 0;
+	bool overflow = false;
+	char const* digit_begin = p;
+
+	for (; p != last && static_cast<unsigned>(*p - '0') < 10u; ++p){
+		const U d = static_cast<U>(*p - '0');
+		if (v > (limit - d) / 10) overflow = true;
+		else v = v * 10 + d;
+	}
+
+	if (p == digit_begin) return from_chars_result{ first, std::errc::invalid_argument };
+	if (overflow) return from_chars_result{ p, std::errc::result_out_of_range };
+
+	value = minus ? static_cast<T>(0 - v) : static_cast<T>(v);
+	return from_chars_result{ p, std::errc() };
+}
+
+template <class T> struct float_fast_path{ static const int max_pow10 = -1; static const unsigned long long max_mantissa = 0; };
+template <> struct float_fast_path<float>{ static const int max_pow10 = 10; static const unsigned long long max_mantissa = 1ULL << 24; };
+template <> struct float_fast_path<double>{ static const int max_pow10 = 22; static const unsigned long long max_mantissa = 1ULL << 53; };
+
+inline float strto_c(char const* s, char** end, float){ return std::strtof(s, end); }
+inline double strto_c(char const* s, char** end, double){ return std::strtod(s, end); }
+inline long double strto_c(char const* s, char** end, long double){ return std::strtold(s, end); }
+
+// 書式確認済みの数値文字列を厳密に変換する（高速に計算できない場合に使用）
+template <class T>
+bool exact_float_conv(char const* first, char const* last, T& value)
+{
+	const std::string token(first, last);
+
+	if (*std::localeconv()->decimal_point == '.'){
+		char* end = nullptr;
+		errno = 0;
+		const T v = strto_c(token.c_str(), &end, T());
+		if (errno == ERANGE && (v > 1 || v < -1 || v == 0)) return false;	// オーバーフロー, 0へのアンダーフロー (非正規化数は std::from_chars と同様に受け付ける)
+		value = v;
+		return true;
+	}
+	else{
+		std::istringstream iss(token);
+		iss.imbue(std::locale::classic());
+		T v;
+		iss >> v;
+		if (iss.fail()) return false;
+		value = v;
+		return true;
+	}
+}
+
+inline bool match_nocase(char const* p, char const* last, char const* word)
+{
+	for (; *word; ++p, ++word){
+		if (p == last || (*p | 0x20) != *word) return false;
+	}
+	return true;
+}
+
+// 浮動小数点型
+template <class T, typename std::enable_if<std::is_floating_point<T>::value>::type*& = enabler>
+from_chars_result from_chars(char const* first, char const* last, T& value)
+{
+	char const* p = first;
+	const bool minus = p != last && *p == '-';
+	if (minus) ++p;
+
+	// inf, infinity, nan
+	if (p != last && ((*p | 0x20) == 'i' || (*p | 0x20) == 'n')){
+		if (match_nocase(p, last, "infinity")){
+			value = minus ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+			return from_chars_result{ p + 8, std::errc() };
+		}
+		if (match_nocase(p, last, "inf")){
+			value = minus ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+			return from_chars_result{ p + 3, std::errc() };
+		}
+		if (match_nocase(p, last, "nan")){
+			value = minus ? -std::numeric_limits<T>::quiet_NaN() : std::numeric_limits<T>::quiet_NaN();
+			return from_chars_result{ p + 3, std::errc() };
+		}
+		return from_chars_result{ first, std::errc::invalid_argument };
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;			// mantissa に取り込んだ有効桁数
+	int exp10 = 0;
+	bool truncated = false;
+	bool any_digit = false;
+
+	for (; p != last && static_cast<unsigned>(*p - '0') < 10u; ++p){
+		any_digit = true;
+		if (digits < 19){
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa) ++digits;
+		}
+		else{
+			++exp10;
+			if (*p != '0') truncated = true;
+		}
+	}
+	if (p != last && *p == '.'){
+		char const* frac = ++p;
+		for (; p != last && static_cast<unsigned>(*p - '0') < 10u; ++p){
+			if (digits < 19){
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) ++digits;
+				--exp10;
+			}
+			else if (*p != '0') truncated = true;
+		}
+		any_digit = any_digit || p != frac;
+	}
+	if (!any_digit) return from_chars_result{ first, std::errc::invalid_argument };
+
+	if (p != last && (*p == 'e' || *p == 'E')){
+		char const* e = p + 1;
+		const bool eminus = e != last && *e == '-';
+		if (e != last && (*e == '-' || *e == '+')) ++e;
+
+		if (e != last && static_cast<unsigned>(*e - '0') < 10u){
+			int ev = 0;
+			for (; e != last && static_cast<unsigned>(*e - '0') < 10u; ++e){
+				if (ev < 100000) ev = ev * 10 + (*e - '0');
+			}
+			exp10 += eminus ? -ev : ev;
+			p = e;
+		}
+	}
+
+	// 仮数と10の冪乗がどちらも誤差なく表現できる場合は直接計算 (Clinger's fast path)
+	const int max_pow10 = float_fast_path<T>::max_pow10;
+	if (!truncated && mantissa <= float_fast_path<T>::max_mantissa && exp10 >= -max_pow10 && exp10 <= max_pow10){
+		static const T pow10[] = { T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7), T(1e8), T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14), T(1e15), T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22) };
+		T v = static_cast<T>(mantissa);
+		v = exp10 < 0 ? v / pow10[-exp10] : v * pow10[exp10];
+		value = minus ? -v : v;
+		return from_chars_result{ p, std::errc() };
+	}
+	if (mantissa == 0 && !truncated){
+		value = minus ? -T(0) : T(0);
+		return from_chars_result{ p, std::errc() };
+	}
+
+	if (!exact_float_conv(first, p, value)) return from_chars_result{ p, std::errc::result_out_of_range };
+	return from_chars_result{ p, std::errc() };
+}
+#endif
+
+
+/// 文字列 [first, last) を数値型Tに変換し、変換結果を返す（例外は投げない）
+/**
+	std::stoi, std::stod 等と同じく先頭の空白と'+'を許容し、数値以降の文字は無視する．\n
+	ロケールに依存せず、文字列の一時オブジェクトも作成しない．変換に失敗した場合 value は変更されない
+*/
+template <class T>
+ParseStatus try_parse_num(char const* first, char const* last, T& value)
+{
+	while (first != last && (*first == ' ' || (*first >= '\t' && *first <= '\r'))) ++first;
+	if (first != last && *first == '+' && first + 1 != last && *(first + 1) != '-') ++first;
+
+	auto r = from_chars(first, last, value);
+
+	if (r.ec == std::errc::invalid_argument) return ParseStatus::invalid_argument;
+	if (r.ec == std::errc::result_out_of_range) return ParseStatus::out_of_range;
+	return ParseStatus::ok;
+}
+
+/// 文字列 [first, last) を数値型Tに変換する（変換規則は try_parse_num と同じ）
+/**
+	\exception std::invalid_argument（数値に変換できない場合）, std::out_of_range（変換後の値が型Tで表現できない場合）
+*/
+template <class T>
+T parse_num(char const* first, char const* last)
+{
+	T value;
+	const auto status = try_parse_num(first, last, value);
+
+	if (status == ParseStatus::invalid_argument) throw std::invalid_argument("sig::impl::parse_num");
+	if (status == ParseStatus::out_of_range) throw std::out_of_range("sig::impl::parse_num");
+	return value;
+}
+
+
+// 文字として出力される型 (bool, 文字型) を除いた整数型
+template <class T>
+struct is_plain_integer : std::integral_constant<bool,
+	std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value && !std::is_same<T, signed char>::value
+	&& !std::is_same<T, unsigned char>::value && !std::is_same<T, wchar_t>::value && !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value
+>{};
+
+template <class T>
+bool is_negative(T value, std::true_type){ return value < 0; }
+template <class T>
+bool is_negative(T, std::false_type){ return false; }
+
+#if SIG_ENABLE_CHARCONV
+inline std::to_chars_result to_chars_format(char* first, char* last, double value, NumFormat format, int precision)
+{
+	if (format == NumFormat::shortest) return std::to_chars(first, last, value);
+	return std::to_chars(first, last, value, format == NumFormat::fixed ? std::chars_format::fixed : std::chars_format::general, precision);
+}
+inline std::to_chars_result to_chars_format(char* first, char* last, long double value, NumFormat format, int precision)
+{
+	if (format == NumFormat::shortest) return std::to_chars(first, last, value);
+	return std::to_chars(first, last, value, format == NumFormat::fixed ? std::chars_format::fixed : std::chars_format::general, precision);
+}
+inline std::to_chars_result to_chars_format(char* first, char* last, float value, NumFormat format, int precision)
+{
+	if (format == NumFormat::shortest) return std::to_chars(first, last, value);
+	return std::to_chars(first, last, value, format == NumFormat::fixed ? std::chars_format::fixed : std::chars_format::general, precision);
+}
+
+#else
+inline int format_float_c(char* buf, uint size, char spec, int precision, double value)
+{
+	return std::snprintf(buf, size, spec == 'f' ? "%.*f" : "%.*g", precision, value);
+}
+inline int format_float_c(char* buf, uint size, char spec, int precision, long double value)
+{
+	return std::snprintf(buf, size, spec == 'f' ? "%.*Lf" : "%.*Lg", precision, value);
+}
+
+// snprintf の %g または %f で変換し、dest の末尾に追加する（小数点はロケールによらず '.'）
+template <class T>
+void append_float_c(std::string& dest, T value, char spec, int precision)
+{
+	using F = typename std::conditional<std::is_same<T, long double>::value, long double, double>::type;
+
+	char buf[128];
+	const int n = format_float_c(buf, sizeof(buf), spec, precision, static_cast<F>(value));
+	if (n < 0) return;
+
+	const uint base = dest.size();
+	if (n < static_cast<int>(sizeof(buf))){
+		dest.append(buf, n);
+	}
+	else{
+		dest.resize(base + n + 1);
+		format_float_c(&dest[base], n + 1, spec, precision, static_cast<F>(value));
+		dest.resize(base + n);
+	}
+
+	char const* point = std::localeconv()->decimal_point;
+	if (std::strcmp(point, ".") != 0){
+		const auto pos = dest.find(point, base);
+		if (pos != std::string::npos) dest.replace(pos, std::strlen(point), ".");
+	}
+}
+#endif
+
+
+/// 数値を std::ostream の既定の書式（浮動小数点数は精度6の %g 相当）の文字列に変換し、dest の末尾に追加する
+/**
+	ロケールに依存せず、std::ostringstream 等の一時オブジェクトを作成しない．\n
+	出力内容は std::locale::classic() の std::ostringstream に出力した場合と同じになる
+*/
+template <class T, typename std::enable_if<is_plain_integer<T>::value>::type*& = enabler>
+void append_num(std::string& dest, T value)
+{
+	using U = typename std::make_unsigned<T>::type;
+
+	char buf[24];
+	char* p = buf + sizeof(buf);
+	const bool minus = is_negative(value, std::is_signed<T>());
+	U v = minus ? static_cast<U>(0 - static_cast<U>(value)) : static_cast<U>(value);
+
+	do{
+		*--p = static_cast<char>('0' + v % 10);
+		v /= 10;
+	} while (v);
+	if (minus) *--p = '-';
+
+	dest.append(p, buf + sizeof(buf));
+}
+
+/// 浮動小数点数を書式 format で文字列に変換し、dest の末尾に追加する（ロケールに依存しない）
+/**
+	\param format 書式
+	\param precision 精度（general: 有効桁数, fixed: 小数点以下の桁数, shortest: 無視される）
+*/
+template <class T, typename std::enable_if<std::is_floating_point<T>::value>::type*& = enabler>
+void append_num(std::string& dest, T value, NumFormat format = NumFormat::general, int precision = 6)
+{
+#if SIG_ENABLE_CHARCONV
+	char buf[128];
+	auto r = to_chars_format(buf, buf + sizeof(buf), value, format, precision);
+	if (r.ec == std::errc()){
+		dest.append(buf, r.ptr);
+		return;
+	}
+
+	// 固定小数点表記で桁数が多い場合
+	const uint base = dest.size();
+	dest.resize(base + std::numeric_limits<T>::max_exponent10 + std::max(precision, 0) + 8);
+	r = to_chars_format(&dest[base], &dest[0] + dest.size(), value, format, precision);
+	dest.resize(r.ec == std::errc() ? r.ptr - dest.data() : base);
+#else
+	if (format != NumFormat::shortest){
+		append_float_c(dest, value, format == NumFormat::fixed ? 'f' : 'g', precision);
+		return;
+	}
+
+	// 元の値に戻る最小の有効桁数を探す
+	const uint base = dest.size();
+	for (int digits = std::numeric_limits<T>::digits10; ; ++digits){
+		append_float_c(dest, value, 'g', digits);
+		if (digits >= std::numeric_limits<T>::max_digits10) break;
+
+		T parsed;
+		if (from_chars(dest.data() + base, dest.data() + dest.size(), parsed).ec == std::errc() && parsed == value) break;
+		dest.resize(base);
+	}
+#endif
+}
+
+/// 整数型は書式の指定を無視する
+template <class T, typename std::enable_if<is_plain_integer<T>::value>::type*& = enabler>
+void append_num(std::string& dest, T value, NumFormat, int)
+{
+	append_num(dest, value);
+}
+
+template <class T, typename std::enable_if<!is_plain_integer<T>::value && !std::is_floating_point<T>::value>::type*& = enabler>
+void append_num(std::string& dest, T const& value, NumFormat = NumFormat::general, int = 6)
+{
+	std::ostringstream oss;
+	oss.imbue(std::locale::classic());
+	oss << value;
+	dest += oss.str();
+}
+
+}	// impl
+}	// sig
+#endif
@@ -127,6 +127,22 @@ void increment_iterator(It&& iter, Its&&... iterators)
 }
 
 
+// reserve を持つコンテナ (vector, unordered_set 等) であれば n 要素の追加分の容量を確保する
+template <class C>
+auto reserve_additional(C& c, uint n, int) ->decltype(c.reserve(n), void())
+{
+	c.reserve(c.size() + n);
+}
+template <class C>
+void reserve_additional(C&, uint, long){}
+
+template <class C>
+void reserve_additional(C& c, uint n)
+{
+	reserve_additional(c, n, 0);
+}
+
+
 // コンテナの型に対応した要素型を得る
 // ex: vector<T> const& -> T const&,	list<T>&& -> T&&
 template <class C, typename std::enable_if<container_traits<typename remove_const_reference<C>::type>::exist>::type*& = enabler>
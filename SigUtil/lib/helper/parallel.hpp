@@ -0,0 +1,77 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_PARALLEL_HPP
+#define SIG_UTIL_PARALLEL_HPP
+
+#include "../sigutil.hpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <system_error>
+
+
+/// \file parallel.hpp 並列処理の補助モジュール
+
+namespace sig
+{
+namespace impl
+{
+
+// 使用するスレッド数 (0 が指定された場合はハードウェアの並列数)
+inline uint resolve_thread_num(uint thread_num)
+{
+	if (thread_num) return thread_num;
+	const uint hw = std::thread::hardware_concurrency();
+	return hw ? hw : 1;
+}
+
+// 0 ～ task_num-1 の各タスクに関数を適用し、結果をタスク番号順に格納して返す
+// タスクは最大 thread_num 個のスレッド（呼び出し元のスレッドを含む）で分担して処理される
+// タスク内で例外が送出された場合、全スレッドの終了後にタスク番号が最も小さいものを再送出する
+template <class R, class F>
+std::vector<R> parallel_generate(uint task_num, uint thread_num, F const& func)
+{
+	std::vector<R> result(task_num);
+	std::vector<std::exception_ptr> errors(task_num);
+	std::atomic<uint> next(0);
+
+	auto worker = [&](){
+		for (uint i = next++; i < task_num; i = next++){
+			try{
+				result[i] = func(i);
+			}
+			catch (...){
+				errors[i] = std::current_exception();
+			}
+		}
+	};
+
+	const uint n = std::min(resolve_thread_num(thread_num), task_num);
+	std::vector<std::thread> threads;
+
+	for (uint t = 1; t < n; ++t){
+		try{
+			threads.emplace_back(worker);
+		}
+		catch (std::system_error const&){
+			break;	// スレッドを作成できない場合は作成済みのスレッドだけで処理する
+		}
+	}
+	worker();
+	for (auto& th : threads) th.join();
+
+	for (auto const& e : errors){
+		if (e) std::rethrow_exception(e);
+	}
+	return result;
+}
+
+}	// impl
+}	// sig
+#endif
@@ -0,0 +1,178 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_STRING_VIEW_HPP
+#define SIG_UTIL_STRING_VIEW_HPP
+
+#include "../sigutil.hpp"
+#include <stdexcept>
+
+#if SIG_ENABLE_STD_STRING_VIEW
+#include <string_view>
+#endif
+
+
+/// \file string_view.hpp 文字列の参照型（所有権を持たない文字列）
+
+namespace sig
+{
+
+#if SIG_ENABLE_STD_STRING_VIEW
+	template <class CHAR, class TRAITS = std::char_traits<CHAR>>
+	using basic_string_view = std::basic_string_view<CHAR, TRAITS>;
+
+#else
+
+/// 文字列の参照型 (C++17 の std::basic_string_view が使えない環境向けの最小限の代替)
+/**
+	参照先の文字列の寿命は利用者が管理する．\n
+	std::basic_string への変換は std::basic_string<CHAR>(view.data(), view.size()) で行う（std::basic_string_view と共通の記述）
+
+	\code
+	std::string str = "one,two";
+	string_view sv(str);
+
+	auto head = sv.substr(0, sv.find(','));		// "one"
+	assert(std::string(head.data(), head.size()) == "one");
+	\endcode
+*/
+template <class CHAR, class TRAITS = std::char_traits<CHAR>>
+class basic_string_view
+{
+public:
+	using traits_type = TRAITS;
+	using value_type = CHAR;
+	using pointer = CHAR const*;
+	using const_pointer = CHAR const*;
+	using reference = CHAR const&;
+	using const_reference = CHAR const&;
+	using const_iterator = CHAR const*;
+	using iterator = const_iterator;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	static const size_type npos = static_cast<size_type>(-1);
+
+private:
+	CHAR const* data_;
+	size_type size_;
+
+public:
+	basic_string_view() : data_(nullptr), size_(0){}
+	basic_string_view(CHAR const* str, size_type len) : data_(str), size_(len){}
+	basic_string_view(CHAR const* str) : data_(str), size_(TRAITS::length(str)){}
+
+	template <class A>
+	basic_string_view(std::basic_string<CHAR, TRAITS, A> const& str) : data_(str.data()), size_(str.size()){}
+
+	const_iterator begin() const{ return data_; }
+	const_iterator end() const{ return data_ + size_; }
+	const_iterator cbegin() const{ return data_; }
+	const_iterator cend() const{ return data_ + size_; }
+
+	size_type size() const{ return size_; }
+	size_type length() const{ return size_; }
+	bool empty() const{ return size_ == 0; }
+
+	const_reference operator[](size_type pos) const{ return data_[pos]; }
+	const_reference front() const{ return data_[0]; }
+	const_reference back() const{ return data_[size_ - 1]; }
+	const_pointer data() const{ return data_; }
+
+	void remove_prefix(size_type n){ data_ += n; size_ -= n; }
+	void remove_suffix(size_type n){ size_ -= n; }
+
+	basic_string_view substr(size_type pos = 0, size_type n = npos) const
+	{
+		if (pos > size_) throw std::out_of_range("sig::basic_string_view::substr");
+		return basic_string_view(data_ + pos, std::min(n, size_ - pos));
+	}
+
+	int compare(basic_string_view s) const
+	{
+		const int r = TRAITS::compare(data_, s.data_, std::min(size_, s.size_));
+		return r != 0 ? r : size_ == s.size_ ? 0 : size_ < s.size_ ? -1 : 1;
+	}
+
+	size_type find(CHAR c, size_type pos = 0) const
+	{
+		if (pos >= size_) return npos;
+		auto p = TRAITS::find(data_ + pos, size_ - pos, c);
+		return p ? static_cast<size_type>(p - data_) : npos;
+	}
+
+	size_type find(basic_string_view s, size_type pos = 0) const
+	{
+		if (s.size_ == 0) return pos <= size_ ? pos : npos;
+
+		for (; pos + s.size_ <= size_; ++pos){
+			pos = find(s[0], pos);
+			if (pos == npos || pos + s.size_ > size_) return npos;
+			if (TRAITS::compare(data_ + pos, s.data_, s.size_) == 0) return pos;
+		}
+		return npos;
+	}
+};
+
+template <class CHAR, class TRAITS>
+bool operator==(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return lhs.size() == rhs.size() && lhs.compare(rhs) == 0; }
+template <class CHAR, class TRAITS>
+bool operator!=(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return !(lhs == rhs); }
+template <class CHAR, class TRAITS>
+bool operator<(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return lhs.compare(rhs) < 0; }
+template <class CHAR, class TRAITS>
+bool operator>(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return lhs.compare(rhs) > 0; }
+template <class CHAR, class TRAITS>
+bool operator<=(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return lhs.compare(rhs) <= 0; }
+template <class CHAR, class TRAITS>
+bool operator>=(basic_string_view<CHAR, TRAITS> lhs, basic_string_view<CHAR, TRAITS> rhs){ return lhs.compare(rhs) >= 0; }
+
+// 文字列リテラルやstd::basic_stringとの比較
+template <class CHAR, class TRAITS, class S>
+auto operator==(basic_string_view<CHAR, TRAITS> lhs, S const& rhs) ->decltype(basic_string_view<CHAR, TRAITS>(rhs), bool()){ return lhs == basic_string_view<CHAR, TRAITS>(rhs); }
+template <class CHAR, class TRAITS, class S>
+auto operator==(S const& lhs, basic_string_view<CHAR, TRAITS> rhs) ->decltype(basic_string_view<CHAR, TRAITS>(lhs), bool()){ return basic_string_view<CHAR, TRAITS>(lhs) == rhs; }
+template <class CHAR, class TRAITS, class S>
+auto operator!=(basic_string_view<CHAR, TRAITS> lhs, S const& rhs) ->decltype(basic_string_view<CHAR, TRAITS>(rhs), bool()){ return !(lhs == rhs); }
+template <class CHAR, class TRAITS, class S>
+auto operator!=(S const& lhs, basic_string_view<CHAR, TRAITS> rhs) ->decltype(basic_string_view<CHAR, TRAITS>(lhs), bool()){ return !(lhs == rhs); }
+
+template <class CHAR, class TRAITS>
+std::basic_ostream<CHAR, TRAITS>& operator<<(std::basic_ostream<CHAR, TRAITS>& os, basic_string_view<CHAR, TRAITS> sv)
+{
+	return os.write(sv.data(), sv.size());
+}
+
+#endif
+
+using string_view = basic_string_view<char>;
+using wstring_view = basic_string_view<wchar_t>;
+
+}	// sig
+
+
+#if !SIG_ENABLE_STD_STRING_VIEW
+namespace std
+{
+template <class CHAR, class TRAITS>
+struct hash<sig::basic_string_view<CHAR, TRAITS>>
+{
+	size_t operator()(sig::basic_string_view<CHAR, TRAITS> sv) const
+	{
+		// FNV-1a
+		size_t h = static_cast<size_t>(14695981039346656037ULL);
+		for (auto c : sv){
+			h ^= static_cast<size_t>(c);
+			h *= static_cast<size_t>(1099511628211ULL);
+		}
+		return h;
+	}
+};
+}
+#endif
+
+#endif
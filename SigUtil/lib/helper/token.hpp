@@ -0,0 +1,84 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_TOKEN_HPP
+#define SIG_UTIL_TOKEN_HPP
+
+#include "../sigutil.hpp"
+#include <algorithm>
+#include <string>
+#include <cstring>
+#include <cwchar>
+
+
+/// \file token.hpp 区切り文字列による文字列の走査（split や数値ファイルの読み込みで共通に使用）
+
+namespace sig
+{
+namespace impl
+{
+
+// [first, last) から最初に現れる文字 c を探す (char, wchar_t は標準ライブラリの memchr, wmemchr で一括して探索)
+inline char const* find_char(char const* first, char const* last, char c)
+{
+	auto p = static_cast<char const*>(std::memchr(first, c, last - first));
+	return p ? p : last;
+}
+
+inline wchar_t const* find_char(wchar_t const* first, wchar_t const* last, wchar_t c)
+{
+	auto p = std::wmemchr(first, c, last - first);
+	return p ? p : last;
+}
+
+template <class CHAR>
+CHAR const* find_char(CHAR const* first, CHAR const* last, CHAR c)
+{
+	return std::find(first, last, c);
+}
+
+// [first, last) から最初に現れる区切り文字列 [delimiter, delimiter + dsize) を探す (先頭の1文字の候補を探してから残りを照合する)
+template <class CHAR>
+CHAR const* find_delimiter(CHAR const* first, CHAR const* last, CHAR const* delimiter, uint dsize)
+{
+	if (dsize == 0 || static_cast<uint>(last - first) < dsize) return last;
+
+	CHAR const* const limit = last - dsize + 1;		// 区切り文字列の先頭になり得る範囲
+	while (true){
+		first = find_char(first, limit, delimiter[0]);
+		if (first == limit) return last;
+		if (std::char_traits<CHAR>::compare(first + 1, delimiter + 1, dsize - 1) == 0) return first;
+		++first;
+	}
+}
+
+// pos 以降の次の空でないトークン [token_first, token_last) を探し、pos をその直後の区切り文字列の後ろに進める
+template <class CHAR>
+bool next_token(CHAR const*& pos, CHAR const* last, CHAR const* delimiter, uint dsize, CHAR const*& token_first, CHAR const*& token_last)
+{
+	while (pos != last){
+		CHAR const* found = find_delimiter(pos, last, delimiter, dsize);
+		token_first = pos;
+		token_last = found;
+		pos = found == last ? last : found + dsize;
+		if (token_first != token_last) return true;
+	}
+	return false;
+}
+
+// [first, last) を区切り文字列で分割し、空でない各トークンの範囲に関数を適用する
+template <class CHAR, class F>
+void for_each_token(CHAR const* first, CHAR const* last, CHAR const* delimiter, uint dsize, F&& func)
+{
+	CHAR const* token_first;
+	CHAR const* token_last;
+	while (next_token(first, last, delimiter, dsize, token_first, token_last)) func(token_first, token_last);
+}
+
+}	// impl
+}
+#endif
@@ -9,6 +9,8 @@ http://opensource.org/licenses/mit-license.php
 #define _SIG_UTIL_TYPE_CONVERT_HPP
 
 #include "type_traits.hpp"
+#include "string_view.hpp"
+#include "charconv.hpp"
 
 namespace sig
 {
@@ -66,31 +68,15 @@ template<> struct SStreamSelector<wchar_t const*>{
 	typedef std::wstring string;
 };
 
-// string to each number type
-template <class NUM> struct Str2NumSelector{};
-template <> struct Str2NumSelector<int>{
-	int operator()(std::string s){ return std::stoi(s); }
-};
-template <> struct Str2NumSelector<long>{
-	long operator()(std::string s){ return std::stol(s); }
-};
-template <> struct Str2NumSelector<long long>{
-	long long operator()(std::string s){ return std::stoll(s); }
-};
-template <> struct Str2NumSelector<unsigned int>{
-	unsigned int operator()(std::string s){ return std::stoul(s); }
-};
-template <> struct Str2NumSelector<unsigned long>{
-	unsigned long operator()(std::string s){ return std::stoul(s); }
-};
-template <> struct Str2NumSelector<unsigned long long>{
-	unsigned long long operator()(std::string s){ return std::stoull(s); }
-};
-template <> struct Str2NumSelector<float>{
-	float operator()(std::string s){ return std::stof(s); }
-};
-template <> struct Str2NumSelector<double>{
-	double operator()(std::string s){ return std::stod(s); }
+// string to each number type (ロケールに依存しない)
+template <class NUM> struct Str2NumSelector{
+	static_assert(std::is_arithmetic<NUM>::value && !std::is_same<NUM, bool>::value, "NUM must be a number type");
+
+	// 変換できない場合は std::invalid_argument, std::out_of_range を投げる
+	NUM operator()(string_view s) const{ return parse_num<NUM>(s.data(), s.data() + s.size()); }
+
+	// 例外を投げずに変換結果を返す（失敗した場合 value は変更されない）
+	ParseStatus operator()(string_view s, NUM& value) const{ return try_parse_num(s.data(), s.data() + s.size(), value); }
 };
 
 // convert string-related type T into STL string type
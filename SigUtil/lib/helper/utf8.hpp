@@ -0,0 +1,135 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_UTF8_HPP
+#define SIG_UTIL_UTF8_HPP
+
+#include "../sigutil.hpp"
+#include <cstdint>
+#include <cstring>
+
+
+/// \file utf8.hpp ロケールに依存しない UTF-8 -> ワイド文字列(UTF-16, UTF-32) の変換
+
+namespace sig
+{
+namespace impl
+{
+
+// 1コードポイントを UTF-8 (1byte), UTF-16 (2byte) または UTF-32 (4byte) で書き込む
+template <class CHAR>
+CHAR* put_code_point(CHAR* out, std::uint32_t cp, std::integral_constant<uint, 1>)
+{
+	if (cp < 0x80){
+		*out++ = static_cast<CHAR>(cp);
+	}
+	else if (cp < 0x800){
+		*out++ = static_cast<CHAR>(0xC0 | (cp >> 6));
+		*out++ = static_cast<CHAR>(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000){
+		*out++ = static_cast<CHAR>(0xE0 | (cp >> 12));
+		*out++ = static_cast<CHAR>(0x80 | ((cp >> 6) & 0x3F));
+		*out++ = static_cast<CHAR>(0x80 | (cp & 0x3F));
+	}
+	else{
+		*out++ = static_cast<CHAR>(0xF0 | (cp >> 18));
+		*out++ = static_cast<CHAR>(0x80 | ((cp >> 12) & 0x3F));
+		*out++ = static_cast<CHAR>(0x80 | ((cp >> 6) & 0x3F));
+		*out++ = static_cast<CHAR>(0x80 | (cp & 0x3F));
+	}
+	return out;
+}
+
+template <class CHAR>
+CHAR* put_code_point(CHAR* out, std::uint32_t cp, std::integral_constant<uint, 2>)
+{
+	if (cp < 0x10000){
+		*out++ = static_cast<CHAR>(cp);
+	}
+	else{
+		cp -= 0x10000;
+		*out++ = static_cast<CHAR>(0xD800 + (cp >> 10));
+		*out++ = static_cast<CHAR>(0xDC00 + (cp & 0x3FF));
+	}
+	return out;
+}
+
+template <class CHAR>
+CHAR* put_code_point(CHAR* out, std::uint32_t cp, std::integral_constant<uint, 4>)
+{
+	*out++ = static_cast<CHAR>(cp);
+	return out;
+}
+
+/// UTF-8 の文字列 [first, last) をワイド文字列 (CHARが2byteの場合はUTF-16, 4byteの場合はUTF-32) に変換し、dest の末尾に追加する
+/**
+	ASCII文字が続く部分は8byte単位でまとめて判定して変換する．\n
+	不正なバイト列（途中で途切れた・冗長な表現・サロゲートの範囲など）は1byte毎に U+FFFD に置き換える
+*/
+template <class CHAR>
+void append_utf8_as_wide(char const* first, char const* last, std::basic_string<CHAR>& dest)
+{
+	static_assert(sizeof(CHAR) == 2 || sizeof(CHAR) == 4, "CHAR must be a 16bit or 32bit character type");
+	using Size = std::integral_constant<uint, sizeof(CHAR)>;
+
+	const uint base = dest.size();
+	dest.resize(base + (last - first));		// 変換後の要素数は変換前のバイト数を超えない
+
+	auto p = reinterpret_cast<unsigned char const*>(first);
+	auto end = reinterpret_cast<unsigned char const*>(last);
+	CHAR* const out_begin = &dest[0];
+	CHAR* out = out_begin + base;
+
+	while (p != end){
+		// ASCII
+		while (end - p >= 8){
+			std::uint64_t w;
+			std::memcpy(&w, p, sizeof(w));
+			if (w & 0x8080808080808080ULL) break;
+
+			for (int i = 0; i < 8; ++i) out[i] = static_cast<CHAR>(p[i]);
+			out += 8;
+			p += 8;
+		}
+		if (p == end) break;
+
+		const unsigned char c = *p;
+		if (c < 0x80){
+			*out++ = static_cast<CHAR>(c);
+			++p;
+			continue;
+		}
+
+		uint len = 0;
+		std::uint32_t cp = 0, min = 0;
+		if (c >= 0xC2 && c <= 0xDF){ len = 2; cp = c & 0x1F; min = 0x80; }
+		else if ((c & 0xF0) == 0xE0){ len = 3; cp = c & 0x0F; min = 0x800; }
+		else if (c >= 0xF0 && c <= 0xF4){ len = 4; cp = c & 0x07; min = 0x10000; }
+
+		bool valid = len != 0 && static_cast<uint>(end - p) >= len;
+		for (uint i = 1; valid && i < len; ++i){
+			if ((p[i] & 0xC0) != 0x80) valid = false;
+			else cp = (cp << 6) | (p[i] & 0x3F);
+		}
+		if (valid && (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))) valid = false;
+
+		if (valid){
+			out = put_code_point(out, cp, Size());
+			p += len;
+		}
+		else{
+			*out++ = static_cast<CHAR>(0xFFFD);
+			++p;
+		}
+	}
+	dest.resize(out - out_begin);
+}
+
+}	// impl
+}	// sig
+#endif
@@ -72,6 +72,20 @@ http://opensource.org/licenses/mit-license.php
 
 #define SIG_ENABLE_TUPLE_ZIP (SIG_MSVC_VER > 140) || SIG_GCC_GT4_9_0 || SIG_CLANG_GT_3_5
 
+#if (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L
+	#define SIG_ENABLE_STD_STRING_VIEW 1
+
+	// 浮動小数点数にも対応した std::from_chars, std::to_chars が使用可能か
+	#if defined(__has_include)
+		#if __has_include(<charconv>)
+			#include <charconv>
+			#if defined(__cpp_lib_to_chars) || (SIG_MSVC_ENV && _MSC_VER >= 1924)
+				#define SIG_ENABLE_CHARCONV 1
+			#endif
+		#endif
+	#endif
+#endif
+
 
 #include <assert.h>
 #include <string>
@@ -9,6 +9,8 @@ http://opensource.org/licenses/mit-license.php
 #define SIG_UTIL_STRING_HPP
 
 #include "string/manipulate.hpp"
+#include "string/tokenizer.hpp"
+#include "string/aho_corasick.hpp"
 #include "string/regex.hpp"
 #include "string/convert.hpp"
 #include "string/replace.hpp"
@@ -0,0 +1,431 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_AHO_CORASICK_HPP
+#define SIG_UTIL_AHO_CORASICK_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/string_view.hpp"
+#include "../helper/parallel.hpp"
+
+#include <array>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <initializer_list>
+#include <cstdint>
+
+
+/// \file aho_corasick.hpp 多数の固定文字列を1度の走査で同時に探索する Aho-Corasick 法
+/// （エスケープした正規表現を | で繋いで探索する場合に比べ、パターンの数によらず文字列の長さに比例する手間で済む）
+
+namespace sig
+{
+
+/// 複数のパターンにマッチする箇所の報告方法
+enum class MatchMode
+{
+	all,				///< 重なり合うものも含め、全てのマッチ箇所（終了位置の順. 終了位置が同じものは長い順）
+	leftmost_longest	///< 先頭から順に、最も左で始まるマッチ箇所のうち最長のもの（互いに重ならない. 開始位置の順）
+};
+
+/// パターンにマッチした箇所
+struct PatternMatch
+{
+	uint pattern;	///< パターンの番号（構築時に渡したパターンの順番）
+	uint position;	///< 文字列中の開始位置
+	uint length;	///< マッチした長さ
+};
+
+/// 多数の固定文字列（キーワード）を同時に探索する Aho-Corasick オートマトン
+/**
+	構築時にパターンの集合からオートマトンを作成し、探索時は文字列を1度走査するだけで全てのパターンのマッチ箇所を求める．\n
+	遷移表は base / check の2つの配列に子の遷移を詰め込んだダブル配列で表すため、状態あたりのメモリが小さく、1回の遷移は配列を2回引くだけで済む．\n
+	文字はパターン中に現れるもののみに番号を振り直して扱うため（その他の文字は初期状態へ戻る）、wchar_t のように文字の種類が多い場合も表は大きくならない．\n
+	文字列は文字単位 (char, wchar_t) で比較し、マッチ箇所の位置と長さも文字単位で返す（UTF-8 の場合はバイト単位）．\n
+	構築後は変更されないため、1つのオブジェクトを複数のスレッドから同時に使用してよい．
+
+	\tparam CHAR 文字型 (char or wchar_t)
+
+	\code
+	const AhoCorasick matcher{ "he", "she", "his", "hers" };
+
+	for (auto const& m : matcher.find("ushers")){
+		std::cout << m.pattern << ": " << m.position << std::endl;	// 1: 1 ("she"), 0: 2 ("he"), 3: 2 ("hers")
+	}
+
+	auto longest = matcher.find("ushers", MatchMode::leftmost_longest);	// { 1, 1, 3 } ("she") のみ
+
+	std::vector<std::string> lines{ "this is his", "ahead" };
+	auto result = matcher.find_lines(lines, MatchMode::all, 0);		// 各行のマッチ箇所. 全てのハードウェアスレッドで並列に探索
+	\endcode
+*/
+template <class CHAR>
+class BasicAhoCorasick
+{
+	static_assert(std::is_same<CHAR, char>::value || std::is_same<CHAR, wchar_t>::value, "CHAR must be char or wchar_t");
+
+	using Unit = typename std::make_unsigned<CHAR>::type;
+	using State = std::int32_t;
+
+public:
+	using string_type = std::basic_string<CHAR>;
+	using string_view_type = basic_string_view<CHAR>;
+
+	using Match = PatternMatch;
+
+private:
+	// ダブル配列の要素. 状態 s から文字番号 c で遷移する先は t = base[s] + c (check[t] == s の場合のみ有効)
+	struct Cell
+	{
+		State base;
+		State check;	// 遷移元の状態 (-1: 未使用)
+	};
+
+	std::array<std::uint32_t, 256> table_;					// 値が256未満の文字の番号 (0: パターン中に現れない)
+	std::vector<std::pair<Unit, std::uint32_t>> wide_;		// 値が256以上の文字の番号 (文字の昇順)
+	std::vector<Cell> cells_;
+	std::vector<State> fail_;		// 失敗時の遷移先
+	std::vector<State> output_;		// その状態で終わるパターンの番号 (-1: なし)
+	std::vector<State> dict_;		// 失敗時の遷移を辿った先で、最初にパターンが終わる状態 (0: なし)
+	std::vector<std::uint32_t> depth_;
+	std::vector<uint> lengths_;
+	uint max_length_;
+
+private:
+	std::uint32_t code(CHAR ch) const
+	{
+		const Unit c = static_cast<Unit>(ch);
+		if (c < 256) return table_[c];
+
+		auto it = std::lower_bound(wide_.begin(), wide_.end(), std::make_pair(c, std::uint32_t(0)));
+		return (it != wide_.end() && it->first == c) ? it->second : 0;
+	}
+
+	State next(State s, std::uint32_t c) const
+	{
+		const std::size_t t = static_cast<std::size_t>(cells_[s].base) + c;
+		return (t < cells_.size() && cells_[t].check == s) ? static_cast<State>(t) : -1;
+	}
+
+	// 状態 s から文字 ch を読んだ後の状態
+	State transit(State s, CHAR ch) const
+	{
+		const std::uint32_t c = code(ch);
+		if (!c) return 0;
+
+		while (true){
+			const State t = next(s, c);
+			if (t >= 0) return t;
+			if (!s) return 0;
+			s = fail_[s];
+		}
+	}
+
+	void reserve_cells(std::size_t size)
+	{
+		if (cells_.size() < size) cells_.resize(std::max(size, cells_.size() * 2), Cell{ 0, -1 });
+	}
+
+	// 子の文字番号の集合 codes を全て空いている位置に置ける base を探す
+	State find_base(std::vector<std::uint32_t> const& codes, std::size_t& next_check_pos)
+	{
+		const std::uint32_t first = codes.front();
+		std::size_t occupied = 0;
+
+		for (std::size_t pos = std::max<std::size_t>(next_check_pos, first + 1); ; ++pos){
+			reserve_cells(pos + 1);
+			if (cells_[pos].check != -1){
+				// 使用済みの位置が大半を占める区間は次回以降の探索から除く
+				if (++occupied * 20 >= (pos - next_check_pos + 1) * 19) next_check_pos = pos;
+				continue;
+			}
+
+			const std::size_t base = pos - first;
+			reserve_cells(base + codes.back() + 1);
+
+			bool ok = true;
+			for (auto c : codes){
+				if (cells_[base + c].check != -1){
+					ok = false;
+					break;
+				}
+			}
+			if (ok) return static_cast<State>(base);
+		}
+	}
+
+	template <class C>
+	void build(C const& patterns)
+	{
+		struct TrieNode
+		{
+			std::map<std::uint32_t, uint> children;
+			State output;
+		};
+
+		table_.fill(0);
+		max_length_ = 0;
+
+		// パターン中に現れる文字に1からの番号を振る
+		std::map<Unit, std::uint32_t> wide;
+		std::uint32_t code_num = 0;
+		std::vector<TrieNode> trie(1, TrieNode{ {}, -1 });
+
+		for (auto const& pattern : patterns){
+			const string_view_type p(pattern);
+			const uint id = lengths_.size();
+			lengths_.push_back(p.size());
+			if (p.empty()) continue;
+
+			max_length_ = std::max<uint>(max_length_, p.size());
+
+			uint node = 0;
+			for (CHAR ch : p){
+				const Unit u = static_cast<Unit>(ch);
+				std::uint32_t& c = u < 256 ? table_[u] : wide[u];
+				if (!c) c = ++code_num;
+
+				auto it = trie[node].children.find(c);
+				if (it == trie[node].children.end()){
+					trie[node].children.emplace(c, trie.size());
+					node = trie.size();
+					trie.push_back(TrieNode{ {}, -1 });
+				}
+				else node = it->second;
+			}
+			if (trie[node].output < 0) trie[node].output = id;		// 同じパターンは最初のもののみ報告する
+		}
+		wide_.assign(wide.begin(), wide.end());
+
+		// 幅優先の順に各状態の子をダブル配列に配置する
+		std::vector<std::pair<uint, State>> order(1, std::make_pair(0u, State(0)));	// (トライの節点, 状態)
+		std::vector<std::uint32_t> codes;
+		std::size_t next_check_pos = 1;
+
+		cells_.assign(1, Cell{ 0, 0 });
+		std::vector<std::uint32_t> depth(1, 0);
+
+		for (std::size_t i = 0; i < order.size(); ++i){
+			const auto& children = trie[order[i].first].children;
+			const State s = order[i].second;
+			if (children.empty()) continue;
+
+			codes.clear();
+			for (auto const& child : children) codes.push_back(child.first);
+
+			const State base = find_base(codes, next_check_pos);
+			cells_[s].base = base;
+			for (auto const& child : children){
+				const State t = base + child.first;
+				cells_[t].check = s;
+				order.push_back(std::make_pair(child.second, t));
+
+				if (depth.size() <= static_cast<std::size_t>(t)) depth.resize(t + 1, 0);
+				depth[t] = depth[s] + 1;
+			}
+		}
+
+		// 末尾の未使用の領域を除く
+		std::size_t size = cells_.size();
+		while (size > 1 && cells_[size - 1].check == -1) --size;
+		cells_.resize(size);
+		cells_.shrink_to_fit();
+
+		fail_.assign(size, 0);
+		output_.assign(size, -1);
+		dict_.assign(size, 0);
+		depth_.assign(size, 0);
+		std::copy(depth.begin(), depth.begin() + std::min(depth.size(), size), depth_.begin());
+
+		// 幅優先の順に失敗時の遷移先を求める（浅い状態から決まる）
+		for (auto const& node : order){
+			const State s = node.second;
+			output_[s] = trie[node.first].output;
+
+			for (auto const& child : trie[node.first].children){
+				const State t = cells_[s].base + child.first;
+				State f = 0;
+
+				if (s){
+					for (State g = fail_[s]; ; g = fail_[g]){
+						const State n = next(g, child.first);
+						if (n >= 0){
+							f = n;
+							break;
+						}
+						if (!g) break;
+					}
+				}
+				fail_[t] = f;
+			}
+		}
+		for (auto const& node : order){
+			const State s = node.second;
+			if (s) dict_[s] = output_[fail_[s]] >= 0 ? fail_[s] : dict_[fail_[s]];
+		}
+	}
+
+	template <class F>
+	uint for_each_all(string_view_type src, F const& func) const
+	{
+		State s = 0;
+		uint num = 0;
+
+		for (uint i = 0, size = src.size(); i < size; ++i){
+			s = transit(s, src[i]);
+
+			for (State o = output_[s] >= 0 ? s : dict_[s]; o; o = dict_[o]){
+				const uint id = output_[o];
+				func(Match{ id, i + 1 - lengths_[id], lengths_[id] });
+				++num;
+			}
+		}
+		return num;
+	}
+
+	template <class F>
+	uint for_each_longest(string_view_type src, F const& func) const
+	{
+		if (!max_length_) return 0;
+
+		// 開始位置毎の最長のパターンの番号+1 (開始位置を max_length_ で割った余りの位置に格納)
+		std::vector<uint> best(max_length_, 0);
+		uint pos = 0;		// まだ確定していない最初の開始位置
+		uint num = 0;
+
+		// limit より前から始まるマッチ箇所を確定する
+		auto settle = [&](uint limit){
+			while (pos < limit){
+				const uint b = best[pos % max_length_];
+				if (!b){
+					++pos;
+					continue;
+				}
+				const uint len = lengths_[b - 1];
+				func(Match{ b - 1, pos, len });
+				++num;
+
+				for (uint end = pos + len; pos < end; ++pos) best[pos % max_length_] = 0;
+			}
+		};
+
+		State s = 0;
+		for (uint i = 0, size = src.size(); i < size; ++i){
+			s = transit(s, src[i]);
+
+			// 現在の状態の深さより前から始まるマッチ箇所は、これ以降に見つかることはない
+			settle(i + 1 - depth_[s]);
+
+			for (State o = output_[s] >= 0 ? s : dict_[s]; o; o = dict_[o]){
+				const uint id = output_[o];
+				const uint start = i + 1 - lengths_[id];
+				if (start < pos) continue;		// 確定済みのマッチ箇所と重なる
+
+				uint& b = best[start % max_length_];
+				if (!b || lengths_[b - 1] < lengths_[id]) b = id + 1;
+			}
+		}
+		settle(src.size());
+
+		return num;
+	}
+
+public:
+	/// パターンの集合からオートマトンを構築
+	/**
+		空のパターンはマッチしない．同じパターンが複数ある場合は最初のものの番号のみ報告する．
+
+		\param patterns パターンの集合（\ref sig_container ）. 要素は std::basic_string<CHAR> や CHAR const* 等
+	*/
+	template <class C,
+		typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+	>
+	explicit BasicAhoCorasick(C const& patterns)
+	{
+		build(patterns);
+	}
+
+	BasicAhoCorasick(std::initializer_list<string_type> patterns)
+	{
+		build(patterns);
+	}
+
+	/// 文字列を走査し、パターンにマッチした箇所毎に関数を適用する
+	/**
+		\param src 探索対象の文字列
+		\param func マッチ箇所 (Match) を引数にとる関数
+		\param mode [option] マッチ箇所の報告方法
+
+		\return マッチ箇所の数
+	*/
+	template <class F>
+	uint for_each(string_view_type src, F const& func, MatchMode mode = MatchMode::all) const
+	{
+		return mode == MatchMode::all ? for_each_all(src, func) : for_each_longest(src, func);
+	}
+
+	/// 文字列中のパターンにマッチする箇所を求める
+	/**
+		\param src 探索対象の文字列
+		\param mode [option] マッチ箇所の報告方法
+
+		\return マッチ箇所の std::vector
+	*/
+	std::vector<Match> find(string_view_type src, MatchMode mode = MatchMode::all) const
+	{
+		std::vector<Match> result;
+		for_each(src, [&](Match const& m){ result.push_back(m); }, mode);
+		return result;
+	}
+
+	/// 文字列中にいずれかのパターンにマッチする箇所があるか（最初のマッチ箇所で走査を打ち切る）
+	bool contains(string_view_type src) const
+	{
+		State s = 0;
+		for (CHAR ch : src){
+			s = transit(s, ch);
+			if (output_[s] >= 0 || dict_[s]) return true;
+		}
+		return false;
+	}
+
+	/// 複数の行（文字列）をまとめて探索する
+	/**
+		\param lines 探索対象の文字列のコンテナ（\ref sig_container ）
+		\param mode [option] マッチ箇所の報告方法
+		\param thread_num [option] 使用するスレッド数（0の場合はハードウェアの並列数）
+
+		\return 各行のマッチ箇所の std::vector (行の順)
+	*/
+	template <class C,
+		typename std::enable_if<impl::container_traits<C>::exist>::type*& = enabler
+	>
+	std::vector<std::vector<Match>> find_lines(C const& lines, MatchMode mode = MatchMode::all, uint thread_num = 1) const
+	{
+		std::vector<string_view_type> views;
+		for (auto const& line : lines) views.push_back(string_view_type(line));
+
+		return impl::parallel_generate<std::vector<Match>>(views.size(), thread_num, [&](uint i){
+			return find(views[i], mode);
+		});
+	}
+
+	/// パターンの数
+	uint size() const{ return lengths_.size(); }
+
+	/// オートマトンの状態を格納する配列の長さ
+	uint state_capacity() const{ return cells_.size(); }
+};
+
+using AhoCorasick = BasicAhoCorasick<char>;
+using WAhoCorasick = BasicAhoCorasick<wchar_t>;
+
+}
+#endif
@@ -10,6 +10,11 @@ http://opensource.org/licenses/mit-license.php
 
 #include "../helper/type_convert.hpp"
 #include "../helper/container_helper.hpp"
+#include "../helper/string_view.hpp"
+#include "../helper/token.hpp"
+#include <vector>
+#include <iterator>
+#include <algorithm>
 
 
 /// \file manipulate.hpp 文字列処理ユーティリティ
@@ -17,8 +22,29 @@ http://opensource.org/licenses/mit-license.php
 namespace sig
 {
 
+namespace impl
+{
+
+// 文字列を参照する basic_string_view に変換
+template <class CHAR, class TRAITS, class A>
+basic_string_view<CHAR> to_string_view(std::basic_string<CHAR, TRAITS, A> const& str){ return basic_string_view<CHAR>(str.data(), str.size()); }
+
+template <class CHAR>
+basic_string_view<CHAR> to_string_view(CHAR const* str){ return basic_string_view<CHAR>(str); }
+
+template <class CHAR>
+basic_string_view<CHAR> to_string_view(basic_string_view<CHAR> str){ return str; }
+
+template <class S>
+using string_view_t = decltype(to_string_view(std::declval<S const&>()));
+
+}	// impl
+
+
 /// 文字列(src)をある文字列(delimiter)を目印に分割する
 /**
+	区切り文字列の間に何もない（空の）部分は結果に含まれない
+
 	\tparam CSeq  returnされるシーケンスコンテナの種類
 
 	\param src 分割対象の文字列
@@ -26,6 +52,8 @@ namespace sig
 
 	\return 分割後の文字列が格納されたシーケンスコンテナ
 
+	\sa split_view(S const& src, impl::string_view_t<S> delimiter)
+
 	\code
 	auto src = " one,2, 参 ";
 	
@@ -42,37 +70,14 @@ auto split(
 	impl::string_t<S> const& delimiter)
 ->CSeq<TS>
 {
+	using CHAR = typename TS::value_type;
+
 	CSeq<TS> result;
-	const uint mag = delimiter.size();
-	const uint length = src.size();
-	uint pos = 0, ppos = 0;
-
-	while (pos < length){
-		if (src[pos] == delimiter[0]){
-			// check to match delimiter
-			bool cf = true;
-			for (uint d = 1; d < mag; ++d){
-				if (src[pos+d] != delimiter[d]){
-					cf = false;
-					break;
-				}
-			}
-
-			if (cf){
-				if (pos - ppos > 0) result.push_back(src.substr(ppos, pos - ppos));
-				//impl::container_traits<CSeq>::add_element(result, src.substr(ppos, pos));
-				pos += mag;
-				ppos = pos;
-			}
-			else{
-				pos += mag;
-			}
-		}
-		else{
-			++pos;
-		}
-	}
-	if (pos - ppos > 0)result.push_back(src.substr(ppos, pos - ppos));
+	TS const& str = src;
+
+	impl::for_each_token(str.data(), str.data() + str.size(), delimiter.data(), delimiter.size(), [&](CHAR const* first, CHAR const* last){
+		result.push_back(TS(first, last));
+	});
 
 	return result;
 }
@@ -101,6 +106,193 @@ auto split(
 	return split<CSeq>(std::wstring(src), std::wstring(delimiter));
 }
 
+/// 文字列(src)をある文字列(delimiter)を目印に分割し、各部分を参照する string_view を呼び出し元のコンテナに格納する
+/**
+	dest の元の内容は破棄される．同じコンテナを使い回すことで、繰り返し分割する場合にメモリの確保を行わずに済む
+
+	\param src 分割対象の文字列
+	\param delimiter 分割の目印となる文字列
+	\param dest 分割後の各部分を格納するコンテナ（\ref sig_container ）. 要素型は (文字へのポインタ, 長さ) から構築可能な型 (string_view, std::string 等)
+
+	\return 分割後の部分の数
+
+	\code
+	std::vector<string_view> tokens;
+
+	for (auto const& line : lines){
+		split_view(line, ",", tokens);
+		...
+	}
+	\endcode
+*/
+template <class S, class C, class V = impl::string_view_t<S>>
+uint split_view(
+	S const& src,
+	typename impl::identity<V>::type delimiter,
+	C& dest)
+{
+	using CHAR = typename V::value_type;
+	using T = typename impl::container_traits<C>::value_type;
+
+	const V str = impl::to_string_view(src);
+	uint num = 0;
+
+	dest.clear();
+	impl::for_each_token(str.data(), str.data() + str.size(), delimiter.data(), delimiter.size(), [&](CHAR const* first, CHAR const* last){
+		impl::container_traits<C>::add_element(dest, T(first, last - first));
+		++num;
+	});
+	return num;
+}
+
+/// 文字列(src)をある文字列(delimiter)を目印に分割し、各部分を参照する string_view を返す
+/**
+	split と同じ規則で分割するが、分割後の各部分をコピーせずに src を参照する．\n
+	区切り文字列の探索は先頭の1文字を memchr (wmemchr) で一括して探してから残りを照合するため、1文字ずつ比較するより高速である．\n
+	返された string_view は src が破棄・変更されるまで有効である（一時オブジェクトの std::string は渡せない）．
+
+	\param src 分割対象の文字列（std::string, std::wstring, 文字列リテラル, string_view 等）
+	\param delimiter 分割の目印となる文字列
+
+	\return 分割後の各部分を参照する string_view (wstring_view) の std::vector
+
+	\code
+	std::string src = " one,2,, 参 ";
+
+	auto spl = split_view(src, ",");		// vector<string_view>{" one", "2", " 参 "}
+	\endcode
+*/
+template <class S, class V = impl::string_view_t<S>>
+auto split_view(
+	S const& src,
+	typename impl::identity<V>::type delimiter)
+->std::vector<V>
+{
+	std::vector<V> result;
+	split_view(src, delimiter, result);
+	return result;
+}
+
+template <class CHAR, class TRAITS, class A, class... Ts>
+void split_view(std::basic_string<CHAR, TRAITS, A>&& src, Ts&&...) = delete;
+
+
+/// 文字列をある文字列を目印に分割した各部分を、走査する毎に1つずつ求める前方向レンジ
+/**
+	各部分は src を参照する string_view (wstring_view) として返される．\n
+	分割結果を格納するコンテナを作成しないため、途中で走査を打ち切る場合や、分割結果を1度しか使わない場合に有効である．\n
+	range-based for や sig::map, sig::filter 等にそのまま渡すことができる．
+
+	\sa split_range(S const& src, impl::string_view_t<S> delimiter)
+*/
+template <class CHAR>
+class SplitRange
+{
+public:
+	using value_type = basic_string_view<CHAR>;
+
+private:
+	value_type src_;
+	value_type delimiter_;
+
+public:
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = basic_string_view<CHAR>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = value_type const*;
+		using reference = value_type;
+
+	private:
+		CHAR const* pos_;
+		CHAR const* last_;
+		value_type delimiter_;
+		CHAR const* token_first_;	// nullptr: end
+		CHAR const* token_last_;
+
+		void fetch()
+		{
+			if (!impl::next_token(pos_, last_, delimiter_.data(), delimiter_.size(), token_first_, token_last_)) token_first_ = token_last_ = nullptr;
+		}
+
+	public:
+		const_iterator() : pos_(nullptr), last_(nullptr), token_first_(nullptr), token_last_(nullptr){}
+		const_iterator(value_type src, value_type delimiter)
+			: pos_(src.data()), last_(src.data() + src.size()), delimiter_(delimiter), token_first_(nullptr), token_last_(nullptr)
+		{
+			fetch();
+		}
+
+		value_type operator*() const{ return value_type(token_first_, token_last_ - token_first_); }
+
+		const_iterator& operator++()
+		{
+			fetch();
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			auto tmp = *this;
+			fetch();
+			return tmp;
+		}
+
+		bool operator==(const_iterator const& other) const{ return token_first_ == other.token_first_; }
+		bool operator!=(const_iterator const& other) const{ return token_first_ != other.token_first_; }
+	};
+	using iterator = const_iterator;
+
+	SplitRange(value_type src, value_type delimiter) : src_(src), delimiter_(delimiter){}
+
+	const_iterator begin() const{ return const_iterator(src_, delimiter_); }
+
+	const_iterator end() const{ return const_iterator(); }
+};
+
+namespace impl
+{
+template <class CHAR>
+struct container_traits<SplitRange<CHAR>>
+{
+	static const bool exist = true;
+
+	using value_type = basic_string_view<CHAR>;
+
+	template <class U>
+	using rebind = std::vector<U>;
+};
+}
+
+/// 文字列(src)をある文字列(delimiter)を目印に分割した各部分を、走査する毎に求めるレンジを返す
+/**
+	\param src 分割対象の文字列
+	\param delimiter 分割の目印となる文字列
+
+	\return 分割後の各部分 (string_view, wstring_view) を順に返す前方向レンジ．src が破棄・変更されるまで有効
+
+	\code
+	std::string src = "id=7;name=sig;;lang=C++";
+
+	for (auto token : split_range(src, ";")){
+		if (token.size() > 4 && std::string(token.data(), 4) == "name") ...
+	}
+	\endcode
+*/
+template <class S, class V = impl::string_view_t<S>>
+auto split_range(
+	S const& src,
+	typename impl::identity<V>::type delimiter)
+->SplitRange<typename V::value_type>
+{
+	return SplitRange<typename V::value_type>(impl::to_string_view(src), delimiter);
+}
+
+template <class CHAR, class TRAITS, class A, class... Ts>
+void split_range(std::basic_string<CHAR, TRAITS, A>&& src, Ts&&...) = delete;
+
+
 
 namespace impl
 {
@@ -127,67 +319,226 @@ auto cat_impl(
 	return osstream.str();
 }
 
+// cat で結合する要素の種類
+struct cat_string_tag{};	// 文字列（結合後の長さを求めて一括で確保する）
+struct cat_number_tag{};	// 数値（ostringstream を介さずに変換する）
+struct cat_stream_tag{};	// その他（ostringstream で変換する）
+
+template <class T, class S, class E = typename std::decay<T>::type>
+using cat_tag = typename std::conditional<
+	std::is_convertible<E, basic_string_view<typename S::value_type>>::value,
+	cat_string_tag,
+	typename std::conditional<
+		std::is_same<S, std::string>::value && (is_plain_integer<E>::value || std::is_floating_point<E>::value),
+		cat_number_tag,
+		cat_stream_tag
+	>::type
+>::type;
+
+template <class It, class S>
+void cat_append(S& dest, It begin, It end, S const& delimiter, NumFormat, int, std::locale const*, cat_string_tag)
+{
+	using V = basic_string_view<typename S::value_type>;
+	if (begin == end) return;
+
+	uint size = 0, num = 0;
+	for (auto it = begin; it != end; ++it, ++num) size += V(*it).size();
+
+	const uint required = dest.size() + size + delimiter.size() * (num - 1);
+	if (dest.capacity() < required) dest.reserve(std::max<uint>(required, dest.capacity() * 2));
+
+	const V head(*begin);
+	dest.append(head.data(), head.size());
+	for (++begin; begin != end; ++begin){
+		const V v(*begin);
+		dest.append(delimiter);
+		dest.append(v.data(), v.size());
+	}
+}
+
+template <class It, class S>
+void cat_append(S& dest, It begin, It end, S const& delimiter, NumFormat format, int precision, std::locale const*, cat_number_tag)
+{
+	if (begin == end) return;
+
+	append_num(dest, *begin, format, precision);
+	for (++begin; begin != end; ++begin){
+		dest.append(delimiter);
+		append_num(dest, *begin, format, precision);
+	}
+}
+
+template <class It, class S>
+void cat_append(S& dest, It begin, It end, S const& delimiter, NumFormat, int, std::locale const* osstream_locale, cat_stream_tag)
+{
+	if (begin == end) return;
+
+	typename SStreamSelector<S>::ostringstream oss;
+	dest.append(cat_impl(begin, end, delimiter, oss, osstream_locale ? *osstream_locale : std::locale("")));
+}
+
+// 要素の種類に応じて結合し、dest の末尾に追加する
+template <class It, class S>
+void cat_append(S& dest, It begin, It end, S const& delimiter, NumFormat format, int precision, std::locale const* osstream_locale)
+{
+	cat_append(dest, begin, end, delimiter, format, precision, osstream_locale, cat_tag<decltype(*begin), S>());
+}
+
 }	// impl
 
 
 /// コンテナ中の各文字列や数値を結合
 /**
-	conatiner中の要素が数値の場合、ostringstreamで出力される文字列に変換される
+	conatiner中の要素が文字列の場合、結合後の長さを求めてから1度だけ領域を確保して連結する．\n
+	数値の場合、ostringstreamで出力される文字列（浮動小数点数は精度6の %g 相当）と同じ文字列に ostringstream を介さずに変換する．\n
+	それ以外の型の要素は ostringstream で出力される文字列に変換される
 
 	\param container 文字列か数値が格納されたコンテナ（\ref sig_container ）
 	\param delimiter 結合する文字列間に挿入される文字列
-	\param osstream_locale [option] 出力に影響するロケール 
 
 	\return 結合した文字列
 
 	\code
 	auto cat1 = cat(std::vector<std::string>{"eins", "zwei", "drei"}, "");
 	auto cat2 = cat(std::list<std::wstring>{L"eins", L"zwei", L"drei"}, L",");
+	auto cat3 = cat(std::vector<double>{ 0.1, 1.0 / 3, 1e-7 }, ",");
 
 	assert(cat1 == "einszweidrei");
 	assert(cat2 == L"eins,zwei,drei");
+	assert(cat3 == "0.1,0.333333,1e-07");
 	\endcode
 */
 template <class C,
 	class CR = typename impl::remove_const_reference<C>::type,
 	class S = typename impl::SStreamSelector<typename impl::container_traits<CR>::value_type>::string
 >
+auto cat(
+	C&& container,
+	typename sig::impl::identity<S>::type const& delimiter)
+->S
+{
+	S result;
+	impl::cat_append(result, impl::begin(std::forward<C>(container)), impl::end(std::forward<C>(container)), delimiter, NumFormat::general, 6, nullptr);
+	return result;
+}
+
+/**
+	ostringstream で変換する要素の出力に影響するロケールを指定する場合
+
+	\param osstream_locale 出力に影響するロケール
+
+	\sa cat(C&& container, S const& delimiter)
+*/
+template <class C,
+	class CR = typename impl::remove_const_reference<C>::type,
+	class S = typename impl::SStreamSelector<typename impl::container_traits<CR>::value_type>::string
+>
 auto cat(
 	C&& container,
 	typename sig::impl::identity<S>::type const& delimiter,
-	std::locale osstream_locale = std::locale(""))
+	std::locale osstream_locale)
+->S
+{
+	S result;
+	impl::cat_append(result, impl::begin(std::forward<C>(container)), impl::end(std::forward<C>(container)), delimiter, NumFormat::general, 6, &osstream_locale);
+	return result;
+}
+
+/// 数値が格納されたコンテナの各要素を書式を指定して文字列に変換し、結合する
+/**
+	\param container 数値が格納されたコンテナ（\ref sig_container ）
+	\param delimiter 結合する文字列間に挿入される文字列
+	\param format 浮動小数点数の書式（整数には影響しない）
+	\param precision [option] 浮動小数点数の精度（general: 有効桁数, fixed: 小数点以下の桁数, shortest: 無視される）
+
+	\return 結合した文字列
+
+	\code
+	auto cat1 = cat(std::vector<double>{ 0.1, 1.0 / 3 }, ",", NumFormat::shortest);	// "0.1,0.3333333333333333"
+	auto cat2 = cat(std::vector<double>{ 0.1, 1.0 / 3 }, ",", NumFormat::fixed, 2);	// "0.10,0.33"
+	\endcode
+*/
+template <class C,
+	class CR = typename impl::remove_const_reference<C>::type,
+	class S = typename impl::SStreamSelector<typename impl::container_traits<CR>::value_type>::string
+>
+auto cat(
+	C&& container,
+	typename sig::impl::identity<S>::type const& delimiter,
+	NumFormat format,
+	int precision = 6)
 ->S
 {
-	typename impl::SStreamSelector<S>::ostringstream oss;
-	return impl::cat_impl(
-		impl::begin(std::forward<C>(container)),
-		impl::end(std::forward<C>(container)),
-		delimiter,
-		oss,
-		osstream_locale
-	);
+	S result;
+	impl::cat_append(result, impl::begin(std::forward<C>(container)), impl::end(std::forward<C>(container)), delimiter, format, precision, nullptr);
+	return result;
+}
+
+/// コンテナ中の各文字列や数値を結合し、dest の末尾に追加する
+/**
+	同じ文字列を使い回すことで、繰り返し結合する場合にメモリの確保を行わずに済む
+
+	\param container 文字列か数値が格納されたコンテナ（\ref sig_container ）
+	\param delimiter 結合する文字列間に挿入される文字列
+	\param dest 結合した文字列を追加する文字列
+	\param format [option] 浮動小数点数の書式（整数には影響しない）
+	\param precision [option] 浮動小数点数の精度（general: 有効桁数, fixed: 小数点以下の桁数, shortest: 無視される）
+
+	\return dest
+
+	\code
+	std::string line;
+
+	for (auto const& row : matrix){
+		line.clear();
+		cat(row, ",", line);
+		...
+	}
+	\endcode
+*/
+template <class C, class S>
+S& cat(
+	C&& container,
+	typename sig::impl::identity<S>::type const& delimiter,
+	S& dest,
+	NumFormat format = NumFormat::general,
+	int precision = 6)
+{
+	impl::cat_append(dest, impl::begin(std::forward<C>(container)), impl::end(std::forward<C>(container)), delimiter, format, precision, nullptr);
+	return dest;
+}
+
+/**
+	containerがinitializer_listの場合
+
+	\sa cat(C&& container, S const& delimiter)
+*/
+template <class T, class S = typename impl::SStreamSelector<T>::string>
+auto cat(
+	std::initializer_list<T> container,
+	typename sig::impl::identity<S>::type const& delimiter)
+->S
+{
+	S result;
+	impl::cat_append(result, container.begin(), container.end(), delimiter, NumFormat::general, 6, nullptr);
+	return result;
 }
 
 /**
 	containerがinitializer_listの場合
 
-	\sa cat(C const& container, S const& delimiter, std::locale osstream_locale)
+	\sa cat(C&& container, S const& delimiter, std::locale osstream_locale)
 */
 template <class T, class S = typename impl::SStreamSelector<T>::string>
 auto cat(
 	std::initializer_list<T> container,
 	typename sig::impl::identity<S>::type const& delimiter,
-	std::locale osstream_locale = std::locale(""))
+	std::locale osstream_locale)
 ->S
 {
-	typename impl::SStreamSelector<S>::ostringstream oss;
-	return impl::cat_impl(
-		impl::begin(container),
-		impl::end(container),
-		delimiter,
-		oss,
-		osstream_locale
-	);
+	S result;
+	impl::cat_append(result, container.begin(), container.end(), delimiter, NumFormat::general, 6, &osstream_locale);
+	return result;
 }
 
 }
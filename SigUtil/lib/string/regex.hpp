@@ -11,6 +11,9 @@ http://opensource.org/licenses/mit-license.php
 #include "../helper/type_convert.hpp"
 #include "../helper/maybe.hpp"
 #include <regex>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #if SIG_MSVC_ENV
 #define NOMINMAX
@@ -32,6 +35,8 @@ http://opensource.org/licenses/mit-license.php
 	using SIG_WRegex = std::wregex;
 	using SIG_SMatch = std::smatch;
 	using SIG_WSMatch = std::wsmatch;
+	using SIG_SRegexIterator = std::sregex_iterator;
+	using SIG_WSRegexIterator = std::wsregex_iterator;
 	#define SIG_RegexSearch std::regex_search
 	#define SIG_RegexReplace std::regex_replace
 #elif SIG_ENABLE_BOOST
@@ -39,6 +44,8 @@ http://opensource.org/licenses/mit-license.php
 	using SIG_WRegex = typename boost::wregex;
 	using SIG_SMatch = typename boost::smatch;
 	using SIG_WSMatch = typename boost::wsmatch;
+	using SIG_SRegexIterator = typename boost::sregex_iterator;
+	using SIG_WSRegexIterator = typename boost::wsregex_iterator;
 	#define SIG_RegexSearch boost::regex_search
 	#define SIG_RegexReplace boost::regex_replace
 #else
@@ -61,14 +68,205 @@ template <>
 struct Str2RegexSelector<std::string>{
 	typedef SIG_Regex regex;
 	typedef SIG_SMatch smatch;
+	typedef SIG_SRegexIterator regex_iterator;
 };
 template <>
 struct Str2RegexSelector<std::wstring>{
 	typedef SIG_WRegex regex;
 	typedef SIG_WSMatch smatch;
+	typedef SIG_WSRegexIterator regex_iterator;
+};
+
+// 作成済みの正規表現オブジェクトを (正規表現の文字列, フラグ) 毎に保持するキャッシュ（複数のスレッドから同時に使用してよい）
+// 保持する数が capacity に達した場合は全て破棄する（取得済みのオブジェクトは shared_ptr により有効なまま残る）
+template <class R>
+class RegexCache
+{
+	using S = std::basic_string<typename R::value_type>;
+	using Key = std::pair<S, unsigned long>;
+
+	struct KeyHash
+	{
+		std::size_t operator()(Key const& key) const{ return std::hash<S>()(key.first) ^ (key.second * 0x9E3779B9u); }
+	};
+
+	std::mutex mutex_;
+	std::unordered_map<Key, std::shared_ptr<R const>, KeyHash> cache_;
+	const uint capacity_;
+
+public:
+	explicit RegexCache(uint capacity) : capacity_(capacity){}
+
+	// 未作成の場合は make() で作成する（作成中はロックを保持しない）
+	template <class F>
+	std::shared_ptr<R const> get(S const& expression, typename R::flag_type flags, F const& make)
+	{
+		Key key(expression, static_cast<unsigned long>(flags));
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			auto it = cache_.find(key);
+			if (it != cache_.end()) return it->second;
+		}
+
+		std::shared_ptr<R const> reg = std::make_shared<R const>(make());
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (cache_.size() >= capacity_) cache_.clear();
+		return cache_.emplace(std::move(key), std::move(reg)).first->second;
+	}
+};
+
+// 正規表現の文字列から作成したオブジェクトのキャッシュ
+template <class R>
+RegexCache<R>& regex_cache()
+{
+	static RegexCache<R> cache(256);
+	return cache;
+}
+
+// エスケープ処理を行う前の文字列から作成したオブジェクトのキャッシュ (make_regex)
+template <class R>
+RegexCache<R>& literal_regex_cache()
+{
+	static RegexCache<R> cache(256);
+	return cache;
+}
+}	// impl
+
+
+/// 正規表現オブジェクトを取得する（同じ文字列・フラグのオブジェクトは1度だけ作成され、以降はキャッシュから返される）
+/**
+	キャッシュは複数のスレッドから同時に使用してよい
+
+	\param expression 正規表現の文字列
+	\param flags [option] 正規表現の文法等を指定するフラグ
+
+	\return 正規表現オブジェクト (std::regex or std::wregex. libstdc++使用時 かつ boost使用時は boost::regex) の shared_ptr
+
+	\exception std::regex_error (boost::regex_error) 正規表現の文字列が不正な場合
+
+	\code
+	for (auto const& line : lines){
+		auto reg = cached_regex("tes(\\d)");		// 2回目以降は作成済みのオブジェクトを返す
+		...
+	}
+	\endcode
+*/
+template <class S,
+	class TS = impl::string_t<S>,
+	class R = typename impl::Str2RegexSelector<TS>::regex
+>
+auto cached_regex(
+	S const& expression,
+	typename R::flag_type flags = R::ECMAScript)
+->std::shared_ptr<R const>
+{
+	TS const& str = expression;
+	return impl::regex_cache<R>().get(str, flags, [&]{ return R(str, flags); });
+}
+
+
+/// 文字列中の正規表現にマッチする箇所を順に求める入力レンジ
+/**
+	std::regex_iterator (boost::regex_iterator) で走査するため、対象の文字列はコピーされない．\n
+	各要素は std::smatch 等のマッチ結果で、参照する文字列が破棄・変更されるまで有効である．
+
+	\sa regex_matches(TS const& src, R const& expression)
+*/
+template <class TS>
+class RegexMatchRange
+{
+	using R = typename impl::Str2RegexSelector<TS>::regex;
+
+public:
+	using const_iterator = typename impl::Str2RegexSelector<TS>::regex_iterator;
+	using iterator = const_iterator;
+	using value_type = typename impl::Str2RegexSelector<TS>::smatch;
+
+private:
+	std::shared_ptr<R const> holder_;	// キャッシュから取得したオブジェクトを使用する場合
+	const_iterator begin_;
+
+public:
+	RegexMatchRange(TS const& src, R const& expression, std::shared_ptr<R const> holder = nullptr)
+		: holder_(std::move(holder)), begin_(src.begin(), src.end(), expression){}
+
+	const_iterator begin() const{ return begin_; }
+
+	const_iterator end() const{ return const_iterator(); }
+};
+
+namespace impl
+{
+template <class TS>
+struct container_traits<RegexMatchRange<TS>>
+{
+	static const bool exist = true;
+
+	using value_type = typename RegexMatchRange<TS>::value_type;
+
+	template <class U>
+	using rebind = std::vector<U>;
 };
 }
 
+/// 文字列中の正規表現にマッチする箇所を、対象の文字列をコピーせずに順に走査するレンジを返す
+/**
+	\param src 探索対象の文字列 (std::string or std::wstring). 走査が終わるまで破棄・変更してはならない
+	\param expression 正規表現オブジェクト. 走査が終わるまで破棄してはならない
+
+	\return マッチ結果 (std::smatch 等) を順に返すレンジ
+
+	\code
+	std::string src = "test tes1 tes2";
+
+	for (auto const& m : regex_matches(src, SIG_Regex("tes(\\d)"))){		// 一時オブジェクトは渡せないため、文字列で指定するか変数に格納する
+		std::cout << m.position(0) << ": " << m[1] << std::endl;		// 5: 1, 10: 2
+	}
+	\endcode
+*/
+template <class TS, class R = typename impl::Str2RegexSelector<TS>::regex>
+auto regex_matches(
+	TS const& src,
+	typename impl::identity<R>::type const& expression)
+->RegexMatchRange<TS>
+{
+	return RegexMatchRange<TS>(src, expression);
+}
+
+/**
+	正規表現を文字列で指定する場合（正規表現オブジェクトは cached_regex で取得する）
+
+	\param src 探索対象の文字列 (std::string or std::wstring). 走査が終わるまで破棄・変更してはならない
+	\param expression 正規表現の文字列
+	\param flags [option] 正規表現の文法等を指定するフラグ
+
+	\code
+	std::string src = "test tes1 tes2";
+
+	for (auto const& m : regex_matches(src, "tes(\\d)")){
+		std::cout << m[1] << std::endl;
+	}
+	\endcode
+*/
+template <class TS, class R = typename impl::Str2RegexSelector<TS>::regex>
+auto regex_matches(
+	TS const& src,
+	typename impl::identity<TS>::type const& expression,
+	typename R::flag_type flags = R::ECMAScript)
+->RegexMatchRange<TS>
+{
+	auto reg = cached_regex(expression, flags);
+	return RegexMatchRange<TS>(src, *reg, reg);
+}
+
+template <class TS, class R = typename impl::Str2RegexSelector<TS>::regex>
+void regex_matches(TS const& src, typename impl::identity<R>::type&& expression) = delete;
+
+template <class CHAR, class TRAITS, class A, class... Ts>
+void regex_matches(std::basic_string<CHAR, TRAITS, A>&& src, Ts&&...) = delete;
+
+
 #if SIG_MSVC_ENV
 
 /// 与えられた文字中に含まれる、正規表現の特殊文字をエスケープする
@@ -131,6 +329,8 @@ inline auto escape_regex(std::wstring const& expression) ->std::wstring
 
 /// エスケープ処理を行い、regexオブジェクトを返す
 /**
+	同じ文字列から作成したオブジェクトはキャッシュされ、2回目以降はエスケープ処理と構築を省略する
+
 	\param expression 正規表現の文字列
 
 	\return std::regex or std::wregex (libstdc++使用時 かつ boost使用時は boost::regex)
@@ -147,13 +347,17 @@ inline auto escape_regex(std::wstring const& expression) ->std::wstring
 template <class S>
 auto make_regex(S const& expression) ->typename impl::Str2RegexSelector<impl::string_t<S>>::regex
 {
-	return typename impl::Str2RegexSelector<impl::string_t<S>>::regex(escape_regex(expression));
+	using R = typename impl::Str2RegexSelector<impl::string_t<S>>::regex;
+	impl::string_t<S> const& str = expression;
+
+	return *impl::literal_regex_cache<R>().get(str, R::ECMAScript, [&]{ return R(escape_regex(str)); });
 }
 
 
 /// std::regex_search のラッパ関数
 /**
-	探索結果にアクセスしやすい様に二次元配列（vector<vector<string>>）に結果を格納している
+	探索結果にアクセスしやすい様に二次元配列（vector<vector<string>>）に結果を格納している．\n
+	マッチ箇所は regex_iterator で走査するため、探索の手間は文字列の長さに比例する（マッチした部分のみコピーされる）
 
 	\param src 探索対象の文字列
 	\param expression: 正規表現オブジェクト
@@ -176,18 +380,37 @@ auto regex_search(
 {
 	using R = std::vector<std::vector<TS>>;
 
-	typename impl::Str2RegexSelector<TS>::smatch match;
-	auto tmp = static_cast<TS>(src);
+	TS const& str = src;
 	R d;
 
-	while (SIG_RegexSearch(tmp, match, expression)){
+	for (auto const& match : RegexMatchRange<TS>(str, expression)){
 		d.push_back(std::vector<TS>());
 		for (auto const& m : match) d.back().push_back(m);
-		tmp = match.suffix().str();
 	}
 
 	return d.empty() ? Nothing(std::move(d)) : Just(std::move(d));
 }
+
+/**
+	正規表現を文字列で指定する場合（正規表現オブジェクトは cached_regex で取得する）
+
+	\param src 探索対象の文字列
+	\param expression 正規表現の文字列
+	\param flags [option] 正規表現の文法等を指定するフラグ
+
+	\code
+	auto result = regex_search("test tes1 tes2", "tes(\\d)");		// [[tes1, 1], [tes2, 2]]
+	\endcode
+*/
+template <class S, class TS = impl::string_t<S>>
+auto regex_search(
+	S&& src,
+	typename impl::identity<TS>::type const& expression,
+	typename impl::Str2RegexSelector<TS>::regex::flag_type flags = impl::Str2RegexSelector<TS>::regex::ECMAScript)
+->Maybe<std::vector<std::vector<TS>>>
+{
+	return sig::regex_search(std::forward<S>(src), *cached_regex(expression, flags));
+}
 #endif
 
 }
@@ -0,0 +1,218 @@
+﻿/*
+Copyright© 2014 Akihiro Nishimura
+
+This software is released under the MIT License.
+http://opensource.org/licenses/mit-license.php
+*/
+
+#ifndef SIG_UTIL_TOKENIZER_HPP
+#define SIG_UTIL_TOKENIZER_HPP
+
+#include "../helper/helper_modules.hpp"
+#include "../helper/container_traits.hpp"
+#include "../helper/string_view.hpp"
+#include "../helper/utf8.hpp"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+
+/// \file tokenizer.hpp 複数の区切り文字のいずれかを目印に文字列を分割するトークナイザ
+
+namespace sig
+{
+
+/// 複数の区切り文字（空白, 句読点, 全角の記号など）のいずれかを目印に、文字列を1度の走査で分割するトークナイザ
+/**
+	区切り文字の集合はコードポイントで指定し、構築時に表を作成する．\n
+	1単位で表される区切り文字（ASCII, BMP内の wchar_t 等）は表を引くだけで判定するため、区切り文字の数によらず一定の手間で済む．\n
+	複数の単位からなる区切り文字（UTF-8 の非ASCII文字, UTF-16 のサロゲートペア）は、その先頭の単位で始まる文字のみ整列済みの一覧を二分探索して判定する（区切り文字の数の対数に比例する手間）．\n
+	CHAR が char の場合は文字列を UTF-8 として、wchar_t の場合は UTF-16 (wchar_t が2byteの環境) または UTF-32 として扱う．\n
+	分割後の各トークンはコピーせずに元の文字列を参照する string_view (wstring_view) で返される（元の文字列での位置は token.data() - src.data() で求まる）．
+
+	\tparam CHAR 文字型 (char or wchar_t)
+
+	\code
+	const Tokenizer tokenizer(U" \t,、。　");		// 半角・全角の空白, 句読点
+
+	std::string src = "今日は、晴れ。 明日は　雨,  風";
+	auto tokens = tokenizer.split(src);		// vector<string_view>{ "今日は", "晴れ", "明日は", "雨", "風" }
+
+	const Tokenizer csv(U",", true, 2);			// 空のトークンを残し、先頭の2箇所のみで区切る
+	auto fields = csv.split("a,,b,c");			// vector<string_view>{ "a", "", "b,c" }
+	\endcode
+*/
+template <class CHAR>
+class BasicTokenizer
+{
+	static_assert(std::is_same<CHAR, char>::value || std::is_same<CHAR, wchar_t>::value, "CHAR must be char or wchar_t");
+
+	using Unit = typename std::make_unsigned<CHAR>::type;
+
+public:
+	using string_view_type = basic_string_view<CHAR>;
+
+private:
+	std::array<std::uint8_t, 256> table_;			// 0: 区切り文字でない, 1: 1文字の区切り文字, 2: 複数の単位からなる区切り文字の先頭
+	std::vector<CHAR> wide_;						// 値が256以上の1単位の区切り文字 (昇順)
+	std::vector<std::basic_string<CHAR>> sequences_;	// 複数の単位からなる区切り文字 (UTF-8 の非ASCII文字, UTF-16 のサロゲートペア. 昇順)
+	Unit wide_min_;
+	Unit wide_max_;
+	bool keep_empty_;
+	uint max_split_;
+
+private:
+	// p から始まる区切り文字の長さ (区切り文字でない場合は0)
+	uint match(CHAR const* p, CHAR const* last) const
+	{
+		const Unit c = static_cast<Unit>(*p);
+
+		if (c < 256){
+			const std::uint8_t kind = table_[c];
+			if (kind != 2) return kind;
+		}
+		else{
+			if (c < wide_min_ || c > wide_max_) return 0;
+			if (std::binary_search(wide_.begin(), wide_.end(), *p)) return 1;
+		}
+
+		// UTF-8, UTF-16 の符号化はどの文字も他の文字の接頭辞にならないため、
+		// p から始まる区切り文字があるとすれば、p 以降の文字列以下の最大の要素に限られる
+		const uint n = std::min<uint>(last - p, 4);
+		auto it = std::upper_bound(sequences_.begin(), sequences_.end(), p, [n](CHAR const* head, std::basic_string<CHAR> const& seq){
+			return seq.compare(0, seq.size(), head, n) > 0;
+		});
+		if (it == sequences_.begin()) return 0;
+
+		--it;
+		return (it->size() <= n && std::char_traits<CHAR>::compare(p, it->data(), it->size()) == 0) ? it->size() : 0;
+	}
+
+public:
+	/// 区切り文字の集合を指定して構築
+	/**
+		\param delimiters 区切り文字の集合（UTF-32 の文字列. ex: U" \\t、。"）
+		\param keep_empty [option] 区切り文字が連続する箇所などの空のトークンを結果に含めるか
+		\param max_split [option] 区切る箇所の最大数（0の場合は無制限）. 上限に達した後の残りの部分は1つのトークンとなる
+	*/
+	explicit BasicTokenizer(std::u32string const& delimiters, bool keep_empty = false, uint max_split = 0)
+		: wide_min_(static_cast<Unit>(-1)), wide_max_(0), keep_empty_(keep_empty), max_split_(max_split)
+	{
+		table_.fill(0);
+
+		for (char32_t cp : delimiters){
+			if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) continue;
+
+			CHAR units[4];
+			const uint len = impl::put_code_point(units, cp, std::integral_constant<uint, sizeof(CHAR)>()) - units;
+			const Unit lead = static_cast<Unit>(units[0]);
+
+			if (len == 1 && lead < 256){
+				table_[lead] = 1;
+				continue;
+			}
+			if (lead >= 256){
+				wide_min_ = std::min(wide_min_, lead);
+				wide_max_ = std::max(wide_max_, lead);
+			}
+			if (len == 1) wide_.push_back(units[0]);
+			else{
+				if (lead < 256) table_[lead] = 2;
+				sequences_.push_back(std::basic_string<CHAR>(units, len));
+			}
+		}
+
+		std::sort(wide_.begin(), wide_.end());
+		std::sort(sequences_.begin(), sequences_.end());
+		sequences_.erase(std::unique(sequences_.begin(), sequences_.end()), sequences_.end());
+	}
+
+	/// 文字列を分割し、各トークンに関数を適用する
+	/**
+		\param src 分割対象の文字列
+		\param func 各トークン (string_view_type) を引数にとる関数
+
+		\return トークンの数
+	*/
+	template <class F>
+	uint for_each(string_view_type src, F const& func) const
+	{
+		CHAR const* p = src.data();
+		CHAR const* const last = p + src.size();
+		CHAR const* token = p;
+		uint num = 0;
+
+		while (p != last){
+			const uint len = match(p, last);
+			if (!len){
+				++p;
+				continue;
+			}
+			if (keep_empty_ || p != token){
+				if (max_split_ && num == max_split_) break;		// 残りは1つのトークン
+				func(string_view_type(token, p - token));
+				++num;
+			}
+			p += len;
+			token = p;
+		}
+
+		if (keep_empty_ || token != last){
+			func(string_view_type(token, last - token));
+			++num;
+		}
+		return num;
+	}
+
+	/// 文字列を分割する
+	/**
+		\param src 分割対象の文字列
+
+		\return 各トークンを参照する string_view_type の std::vector. src が破棄・変更されるまで有効
+	*/
+	std::vector<string_view_type> split(string_view_type src) const
+	{
+		std::vector<string_view_type> result;
+		split(src, result);
+		return result;
+	}
+
+	/// 文字列を分割し、各トークンを呼び出し元のコンテナに格納する（dest の元の内容は破棄される）
+	/**
+		\param src 分割対象の文字列
+		\param dest 各トークンを格納するコンテナ（\ref sig_container ）. 要素型は (文字へのポインタ, 長さ) から構築可能な型 (string_view_type, std::basic_string<CHAR> 等)
+
+		\return トークンの数
+	*/
+	template <class C>
+	uint split(string_view_type src, C& dest) const
+	{
+		using T = typename impl::container_traits<C>::value_type;
+
+		dest.clear();
+		return for_each(src, [&](string_view_type token){
+			impl::container_traits<C>::add_element(dest, T(token.data(), token.size()));
+		});
+	}
+
+	template <class TRAITS, class A>
+	std::vector<string_view_type> split(std::basic_string<CHAR, TRAITS, A>&& src) const = delete;
+
+	template <class TRAITS, class A, class C>
+	uint split(std::basic_string<CHAR, TRAITS, A>&& src, C& dest) const = delete;
+
+	/// 空のトークンを結果に含めるか
+	bool keep_empty() const{ return keep_empty_; }
+
+	/// 区切る箇所の最大数（0の場合は無制限）
+	uint max_split() const{ return max_split_; }
+};
+
+using Tokenizer = BasicTokenizer<char>;
+using WTokenizer = BasicTokenizer<wchar_t>;
+
+}
+#endif
@@ -29,6 +29,7 @@ int main()
 	//SplitPerformanceTest();
 	//OptionalPerformanceTest();
 	//ContainerTraitsEffectiveTest();
+	//LoadLinePerformanceTest();
 
 	//container_traits.hpp test (利用可能コンテナの拡張)
 	ContainerSpecializeTest();
@@ -57,6 +58,8 @@ int main()
 	//string.hpp test
 	RegexTest();
 	SplitTest();
+	TokenizerTest();
+	AhoCorasickTest();
 	CatStrTest();
 	StrConvertTest();
 	ZenHanTest();
@@ -93,6 +96,26 @@ int main()
 	//file.hpp test
 	GetDirectoryNamesTest();
 	FileSaveLoadTest();
+	MappedLoadTest();
+	LoadLineUtf8Test();
+	LoadNumParallelTest();
+	LoadNumReportTest();
+	LibsvmTest();
+	LineStreamTest();
+	BinaryNumTest();
+	LineWriterTest();
+	ScanFileNamesTest();
+	CsvTest();
+	TailReaderTest();
+	ConcurrentAppenderTest();
+	BatchLoadTest();
+	NumCacheTest();
+	LineIndexTest();
+	ExternalSortTest();
+	DirectoryWatcherTest();
+	MappedVectorTest();
+	SerializeTest();
+	ParallelSaveTest();
 
 	return 0;
 }
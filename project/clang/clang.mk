@@ -1,6 +1,6 @@
 COMPILER = clang++
-CFLAGS   = -stdlib=libc++ -Wall -std=gnu++1y
-LDFLAGS  =
+CFLAGS   = -stdlib=libc++ -Wall -std=gnu++1y -pthread
+LDFLAGS  = -pthread
 STDLIB	= -I/usr/include/c++/4.9.2 -I/usr/include/x86_64-linux-gnu/c++/4.9
 BOOST_DIR = home/nishimura/lib/boost_1_57_0
 INCLUDE_B = -I/$(BOOST_DIR)